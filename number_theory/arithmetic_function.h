@@ -0,0 +1,117 @@
+#ifndef NUMBER_THEORY_ARITHMETIC_FUNCTION_H_
+#define NUMBER_THEORY_ARITHMETIC_FUNCTION_H_
+
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+#include "number_theory/factorization.h"
+
+// Arithmetic functions of single numbers.
+//
+// Each function can be computed from a Factorization, from a number, which is
+// factorized with Pollard's rho algorithm, or from a number and a Factorizer,
+// which looks up its table and memo first.
+
+namespace tql {
+namespace number_theory {
+
+// Euler's totient function phi(n), the number of integers in [1, n] coprime
+// to n.
+template <typename T>
+T euler_phi(const Factorization<T> &factorization) {
+  T result = 1;
+  for (const auto &[prime, exponent] : factorization) {
+    result *= prime - 1;
+    for (int i = 1; i < exponent; ++i)
+      result *= prime;
+  }
+  return result;
+}
+
+// Carmichael's function lambda(n), the exponent of the multiplicative group of
+// integers modulo n.
+template <typename T>
+T carmichael_lambda(const Factorization<T> &factorization) {
+  T result = 1;
+  for (const auto &[prime, exponent] : factorization) {
+    // lambda(2^e) = 2^(e-2) for e >= 3, and lambda(p^e) = phi(p^e) otherwise.
+    T lambda = prime - 1;
+    int power = prime == 2 && exponent >= 3 ? exponent - 2 : exponent - 1;
+    for (int i = 0; i < power; ++i)
+      lambda *= prime;
+    result = std::lcm(result, lambda);
+  }
+  return result;
+}
+
+// The Mobius function mu(n). It is 0 if n is not square-free, and (-1)^k if n
+// is the product of k distinct primes.
+template <typename T>
+int mobius(const Factorization<T> &factorization) {
+  for (const auto &[prime, exponent] : factorization) {
+    if (exponent > 1)
+      return 0;
+  }
+  return factorization.size() % 2 == 0 ? 1 : -1;
+}
+
+// The radical rad(n), the product of the distinct prime factors of n.
+template <typename T>
+T radical(const Factorization<T> &factorization) {
+  T result = 1;
+  for (const auto &[prime, exponent] : factorization)
+    result *= prime;
+  return result;
+}
+
+// The number of distinct prime factors omega(n).
+template <typename T>
+int omega(const Factorization<T> &factorization) {
+  return static_cast<int>(factorization.size());
+}
+
+// The number of prime factors with multiplicity Omega(n).
+template <typename T>
+int bigomega(const Factorization<T> &factorization) {
+  int result = 0;
+  for (const auto &[prime, exponent] : factorization)
+    result += exponent;
+  return result;
+}
+
+// Overloads an arithmetic function of factorizations for numbers.
+// The overloads throw domain_error exception if the number is not positive.
+#define OVERLOAD_ARITHMETIC_FUNCTION(RESULT, FUNCTION)                        \
+  template <typename T,                                                       \
+            std::enable_if_t<std::numeric_limits<T>::is_integer, bool> = true> \
+  RESULT FUNCTION(const T &number) {                                          \
+    return FUNCTION(factorize(number));                                       \
+  }                                                                           \
+  template <typename T>                                                       \
+  RESULT FUNCTION(const std::type_identity_t<T> &number,                      \
+                  Factorizer<T> &factorizer) {                                \
+    return FUNCTION(factorizer.factorize(number));                            \
+  }
+
+OVERLOAD_ARITHMETIC_FUNCTION(T, euler_phi)
+OVERLOAD_ARITHMETIC_FUNCTION(T, carmichael_lambda)
+OVERLOAD_ARITHMETIC_FUNCTION(int, mobius)
+OVERLOAD_ARITHMETIC_FUNCTION(T, radical)
+OVERLOAD_ARITHMETIC_FUNCTION(int, omega)
+OVERLOAD_ARITHMETIC_FUNCTION(int, bigomega)
+
+#undef OVERLOAD_ARITHMETIC_FUNCTION
+
+}  // namespace number_theory
+
+using number_theory::bigomega;
+using number_theory::carmichael_lambda;
+using number_theory::euler_phi;
+using number_theory::mobius;
+using number_theory::omega;
+using number_theory::radical;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_ARITHMETIC_FUNCTION_H_
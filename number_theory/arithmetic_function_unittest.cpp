@@ -0,0 +1,98 @@
+#include <stdint.h>
+
+#include <numeric>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/arithmetic_function.h"
+#include "number_theory/factorization.h"
+#include "number_theory/sieve.h"
+
+namespace tql::number_theory {
+
+// Computes the arithmetic functions of small numbers by brute force.
+struct NaiveArithmeticFunctions {
+  int64_t phi = 0;
+  int mu = 1;
+  int64_t rad = 1;
+  int omega = 0;
+  int bigomega = 0;
+
+  explicit NaiveArithmeticFunctions(int64_t n) {
+    for (int64_t i = 1; i <= n; ++i) {
+      if (std::gcd(i, n) == 1)
+        ++phi;
+    }
+    int64_t m = n;
+    for (int64_t p = 2; p <= m; ++p) {
+      if (m % p != 0)
+        continue;
+      ++omega;
+      rad *= p;
+      int e = 0;
+      while (m % p == 0) {
+        m /= p;
+        ++e;
+      }
+      bigomega += e;
+      mu = e > 1 ? 0 : -mu;
+    }
+  }
+};
+
+TEST(ArithmeticFunctionTest, SmallNumbers) {
+  for (int64_t n = 1; n <= 200; ++n) {
+    NaiveArithmeticFunctions expected(n);
+    EXPECT_EQ(euler_phi(n), expected.phi) << n;
+    EXPECT_EQ(mobius(n), expected.mu) << n;
+    EXPECT_EQ(radical(n), expected.rad) << n;
+    EXPECT_EQ(omega(n), expected.omega) << n;
+    EXPECT_EQ(bigomega(n), expected.bigomega) << n;
+  }
+  EXPECT_THROW(euler_phi(0), std::domain_error);
+  EXPECT_THROW(mobius(-3), std::domain_error);
+}
+
+TEST(ArithmeticFunctionTest, CarmichaelLambda) {
+  // OEIS A002322
+  const int expected[] = {1, 1, 2, 2, 4, 2, 6, 2,  6, 4,  10, 2, 12, 6, 4,
+                          4, 16, 6, 18, 4, 6, 10, 22, 2, 20, 12, 18, 6, 28, 4,
+                          30, 8, 10, 16, 12, 6, 36, 18, 12, 4};
+  for (int n = 1; n <= 40; ++n)
+    EXPECT_EQ(carmichael_lambda(n), expected[n - 1]) << n;
+  EXPECT_EQ(carmichael_lambda(uint64_t(1) << 40), uint64_t(1) << 38);
+}
+
+TEST(ArithmeticFunctionTest, LargeNumbers) {
+  uint64_t p = 4294967291, q = 4294967279;
+  uint64_t n = p * q;
+  EXPECT_EQ(euler_phi(n), (p - 1) * (q - 1));
+  EXPECT_EQ(carmichael_lambda(n), std::lcm(p - 1, q - 1));
+  EXPECT_EQ(mobius(n), 1);
+  EXPECT_EQ(radical(n), n);
+  EXPECT_EQ(omega(n), 2);
+  EXPECT_EQ(bigomega(n), 2);
+
+  uint64_t m = uint64_t(1000003) * 1000003 * 1000003;
+  EXPECT_EQ(euler_phi(m), uint64_t(1000002) * 1000003 * 1000003);
+  EXPECT_EQ(mobius(m), 0);
+  EXPECT_EQ(radical(m), 1000003u);
+  EXPECT_EQ(omega(m), 1);
+  EXPECT_EQ(bigomega(m), 3);
+}
+
+TEST(ArithmeticFunctionTest, Factorizer) {
+  EulerSieve<uint64_t> sieve(1000);
+  Factorizer<uint64_t> factorizer(sieve, /*memo_capacity=*/4);
+  for (uint64_t n = 1; n <= 2000; ++n) {
+    EXPECT_EQ(euler_phi(n, factorizer), euler_phi(n));
+    EXPECT_EQ(carmichael_lambda(n, factorizer), carmichael_lambda(n));
+    EXPECT_EQ(mobius(n, factorizer), mobius(n));
+    EXPECT_EQ(radical(n, factorizer), radical(n));
+    EXPECT_EQ(omega(n, factorizer), omega(n));
+    EXPECT_EQ(bigomega(n, factorizer), bigomega(n));
+  }
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,117 @@
+#ifndef NUMBER_THEORY_CHIRP_Z_H_
+#define NUMBER_THEORY_CHIRP_Z_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "number_theory/convolution.h"
+#include "number_theory/modular.h"
+
+// Evaluation of polynomials at geometric progressions.
+
+namespace tql {
+namespace number_theory {
+
+namespace chirp_z_internal {
+
+// Returns the |count| values from the index |u|.size() - 1 of the convolution
+// of |u| reversed and |v|, where |v| has |u|.size() + |count| - 1 values.
+// With the number-theoretic transform, this middle product takes a cyclic
+// convolution of the size |v|.size(), since the wrapped values only reach the
+// unneeded ones.
+template <ModularType M>
+std::vector<M> middle_product(std::span<const M> u, std::span<const M> v,
+                              size_t count) {
+  using namespace convolution_internal;
+  std::vector<M> reversed(u.rbegin(), u.rend());
+  if constexpr (fits_lanes<M>()) {
+    constexpr auto kModulus = static_cast<uint32_t>(M::modulus);
+    if constexpr (has_ntt(kModulus, 2)) {
+      size_t size = transform_size(v.size());
+      if (std::min(u.size(), count) >= kNttThreshold &&
+          size <= Ntt<kModulus>::kMaxSize) {
+        std::vector<uint32_t> x(size), y(size);
+        for (size_t i = 0; i < u.size(); ++i)
+          x[i] = static_cast<uint32_t>(reversed[i].get());
+        for (size_t i = 0; i < v.size(); ++i)
+          y[i] = static_cast<uint32_t>(v[i].get());
+        Ntt<kModulus>::convolve_cyclic(x.data(), y.data(), size);
+        std::vector<M> result(count);
+        for (size_t i = 0; i < count; ++i)
+          result[i] = static_cast<typename M::type>(x[u.size() - 1 + i]);
+        return result;
+      }
+    }
+  }
+  std::vector<M> product = convolve<M>(reversed, v);
+  return std::vector<M>(product.begin() + (u.size() - 1),
+                        product.begin() + (u.size() - 1 + count));
+}
+
+}  // namespace chirp_z_internal
+
+// Returns the values of the polynomial with the coefficients |coefficients|,
+// from the constant one, at |a| |r|^i for 0 <= i < |count|, which is the
+// chirp z-transform. This takes a convolution of the size
+// |coefficients|.size() + |count| with Bluestein's algorithm for any sizes,
+// where i j = T(i + j) - T(i) - T(j) for T(k) = k (k - 1) / 2 gives
+//   p(a r^i) = r^-T(i) sum_j (c_j a^j r^-T(j)) r^T(i + j).
+// Throws domain_error exception if |r| is neither 0 nor a unit modulo
+// M::modulus.
+template <ModularType M>
+std::vector<M> chirp_z(std::span<const M> coefficients, const M &a,
+                       const M &r, size_t count) {
+  size_t n = coefficients.size();
+  std::vector<M> result(count);
+  if (n == 0 || count == 0)
+    return result;
+  if (r == M(0)) {
+    // p(a), and then p(0).
+    M value = 0;
+    for (size_t j = n; j-- > 0;)
+      value = value * a + coefficients[j];
+    std::fill(result.begin(), result.end(), coefficients[0]);
+    result[0] = value;
+    return result;
+  }
+  if (!r.is_unit())
+    throw std::domain_error("The ratio must be a unit.");
+  M r_inverse = r.inverse();
+  // u_j = c_j a^j r^-T(j) for j < n, and v_k = r^T(k) for k < n + count - 1.
+  std::vector<M> u(n), v(n + count - 1);
+  M power_of_a = 1, triangular_inverse = 1, step_inverse = 1;
+  for (size_t j = 0; j < n; ++j) {
+    u[j] = coefficients[j] * power_of_a * triangular_inverse;
+    power_of_a *= a;
+    triangular_inverse *= step_inverse;
+    step_inverse *= r_inverse;
+  }
+  M triangular = 1, step = 1;
+  for (size_t k = 0; k < v.size(); ++k) {
+    v[k] = triangular;
+    triangular *= step;
+    step *= r;
+  }
+  result = chirp_z_internal::middle_product<M>(u, v, count);
+  triangular_inverse = 1;
+  step_inverse = 1;
+  for (size_t i = 0; i < count; ++i) {
+    result[i] *= triangular_inverse;
+    triangular_inverse *= step_inverse;
+    step_inverse *= r_inverse;
+  }
+  return result;
+}
+
+}  // namespace number_theory
+
+using number_theory::chirp_z;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_CHIRP_Z_H_
@@ -0,0 +1,88 @@
+#include <stdint.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/chirp_z.h"
+#include "number_theory/modular.h"
+
+namespace tql::number_theory {
+
+// Returns the values of the polynomial with |coefficients| at a r^i for
+// i < |count| by Horner's rule.
+template <typename M>
+std::vector<M> evaluate_naive(const std::vector<M> &coefficients, M a, M r,
+                              size_t count) {
+  std::vector<M> result(count);
+  M x = a;
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = coefficients.size(); j-- > 0;)
+      result[i] = result[i] * x + coefficients[j];
+    x *= r;
+  }
+  return result;
+}
+
+// Checks chirp_z modulo |mod| against Horner's rule.
+template <auto mod>
+void test_chirp_z(size_t n, size_t count) {
+  using Mod = Modular<mod>;
+  using T = typename Mod::type;
+  std::mt19937_64 generator(n * 1000 + count);
+  auto random = [&] {
+    return Mod(static_cast<T>(generator() % static_cast<uint64_t>(mod)));
+  };
+  std::vector<Mod> coefficients(n);
+  for (Mod &c : coefficients)
+    c = random();
+  Mod a = random(), r = random();
+  while (!r.is_unit())
+    r = random();
+  EXPECT_EQ(chirp_z<Mod>(coefficients, a, r, count),
+            evaluate_naive(coefficients, a, r, count))
+      << n << " " << count;
+  // The powers of r, and the ratios 0 and 1.
+  EXPECT_EQ(chirp_z<Mod>(coefficients, 1, r, count),
+            evaluate_naive(coefficients, Mod(1), r, count));
+  EXPECT_EQ(chirp_z<Mod>(coefficients, a, 0, count),
+            evaluate_naive(coefficients, a, Mod(0), count));
+  EXPECT_EQ(chirp_z<Mod>(coefficients, a, 1, count),
+            evaluate_naive(coefficients, a, Mod(1), count));
+}
+
+TEST(ChirpZTest, ChirpZ) {
+  for (size_t n : {1, 2, 7, 100, 600}) {
+    for (size_t count : {1, 3, 64, 333, 700}) {
+      test_chirp_z<998244353>(n, count);
+      test_chirp_z<1000000007>(n, count);
+      test_chirp_z<(uint64_t(1) << 61) - 1>(n, count);
+      test_chirp_z<1000>(n, count);
+    }
+  }
+}
+
+TEST(ChirpZTest, Empty) {
+  using Mod = Modular<998244353>;
+  std::vector<Mod> coefficients = {1, 2, 3}, empty;
+  EXPECT_TRUE(chirp_z<Mod>(coefficients, 1, 2, 0).empty());
+  EXPECT_EQ(chirp_z<Mod>(empty, 1, 2, 3), std::vector<Mod>(3));
+}
+
+TEST(ChirpZTest, DiscreteFourierTransform) {
+  // With a root of unity of the order 3, which is not a power of two.
+  using Mod = Modular<7>;
+  std::vector<Mod> coefficients = {1, 2, 3};
+  std::vector<Mod> expected = {6, 1 + 2 * 2 + 3 * 4, 1 + 2 * 4 + 3 * 2};
+  EXPECT_EQ(chirp_z<Mod>(coefficients, 1, 2, 3), expected);
+}
+
+TEST(ChirpZTest, NonUnitRatio) {
+  using Mod = Modular<1000>;
+  std::vector<Mod> coefficients = {1, 2, 3};
+  EXPECT_THROW(chirp_z<Mod>(coefficients, 1, 10, 3), std::domain_error);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,891 @@
+#ifndef NUMBER_THEORY_CONVOLUTION_H_
+#define NUMBER_THEORY_CONVOLUTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "number_theory/modular.h"
+#include "number_theory/modular_vector.h"
+
+// Convolution of sequences of Modular values, which is the product of
+// polynomials.
+
+namespace tql {
+namespace number_theory {
+
+namespace convolution_internal {
+
+using modular_vector_internal::Montgomery32;
+
+// Returns the smallest primitive root modulo the prime |p|.
+constexpr uint32_t primitive_root(uint32_t p) {
+  uint32_t factors[32] = {};
+  int num_factors = 0;
+  uint32_t m = p - 1;
+  for (uint32_t d = 2; uint64_t(d) * d <= m; ++d) {
+    if (m % d != 0)
+      continue;
+    factors[num_factors++] = d;
+    while (m % d == 0)
+      m /= d;
+  }
+  if (m > 1)
+    factors[num_factors++] = m;
+  for (uint32_t g = 2;; ++g) {
+    bool is_primitive = true;
+    for (int i = 0; i < num_factors; ++i)
+      is_primitive &=
+          modular_internal::pow_u64(g, (p - 1) / factors[i], p) != 1;
+    if (is_primitive)
+      return g;
+  }
+}
+
+// Returns whether the number-theoretic transform modulo |modulus| exists for
+// |size|, a power of two, which is when |modulus| is a prime below 2^31 and
+// |size| divides |modulus| - 1.
+constexpr bool has_ntt(uint64_t modulus, size_t size) {
+  return modulus < (uint64_t(1) << 31) && modulus > 2 &&
+         size <= (uint64_t(1) << std::countr_zero(modulus - 1)) &&
+         prime_internal::is_prime_u64(modulus);
+}
+
+// The transforms do the levels with butterflies within blocks of this many
+// values block by block, so that the blocks stay in the cache.
+inline constexpr size_t kTransformBlockSize = 1 << 12;
+
+// Does the levels of a transform of the size |size| with |half| from
+// |size| / 2 down to 1, where |level|(begin, length, half) does one level on
+// [begin, begin + length).
+template <typename Level>
+void transform_levels(size_t size, Level level) {
+  size_t half = size / 2;
+  for (; 2 * half > kTransformBlockSize; half /= 2)
+    level(0, size, half);
+  if (half == 0)
+    return;
+  for (size_t start = 0; start < size; start += 2 * half) {
+    for (size_t h = half; h >= 1; h /= 2)
+      level(start, 2 * half, h);
+  }
+}
+
+// Does the levels of an inverse transform of the size |size| with |half| from
+// 1 up to |size| / 2, block by block as transform_levels.
+template <typename Level>
+void inverse_transform_levels(size_t size, Level level) {
+  size_t block = std::min(size, kTransformBlockSize);
+  for (size_t start = 0; start < size; start += block) {
+    for (size_t half = 1; half < block; half *= 2)
+      level(start, block, half);
+  }
+  for (size_t half = block; half < size; half *= 2)
+    level(0, size, half);
+}
+
+// Number-theoretic transforms modulo the prime |p| < 2^31 in 32-bit
+// Montgomery lanes, for sizes which are powers of two dividing p - 1.
+template <uint32_t p>
+class Ntt {
+ public:
+  static constexpr Montgomery32 kMontgomery{p};
+  // The largest size of the transforms.
+  static constexpr size_t kMaxSize = size_t(1) << std::countr_zero(p - 1);
+
+  // Transforms |values| of the size |size| in place, from the natural order
+  // to the bit-reversed order, with decimation in frequency.
+  static void transform(uint32_t *values, size_t size) {
+    const uint32_t *roots = root_table(size, false);
+    transform_levels(size, [&](size_t begin, size_t length, size_t half) {
+      const uint32_t *level = roots + half;
+      for (size_t start = begin; start < begin + length; start += 2 * half) {
+        uint32_t *x = values + start;
+        uint32_t *y = x + half;
+        for (size_t j = 0; j < half; ++j) {
+          uint32_t a = x[j], b = y[j];
+          x[j] = kMontgomery.add(a, b);
+          y[j] = kMontgomery.multiply_prepared(kMontgomery.subtract(a, b),
+                                               level[j]);
+        }
+      }
+    });
+  }
+
+  // Inverts transform in place, from the bit-reversed order to the natural
+  // order, with decimation in time. The values are divided by |size|.
+  static void inverse_transform(uint32_t *values, size_t size) {
+    const uint32_t *roots = root_table(size, true);
+    inverse_transform_levels(size, [&](size_t begin, size_t length,
+                                       size_t half) {
+      const uint32_t *level = roots + half;
+      for (size_t start = begin; start < begin + length; start += 2 * half) {
+        uint32_t *x = values + start;
+        uint32_t *y = x + half;
+        for (size_t j = 0; j < half; ++j) {
+          uint32_t a = x[j];
+          uint32_t b = kMontgomery.multiply_prepared(y[j], level[j]);
+          x[j] = kMontgomery.add(a, b);
+          y[j] = kMontgomery.subtract(a, b);
+        }
+      }
+    });
+    uint32_t scale = kMontgomery.prepare(static_cast<uint32_t>(
+        modular_internal::pow_u64(size % p, p - 2, p)));
+    for (size_t i = 0; i < size; ++i)
+      values[i] = kMontgomery.multiply_prepared(values[i], scale);
+  }
+
+  // Returns the cyclic convolution of |a| and |b| of the size |size| in
+  // place of |a|. |b| is transformed in place.
+  static void convolve_cyclic(uint32_t *a, uint32_t *b, size_t size) {
+    transform(a, size);
+    transform(b, size);
+    for (size_t i = 0; i < size; ++i)
+      a[i] = kMontgomery.multiply(a[i], b[i]);
+    inverse_transform(a, size);
+  }
+
+ private:
+  // Returns the roots of unity for the transforms up to |size|, prepared for
+  // multiply_prepared. The roots of the level with |half| butterflies are
+  // w^0, ..., w^(half - 1) at [half, 2 * half), where w has the order
+  // 2 * half, or their inverses if |inverse|. The tables are cached per
+  // thread.
+  static const uint32_t *root_table(size_t size, bool inverse) {
+    if (size > kMaxSize)
+      throw std::length_error("The transform is too long for the modulus.");
+    thread_local std::vector<uint32_t> tables[2];
+    std::vector<uint32_t> &table = tables[inverse];
+    if (table.size() < size) {
+      constexpr uint32_t kRoot = primitive_root(p);
+      table.assign(std::max<size_t>(size, 2), 0);
+      for (size_t half = 1; half < table.size(); half *= 2) {
+        uint64_t w = modular_internal::pow_u64(kRoot, (p - 1) / (2 * half), p);
+        if (inverse)
+          w = modular_internal::pow_u64(w, p - 2, p);
+        uint64_t power = 1;
+        for (size_t j = 0; j < half; ++j) {
+          table[half + j] = kMontgomery.prepare(static_cast<uint32_t>(power));
+          power = power * w % p;
+        }
+      }
+    }
+    return table.data();
+  }
+};
+
+// Returns the size of the cyclic transforms for a convolution of the size
+// |size|.
+inline size_t transform_size(size_t size) { return std::bit_ceil(size); }
+
+// Returns the convolution of |a| and |b| modulo the prime |p| with the
+// number-theoretic transform, where the values are below 2^32.
+template <uint32_t p>
+std::vector<uint32_t> convolve_ntt_prime(std::span<const uint32_t> a,
+                                         std::span<const uint32_t> b) {
+  size_t result_size = a.size() + b.size() - 1;
+  size_t size = transform_size(result_size);
+  std::vector<uint32_t> x(size), y(size);
+  for (size_t i = 0; i < a.size(); ++i)
+    x[i] = a[i] % p;
+  for (size_t i = 0; i < b.size(); ++i)
+    y[i] = b[i] % p;
+  Ntt<p>::convolve_cyclic(x.data(), y.data(), size);
+  x.resize(result_size);
+  return x;
+}
+
+// The primes of the transforms for arbitrary moduli below 2^31. The
+// transforms modulo kNttPrime0 are limited to 2^23 values, and the product of
+// the primes exceeds 2^86, which bounds the convolutions up to that length.
+inline constexpr uint32_t kNttPrime0 = 998244353;  // 119 * 2^23 + 1
+inline constexpr uint32_t kNttPrime1 = 167772161;  // 5 * 2^25 + 1
+inline constexpr uint32_t kNttPrime2 = 469762049;  // 7 * 2^26 + 1
+
+// Returns the convolution of |a| and |b| modulo |modulus| < 2^31 with the
+// number-theoretic transforms modulo three primes, combined with the Chinese
+// remainder theorem.
+// Throws length_error exception if the convolution is longer than 2^23.
+template <uint32_t modulus>
+std::vector<uint32_t> convolve_three_primes(std::span<const uint32_t> a,
+                                            std::span<const uint32_t> b) {
+  using modular_internal::pow_u64;
+  if (transform_size(a.size() + b.size() - 1) > Ntt<kNttPrime0>::kMaxSize)
+    throw std::length_error("The convolution is too long.");
+  std::vector<uint32_t> r0 = convolve_ntt_prime<kNttPrime0>(a, b);
+  std::vector<uint32_t> r1 = convolve_ntt_prime<kNttPrime1>(a, b);
+  std::vector<uint32_t> r2 = convolve_ntt_prime<kNttPrime2>(a, b);
+  // Garner's algorithm: x = r0 + p0 t1 + p0 p1 t2.
+  constexpr uint64_t p0 = kNttPrime0, p1 = kNttPrime1, p2 = kNttPrime2;
+  constexpr uint64_t kInverse01 = pow_u64(p0 % p1, p1 - 2, p1);
+  constexpr uint64_t kInverse012 = pow_u64(p0 * p1 % p2, p2 - 2, p2);
+  constexpr uint64_t kP0 = p0 % modulus, kP01 = p0 * p1 % modulus;
+  for (size_t i = 0; i < r0.size(); ++i) {
+    uint64_t t1 = (r1[i] + p1 - r0[i] % p1) * kInverse01 % p1;
+    uint64_t x01 = r0[i] + p0 * t1;  // Below p0 p1 < 2^58.
+    uint64_t t2 = (r2[i] + p2 - x01 % p2) * kInverse012 % p2;
+    r0[i] = static_cast<uint32_t>((r0[i] + kP0 * t1 % modulus + kP01 * t2) %
+                                  modulus);
+  }
+  return r0;
+}
+
+// Complex FFTs on separate arrays of the real and the imaginary parts, so
+// that the butterflies are vectorized.
+class Fft {
+ public:
+  // Transforms |re| + i |im| of the size |size| in place, from the natural
+  // order to the bit-reversed order, with decimation in frequency.
+  static void transform(double *re, double *im, size_t size) {
+    const double *roots = root_table(size);
+    size_t table_size = root_table_size();
+    transform_levels(size, [&](size_t begin, size_t length, size_t half) {
+      const double *w_re = roots + half;
+      const double *w_im = roots + table_size + half;
+      for (size_t start = begin; start < begin + length; start += 2 * half) {
+        double *x_re = re + start, *x_im = im + start;
+        double *y_re = x_re + half, *y_im = x_im + half;
+        for (size_t j = 0; j < half; ++j) {
+          double d_re = x_re[j] - y_re[j], d_im = x_im[j] - y_im[j];
+          x_re[j] += y_re[j];
+          x_im[j] += y_im[j];
+          y_re[j] = d_re * w_re[j] - d_im * w_im[j];
+          y_im[j] = d_re * w_im[j] + d_im * w_re[j];
+        }
+      }
+    });
+  }
+
+  // Inverts transform in place, from the bit-reversed order to the natural
+  // order, with decimation in time. The values are multiplied by |size|.
+  static void inverse_transform(double *re, double *im, size_t size) {
+    const double *roots = root_table(size);
+    size_t table_size = root_table_size();
+    inverse_transform_levels(size, [&](size_t begin, size_t length,
+                                       size_t half) {
+      const double *w_re = roots + half;
+      const double *w_im = roots + table_size + half;
+      for (size_t start = begin; start < begin + length; start += 2 * half) {
+        double *x_re = re + start, *x_im = im + start;
+        double *y_re = x_re + half, *y_im = x_im + half;
+        for (size_t j = 0; j < half; ++j) {
+          // y / w = y conj(w).
+          double b_re = y_re[j] * w_re[j] + y_im[j] * w_im[j];
+          double b_im = y_im[j] * w_re[j] - y_re[j] * w_im[j];
+          y_re[j] = x_re[j] - b_re;
+          y_im[j] = x_im[j] - b_im;
+          x_re[j] += b_re;
+          x_im[j] += b_im;
+        }
+      }
+    });
+  }
+
+  // Calls |f|(j, k) for the positions j and k of the spectra in the
+  // bit-reversed order of the size |size| which hold X[l] and X[-l]. The
+  // positions 0 and 1 hold X[0] and X[size / 2] and are their own partners,
+  // and the positions in [m, 2 m) are paired in reverse for each power of
+  // two m >= 2.
+  template <typename F>
+  static void for_each_conjugate_pair(size_t size, F f) {
+    f(0, 0);
+    if (size >= 2)
+      f(1, 1);
+    for (size_t m = 2; m < size; m *= 2) {
+      for (size_t j = m; j < 2 * m; ++j)
+        f(j, 3 * m - 1 - j);
+    }
+  }
+
+ private:
+  // Returns the size of the table of the current thread.
+  static size_t &root_table_size() {
+    thread_local size_t table_size = 0;
+    return table_size;
+  }
+
+  // Returns the roots of unity e^(-pi i j / half) at [half, 2 * half) for each
+  // level with |half| butterflies, the real parts followed by the imaginary
+  // parts at the offset root_table_size(). Each root is computed directly for
+  // the accuracy. The table is cached per thread.
+  static const double *root_table(size_t size) {
+    thread_local std::vector<double> table;
+    size_t &table_size = root_table_size();
+    if (table_size < size) {
+      table_size = std::max<size_t>(size, 2);
+      table.assign(2 * table_size, 0);
+      for (size_t half = 1; half < table_size; half *= 2) {
+        for (size_t j = 0; j < half; ++j) {
+          double angle = -std::numbers::pi * static_cast<double>(j) /
+                         static_cast<double>(half);
+          table[half + j] = std::cos(angle);
+          table[table_size + half + j] = std::sin(angle);
+        }
+      }
+    }
+    return table.data();
+  }
+};
+
+// The limbs of the FFT convolution have 15 bits.
+inline constexpr int kLimbBits = 15;
+
+// The largest rounding error accepted in the FFT convolution. The result is
+// rounded to the nearest integers, so any error below 0.5 is exact.
+inline constexpr double kMaxRoundingError = 0.125;
+
+// Returns an estimate of the rounding error of an FFT convolution of the size
+// |size| for operands with the Euclidean norms |norm_a| and |norm_b|. The
+// error is bounded by the product of the norms, the machine epsilon and a
+// multiple of log2(|size|).
+inline double estimate_rounding_error(double norm_a, double norm_b,
+                                      size_t size) {
+  return norm_a * norm_b * std::numeric_limits<double>::epsilon() *
+         std::log2(static_cast<double>(size));
+}
+
+// Splits |value| < 2^31 into three balanced limbs with |value| = limbs[0] +
+// limbs[1] 2^15 + limbs[2] 2^30, where the lower limbs are in
+// [-2^14, 2^14) and limbs[2] is in [0, 2]. Balanced limbs halve the
+// magnitudes of the products, and cancel in the sums of random values.
+inline void split_limbs(uint32_t value, double limbs[3]) {
+  constexpr int64_t kHalf = 1 << (kLimbBits - 1);
+  constexpr int64_t kMask = (1 << kLimbBits) - 1;
+  int64_t x = value;
+  int64_t low = ((x + kHalf) & kMask) - kHalf;
+  x = (x - low) >> kLimbBits;
+  int64_t middle = ((x + kHalf) & kMask) - kHalf;
+  limbs[0] = static_cast<double>(low);
+  limbs[1] = static_cast<double>(middle);
+  limbs[2] = static_cast<double>((x - middle) >> kLimbBits);
+}
+
+// Returns the convolution of |a| and |b| modulo |modulus| < 2^31 with the
+// floating-point FFT, or an empty vector if the rounding error may reach
+// kMaxRoundingError.
+//
+// The values are split into three balanced 15-bit limbs, so that each limb
+// product stays far below 2^53. Two real sequences are packed into each
+// complex transform: a0 + i a1, b0 + i b1 and a2 + i b2 are transformed, the
+// spectra of the 5 limb sums of the result are computed from them, and packed
+// again into 3 inverse transforms. The error is estimated from the norms of
+// the limbs before the transforms, and measured by the distance to the
+// nearest integers after them.
+template <uint32_t modulus>
+std::vector<uint32_t> convolve_fft(std::span<const uint32_t> a,
+                                   std::span<const uint32_t> b) {
+  size_t result_size = a.size() + b.size() - 1;
+  size_t size = transform_size(result_size);
+  // Three transforms of the packed limbs.
+  std::vector<double> re(3 * size), im(3 * size);
+  double *a01_re = re.data(), *a01_im = im.data();
+  double *b01_re = a01_re + size, *b01_im = a01_im + size;
+  double *a2b2_re = b01_re + size, *a2b2_im = b01_im + size;
+  double norm_a = 0, norm_b = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    double limbs[3];
+    split_limbs(a[i], limbs);
+    a01_re[i] = limbs[0];
+    a01_im[i] = limbs[1];
+    a2b2_re[i] = limbs[2];
+    norm_a += limbs[0] * limbs[0] + limbs[1] * limbs[1] + limbs[2] * limbs[2];
+  }
+  for (size_t i = 0; i < b.size(); ++i) {
+    double limbs[3];
+    split_limbs(b[i], limbs);
+    b01_re[i] = limbs[0];
+    b01_im[i] = limbs[1];
+    a2b2_im[i] = limbs[2];
+    norm_b += limbs[0] * limbs[0] + limbs[1] * limbs[1] + limbs[2] * limbs[2];
+  }
+  if (estimate_rounding_error(std::sqrt(norm_a), std::sqrt(norm_b), size) >=
+      kMaxRoundingError) {
+    return {};
+  }
+  for (int k = 0; k < 3; ++k)
+    Fft::transform(re.data() + k * size, im.data() + k * size, size);
+
+  // The spectra of x and y from the spectrum Z of x + i y are
+  // X[l] = (Z[l] + conj(Z[-l])) / 2 and Y[l] = (Z[l] - conj(Z[-l])) / 2i.
+  // The products are packed as P0 + i P1, P2 + i P3 and P4, each scaled by
+  // 1 / size for the inverse transforms.
+  std::vector<double> out_re(3 * size), out_im(3 * size);
+  double scale = 0.25 / static_cast<double>(size);
+  Fft::for_each_conjugate_pair(size, [&](size_t j, size_t k) {
+    // 2 X and 2 Y of each packed pair.
+    auto split = [&](const double *z_re, const double *z_im, double x[2],
+                     double y[2]) {
+      x[0] = z_re[j] + z_re[k];
+      x[1] = z_im[j] - z_im[k];
+      y[0] = z_im[j] + z_im[k];
+      y[1] = z_re[k] - z_re[j];
+    };
+    double a0[2], a1[2], a2[2], b0[2], b1[2], b2[2];
+    split(a01_re, a01_im, a0, a1);
+    split(b01_re, b01_im, b0, b1);
+    split(a2b2_re, a2b2_im, a2, b2);
+    // Accumulates |x| |y| into |sum|.
+    auto add_product = [](const double x[2], const double y[2],
+                          double sum[2]) {
+      sum[0] += x[0] * y[0] - x[1] * y[1];
+      sum[1] += x[0] * y[1] + x[1] * y[0];
+    };
+    double p[5][2] = {};
+    add_product(a0, b0, p[0]);
+    add_product(a0, b1, p[1]);
+    add_product(a1, b0, p[1]);
+    add_product(a0, b2, p[2]);
+    add_product(a1, b1, p[2]);
+    add_product(a2, b0, p[2]);
+    add_product(a1, b2, p[3]);
+    add_product(a2, b1, p[3]);
+    add_product(a2, b2, p[4]);
+    // P + i Q.
+    out_re[j] = (p[0][0] - p[1][1]) * scale;
+    out_im[j] = (p[0][1] + p[1][0]) * scale;
+    out_re[size + j] = (p[2][0] - p[3][1]) * scale;
+    out_im[size + j] = (p[2][1] + p[3][0]) * scale;
+    out_re[2 * size + j] = p[4][0] * scale;
+    out_im[2 * size + j] = p[4][1] * scale;
+  });
+  for (int k = 0; k < 3; ++k) {
+    Fft::inverse_transform(out_re.data() + k * size, out_im.data() + k * size,
+                           size);
+  }
+
+  std::vector<uint32_t> result(result_size);
+  double max_error = 0;
+  for (size_t i = 0; i < result_size; ++i) {
+    double limbs[5] = {out_re[2 * size + i], out_im[size + i],
+                       out_re[size + i], out_im[i], out_re[i]};
+    // Horner's rule from the highest limb, with the sums below 2^54.
+    int64_t value = 0;
+    for (double limb : limbs) {
+      double rounded = std::nearbyint(limb);
+      max_error = std::max(max_error, std::abs(limb - rounded));
+      value = ((value << kLimbBits) + static_cast<int64_t>(rounded)) %
+              int64_t(modulus);
+    }
+    result[i] = static_cast<uint32_t>(value < 0 ? value + modulus : value);
+  }
+  if (max_error >= kMaxRoundingError)
+    return {};
+  return result;
+}
+
+// Returns the values of |values| as 32-bit lanes.
+template <ModularType M>
+std::vector<uint32_t> to_lanes(std::span<const M> values) {
+  std::vector<uint32_t> lanes(values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    lanes[i] = static_cast<uint32_t>(values[i].get());
+  return lanes;
+}
+
+// Returns |lanes| as Modular values.
+template <ModularType M>
+std::vector<M> from_lanes(const std::vector<uint32_t> &lanes) {
+  std::vector<M> values(lanes.size());
+  for (size_t i = 0; i < lanes.size(); ++i)
+    values[i] = static_cast<typename M::type>(lanes[i]);
+  return values;
+}
+
+// Returns whether the values of Modular M fit the 32-bit transforms.
+template <ModularType M>
+constexpr bool fits_lanes() {
+  return std::numeric_limits<typename M::type>::digits <= 64 &&
+         static_cast<uint64_t>(M::modulus) < (uint64_t(1) << 31);
+}
+
+// The thresholds of the kernels of PolynomialMultiplier.
+struct KernelThresholds {
+  // Below this size of the smaller operand, the products are done by the
+  // definition.
+  size_t karatsuba;
+  // From this size of balanced operands, Toom-3 is used instead of Karatsuba
+  // multiplication where the modulus is coprime to 6.
+  size_t toom3;
+};
+
+// Returns the inverse of 2 modulo the odd |modulus|.
+template <typename T>
+constexpr T inverse_of_two(T modulus) {
+  return (modulus - 1) / 2 + 1;
+}
+
+// Returns the inverse of 3 modulo |modulus| coprime to 3.
+template <typename T>
+constexpr T inverse_of_three(T modulus) {
+  return modulus % 3 == 1 ? modulus - (modulus - 1) / 3 : (modulus - 2) / 3 + 1;
+}
+
+// Arithmetic of the polynomial kernels on 32-bit lanes modulo |modulus| <
+// 2^31. Additions are branch-free, and the products of the schoolbook are
+// summed in 64 bits and reduced once per coefficient.
+template <uint32_t modulus>
+struct LaneArithmetic {
+  using Value = uint32_t;
+
+  static constexpr KernelThresholds kThresholds{32, 48};
+  // Whether the interpolation of Toom-3, which divides by 2 and 3, exists.
+  static constexpr bool kHasToom3 = modulus % 2 != 0 && modulus % 3 != 0;
+  static constexpr Value kInverseOfTwo = inverse_of_two(modulus);
+  static constexpr Value kInverseOfThree = inverse_of_three(modulus);
+
+  static Value add(Value a, Value b) {
+    Value sum = a + b;
+    return std::min(sum, sum - modulus);
+  }
+
+  static Value subtract(Value a, Value b) {
+    Value difference = a - b;
+    return std::min(difference, difference + modulus);
+  }
+
+  static Value multiply(Value a, Value b) {
+    return static_cast<Value>(uint64_t(a) * b % modulus);
+  }
+
+  // Sets |result|[0, |n| + |m| - 1) to the product of |a| of the size |n| and
+  // |b| of the size |m| by the definition. The coefficients are summed in
+  // tiles on the stack, kept below 2^63 + modulus^2 by subtracting a multiple
+  // of modulus^2, so that the inner loop has no division and vectorizes.
+  static void multiply_schoolbook(const Value *a, size_t n, const Value *b,
+                                  size_t m, Value *result) {
+    constexpr uint64_t kSquare = uint64_t(modulus) * modulus;
+    constexpr uint64_t kLimit = (uint64_t(1) << 63) / kSquare * kSquare;
+    constexpr size_t kTile = 64;
+    size_t size = n + m - 1;
+    for (size_t begin = 0; begin < size; begin += kTile) {
+      size_t end = std::min(begin + kTile, size);
+      uint64_t sums[kTile] = {};
+      for (size_t i = 0; i < n && i < end; ++i) {
+        size_t first = begin > i ? begin - i : 0;
+        size_t last = std::min(end - i, m);
+        uint64_t *s = sums + (i + first - begin);
+        uint64_t x = a[i];
+        for (size_t j = first; j < last; ++j) {
+          uint64_t t = s[j - first] + x * b[j];
+          s[j - first] = std::min(t, t - kLimit);
+        }
+      }
+      for (size_t k = begin; k < end; ++k)
+        result[k] = static_cast<Value>(sums[k - begin] % modulus);
+    }
+  }
+};
+
+// Arithmetic of the polynomial kernels on Modular values.
+template <ModularType M>
+struct ModularArithmetic {
+  using Value = M;
+
+  // The products of the wide moduli are slower, so that the schoolbook is
+  // left earlier.
+  static constexpr KernelThresholds kThresholds{16, 48};
+  static constexpr bool kHasToom3 = M::modulus % 2 != 0 && M::modulus % 3 != 0;
+  static inline const Value kInverseOfTwo = inverse_of_two(M::modulus);
+  static inline const Value kInverseOfThree = inverse_of_three(M::modulus);
+
+  static Value add(Value a, Value b) { return a + b; }
+  static Value subtract(Value a, Value b) { return a - b; }
+  static Value multiply(Value a, Value b) { return a * b; }
+
+  static void multiply_schoolbook(const Value *a, size_t n, const Value *b,
+                                  size_t m, Value *result) {
+    std::fill(result, result + n + m - 1, Value());
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < m; ++j)
+        result[i + j] += a[i] * b[j];
+    }
+  }
+};
+
+// Products of polynomials with the schoolbook, Karatsuba multiplication and
+// Toom-3 over the arithmetic A, chosen by the size. All the temporary values
+// of the recursion are carved out of a single scratch arena.
+template <typename A>
+class PolynomialMultiplier {
+ public:
+  using Value = typename A::Value;
+
+  explicit PolynomialMultiplier(KernelThresholds thresholds = A::kThresholds)
+      : thresholds_{std::max<size_t>(thresholds.karatsuba, 2),
+                    std::max<size_t>(thresholds.toom3, 12)} {}
+
+  // Returns the product of |a| and |b|, which are not empty.
+  std::vector<Value> multiply(std::span<const Value> a,
+                              std::span<const Value> b) {
+    if (a.size() > b.size())
+      std::swap(a, b);
+    size_t n = a.size(), m = b.size();
+    std::vector<Value> result(n + m - 1);
+    if (n < thresholds_.karatsuba) {
+      A::multiply_schoolbook(a.data(), n, b.data(), m, result.data());
+      return result;
+    }
+    // The balanced products of |a| and the blocks of |b| of the size n, where
+    // the last block is padded.
+    arena_.assign(3 * n + scratch_size(n), Value());
+    Value *product = arena_.data();
+    Value *block = product + 2 * n;
+    Value *scratch = block + n;
+    for (size_t offset = 0; offset < m; offset += n) {
+      const Value *x = b.data() + offset;
+      if (m - offset < n) {
+        std::copy(x, b.data() + m, block);
+        std::fill(block + (m - offset), block + n, Value());
+        x = block;
+      }
+      multiply_balanced(a.data(), x, n, product, scratch);
+      for (size_t i = 0; i < 2 * n - 1 && offset + i < result.size(); ++i)
+        result[offset + i] = A::add(result[offset + i], product[i]);
+    }
+    return result;
+  }
+
+ private:
+  // Returns the size of the scratch of multiply_balanced for |n|.
+  size_t scratch_size(size_t n) const {
+    if (n < thresholds_.karatsuba)
+      return 0;
+    if (A::kHasToom3 && n >= thresholds_.toom3) {
+      size_t k = (n + 2) / 3;
+      return 12 * k + scratch_size(k);
+    }
+    size_t high = n - n / 2;
+    return 4 * high + scratch_size(high);
+  }
+
+  // Sets |result|[0, 2 |n|) to the product of |a| and |b| of the size |n|,
+  // where the last value is 0.
+  void multiply_balanced(const Value *a, const Value *b, size_t n,
+                         Value *result, Value *scratch) {
+    if (n < thresholds_.karatsuba) {
+      A::multiply_schoolbook(a, n, b, n, result);
+      result[2 * n - 1] = Value();
+    } else if (A::kHasToom3 && n >= thresholds_.toom3) {
+      toom3(a, b, n, result, scratch);
+    } else {
+      karatsuba(a, b, n, result, scratch);
+    }
+  }
+
+  // Karatsuba multiplication: with a = a0 + a1 x^low and b likewise,
+  // a b = z0 + ((a0 + a1) (b0 + b1) - z0 - z2) x^low + z2 x^(2 low) for
+  // z0 = a0 b0 and z2 = a1 b1.
+  void karatsuba(const Value *a, const Value *b, size_t n, Value *result,
+                 Value *scratch) {
+    size_t low = n / 2, high = n - low;
+    Value *sum_a = scratch, *sum_b = sum_a + high;
+    Value *middle = sum_b + high;
+    Value *rest = middle + 2 * high;
+    multiply_balanced(a, b, low, result, rest);
+    multiply_balanced(a + low, b + low, high, result + 2 * low, rest);
+    for (size_t i = 0; i < low; ++i) {
+      sum_a[i] = A::add(a[i], a[low + i]);
+      sum_b[i] = A::add(b[i], b[low + i]);
+    }
+    if (high > low) {
+      sum_a[low] = a[n - 1];
+      sum_b[low] = b[n - 1];
+    }
+    multiply_balanced(sum_a, sum_b, high, middle, rest);
+    for (size_t i = 0; i < 2 * low; ++i)
+      middle[i] = A::subtract(middle[i], result[i]);
+    for (size_t i = 0; i < 2 * high; ++i)
+      middle[i] = A::subtract(middle[i], result[2 * low + i]);
+    for (size_t i = 0; i < 2 * high; ++i)
+      result[low + i] = A::add(result[low + i], middle[i]);
+  }
+
+  // Toom-3: with a = a0 + a1 x^k + a2 x^(2 k) and b likewise, the product is
+  // interpolated from its values at 0, 1, -1, -2 and infinity, with
+  // Bodrato's sequence of exact divisions by 2 and 3.
+  void toom3(const Value *a, const Value *b, size_t n, Value *result,
+             Value *scratch) {
+    size_t k = (n + 2) / 3, top = n - 2 * k;
+    Value *a_at_1 = scratch, *a_at_minus_1 = a_at_1 + k;
+    Value *a_at_minus_2 = a_at_minus_1 + k, *b_at_1 = a_at_minus_2 + k;
+    Value *b_at_minus_1 = b_at_1 + k, *b_at_minus_2 = b_at_minus_1 + k;
+    Value *r1 = b_at_minus_2 + k, *r_minus_1 = r1 + 2 * k;
+    Value *r_minus_2 = r_minus_1 + 2 * k;
+    Value *rest = r_minus_2 + 2 * k;
+    auto evaluate = [&](const Value *x, Value *at_1, Value *at_minus_1,
+                        Value *at_minus_2) {
+      for (size_t i = 0; i < k; ++i) {
+        Value x0 = x[i], x1 = x[k + i], x2 = i < top ? x[2 * k + i] : Value();
+        Value even = A::add(x0, x2);
+        at_1[i] = A::add(even, x1);
+        at_minus_1[i] = A::subtract(even, x1);
+        Value t = A::add(at_minus_1[i], x2);
+        at_minus_2[i] = A::subtract(A::add(t, t), x0);
+      }
+    };
+    evaluate(a, a_at_1, a_at_minus_1, a_at_minus_2);
+    evaluate(b, b_at_1, b_at_minus_1, b_at_minus_2);
+    // r0 and r_infinity go to their places in |result|.
+    multiply_balanced(a, b, k, result, rest);
+    multiply_balanced(a + 2 * k, b + 2 * k, top, result + 4 * k, rest);
+    multiply_balanced(a_at_1, b_at_1, k, r1, rest);
+    multiply_balanced(a_at_minus_1, b_at_minus_1, k, r_minus_1, rest);
+    multiply_balanced(a_at_minus_2, b_at_minus_2, k, r_minus_2, rest);
+    for (size_t i = 0; i < 2 * k; ++i) {
+      Value r0 = result[i];
+      Value r_infinity = i < 2 * top ? result[4 * k + i] : Value();
+      Value c3 = A::multiply(A::subtract(r_minus_2[i], r1[i]),
+                             A::kInverseOfThree);
+      Value c1 = A::multiply(A::subtract(r1[i], r_minus_1[i]),
+                             A::kInverseOfTwo);
+      Value c2 = A::subtract(r_minus_1[i], r0);
+      c3 = A::add(A::multiply(A::subtract(c2, c3), A::kInverseOfTwo),
+                  A::add(r_infinity, r_infinity));
+      c2 = A::subtract(A::add(c2, c1), r_infinity);
+      r1[i] = A::subtract(c1, c3);
+      r_minus_1[i] = c2;
+      r_minus_2[i] = c3;
+    }
+    std::fill(result + 2 * k, result + 4 * k, Value());
+    for (size_t i = 0; i < 2 * k; ++i) {
+      result[k + i] = A::add(result[k + i], r1[i]);
+      result[2 * k + i] = A::add(result[2 * k + i], r_minus_1[i]);
+      result[3 * k + i] = A::add(result[3 * k + i], r_minus_2[i]);
+    }
+  }
+
+  KernelThresholds thresholds_;
+  std::vector<Value> arena_;
+};
+
+// The arithmetic of the polynomial kernels for Modular M: 32-bit lanes if the
+// modulus is below 2^31, or else the Modular values.
+template <ModularType M>
+using KernelArithmetic =
+    std::conditional_t<fits_lanes<M>(),
+                       LaneArithmetic<static_cast<uint32_t>(M::modulus)>,
+                       ModularArithmetic<M>>;
+
+// Returns the convolution of |a| and |b|, which are not empty, with
+// PolynomialMultiplier.
+template <ModularType M>
+std::vector<M> convolve_toom_cook(
+    std::span<const M> a, std::span<const M> b,
+    KernelThresholds thresholds = KernelArithmetic<M>::kThresholds) {
+  PolynomialMultiplier<KernelArithmetic<M>> multiplier(thresholds);
+  if constexpr (fits_lanes<M>())
+    return from_lanes<M>(multiplier.multiply(to_lanes(a), to_lanes(b)));
+  else
+    return multiplier.multiply(a, b);
+}
+
+// From these sizes of the smaller operand, the number-theoretic transform
+// modulo the modulus, and the other transforms are faster than Toom-3.
+inline constexpr size_t kNttThreshold = 256;
+inline constexpr size_t kTransformThreshold = 1792;
+
+// Up to this size of the transforms, the FFT is faster than the
+// number-theoretic transforms modulo three primes.
+inline constexpr size_t kFftMaxSize = 1 << 13;
+
+}  // namespace convolution_internal
+
+// Returns the convolution of |a| and |b| modulo M::modulus < 2^31 with a
+// floating-point FFT, which splits the values into 15-bit limbs and takes six
+// complex transforms. When the rounding error may reach the result, which is
+// estimated before and checked after the transforms, this falls back to the
+// number-theoretic transforms modulo three primes.
+// The result is empty if |a| or |b| is empty.
+// Throws length_error exception if it falls back and the convolution is
+// longer than 2^23.
+template <ModularType M>
+std::vector<M> convolve_fft_mod(std::span<const M> a, std::span<const M> b) {
+  static_assert(convolution_internal::fits_lanes<M>(),
+                "convolve_fft_mod requires a modulus below 2^31.");
+  using namespace convolution_internal;
+  if (a.empty() || b.empty())
+    return {};
+  constexpr auto kModulus = static_cast<uint32_t>(M::modulus);
+  std::vector<uint32_t> x = to_lanes(a), y = to_lanes(b);
+  std::vector<uint32_t> result = convolve_fft<kModulus>(x, y);
+  if (result.empty())
+    result = convolve_three_primes<kModulus>(x, y);
+  return from_lanes<M>(result);
+}
+
+// Returns the convolution of |a| and |b| modulo M::modulus < 2^31 with
+// number-theoretic transforms. If the modulus is a prime with a root of unity
+// of the length, the transform is done modulo it, and otherwise modulo three
+// primes, combined with the Chinese remainder theorem.
+// The result is empty if |a| or |b| is empty.
+// Throws length_error exception if the transforms modulo three primes are
+// needed and the convolution is longer than 2^23.
+template <ModularType M>
+std::vector<M> convolve_ntt(std::span<const M> a, std::span<const M> b) {
+  static_assert(convolution_internal::fits_lanes<M>(),
+                "convolve_ntt requires a modulus below 2^31.");
+  using namespace convolution_internal;
+  if (a.empty() || b.empty())
+    return {};
+  constexpr auto kModulus = static_cast<uint32_t>(M::modulus);
+  std::vector<uint32_t> x = to_lanes(a), y = to_lanes(b);
+  if constexpr (has_ntt(kModulus, 2)) {
+    if (transform_size(a.size() + b.size() - 1) <= Ntt<kModulus>::kMaxSize)
+      return from_lanes<M>(convolve_ntt_prime<kModulus>(x, y));
+  }
+  return from_lanes<M>(convolve_three_primes<kModulus>(x, y));
+}
+
+// Returns the convolution of |a| and |b|, which is the product of the
+// polynomials with the coefficients |a| and |b|, modulo M::modulus. The
+// algorithm is chosen by the lengths: the schoolbook for short operands,
+// Karatsuba multiplication and Toom-3 for medium ones, and for long ones the
+// number-theoretic transform if the modulus has roots of unity, or else the
+// floating-point FFT for transforms up to 2^13 within its error bound, or else
+// the number-theoretic transforms modulo three primes. Moduli above 2^31 use
+// Karatsuba multiplication and Toom-3 at any length.
+// The result is empty if |a| or |b| is empty.
+// Throws length_error exception if a modulus below 2^31 needs the transforms
+// modulo three primes and the convolution is longer than 2^23.
+template <ModularType M>
+std::vector<M> convolve(std::span<const M> a, std::span<const M> b) {
+  using namespace convolution_internal;
+  if (a.empty() || b.empty())
+    return {};
+  if constexpr (fits_lanes<M>()) {
+    constexpr auto kModulus = static_cast<uint32_t>(M::modulus);
+    size_t min_size = std::min(a.size(), b.size());
+    size_t size = transform_size(a.size() + b.size() - 1);
+    if constexpr (has_ntt(kModulus, 2)) {
+      if (min_size >= kNttThreshold && size <= Ntt<kModulus>::kMaxSize)
+        return convolve_ntt(a, b);
+    }
+    if (min_size >= kTransformThreshold) {
+      if (size <= kFftMaxSize)
+        return convolve_fft_mod(a, b);
+      return convolve_ntt(a, b);
+    }
+  }
+  return convolve_toom_cook(a, b);
+}
+
+}  // namespace number_theory
+
+using number_theory::convolve;
+using number_theory::convolve_fft_mod;
+using number_theory::convolve_ntt;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_CONVOLUTION_H_
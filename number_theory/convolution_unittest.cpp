@@ -0,0 +1,163 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/convolution.h"
+#include "number_theory/modular.h"
+
+namespace tql::number_theory {
+
+// Returns |size| random values of Modular M, with the extremes at the front.
+template <typename M>
+std::vector<M> random_values(size_t size, std::mt19937_64 &generator) {
+  using T = typename M::type;
+  std::vector<M> values(size);
+  for (size_t i = 0; i < size; ++i)
+    values[i] = static_cast<T>(generator() % static_cast<uint64_t>(M::modulus));
+  if (size > 1) {
+    values[0] = M::modulus - 1;
+    values[size - 1] = M::modulus - 1;
+  }
+  return values;
+}
+
+// Returns the convolution of |a| and |b| by the definition.
+template <typename M>
+std::vector<M> convolve_naive(std::span<const M> a, std::span<const M> b) {
+  std::vector<M> result(a.size() + b.size() - 1);
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < b.size(); ++j)
+      result[i + j] += a[i] * b[j];
+  }
+  return result;
+}
+
+// Checks the convolutions modulo |mod| against the definition for the sizes
+// |a_size| and |b_size|.
+template <auto mod>
+void test_convolve(size_t a_size, size_t b_size) {
+  using Mod = Modular<mod>;
+  std::mt19937_64 generator(a_size * 1000 + b_size);
+  std::vector<Mod> a = random_values<Mod>(a_size, generator);
+  std::vector<Mod> b = random_values<Mod>(b_size, generator);
+  std::span<const Mod> x(a), y(b);
+  std::vector<Mod> expected = convolve_naive(x, y);
+  EXPECT_EQ(convolve(x, y), expected) << a_size << " " << b_size;
+  EXPECT_EQ(convolve(y, x), expected) << a_size << " " << b_size;
+  // Karatsuba multiplication and Toom-3 down to small sizes.
+  for (convolution_internal::KernelThresholds thresholds :
+       {convolution_internal::KernelThresholds{2, 1000000},
+        convolution_internal::KernelThresholds{4, 12},
+        convolution_internal::KernelThresholds{8, 30},
+        convolution_internal::KernelArithmetic<Mod>::kThresholds}) {
+    EXPECT_EQ(convolution_internal::convolve_toom_cook(x, y, thresholds),
+              expected)
+        << a_size << " " << b_size << " " << thresholds.karatsuba << " "
+        << thresholds.toom3;
+  }
+  if constexpr (convolution_internal::fits_lanes<Mod>()) {
+    EXPECT_EQ(convolve_ntt(x, y), expected) << a_size << " " << b_size;
+    EXPECT_EQ(convolve_fft_mod(x, y), expected) << a_size << " " << b_size;
+  }
+}
+
+template <auto mod>
+void test_convolve_sizes() {
+  for (size_t a_size : {1, 2, 31, 32, 33, 100, 300}) {
+    for (size_t b_size : {1, 5, 32, 64, 257, 700})
+      test_convolve<mod>(a_size, b_size);
+  }
+}
+
+TEST(ConvolutionTest, Convolve) {
+  // NTT-friendly primes.
+  test_convolve_sizes<998244353>();
+  test_convolve_sizes<uint32_t(469762049)>();
+  // Other moduli below 2^31.
+  test_convolve_sizes<1000000007>();
+  test_convolve_sizes<(1u << 31) - 1>();
+  test_convolve_sizes<int64_t(1) << 30>();
+  test_convolve_sizes<97>();
+  test_convolve_sizes<3 * 5 * 7 * 11 * 13>();
+  // A prime with the roots of unity only up to the order 8.
+  test_convolve_sizes<8 * 1001 + 1>();
+  // Wide moduli.
+  test_convolve_sizes<(uint64_t(1) << 61) - 1>();
+}
+
+TEST(ConvolutionTest, Empty) {
+  using Mod = Modular<998244353>;
+  std::vector<Mod> a = {1, 2, 3}, empty;
+  EXPECT_TRUE(convolve<Mod>(a, empty).empty());
+  EXPECT_TRUE(convolve<Mod>(empty, a).empty());
+  EXPECT_TRUE(convolve_ntt<Mod>(empty, empty).empty());
+  EXPECT_TRUE(convolve_fft_mod<Mod>(empty, a).empty());
+}
+
+TEST(ConvolutionTest, Small) {
+  using Mod = Modular<7>;
+  std::vector<Mod> a = {1, 2, 3}, b = {4, 5};
+  std::vector<Mod> expected = {4, 13, 22, 15};
+  EXPECT_EQ(convolve<Mod>(a, b), expected);
+  EXPECT_EQ(convolve_ntt<Mod>(a, b), expected);
+  EXPECT_EQ(convolve_fft_mod<Mod>(a, b), expected);
+}
+
+TEST(ConvolutionTest, Long) {
+  using Mod = Modular<(1u << 31) - 1>;
+  std::mt19937_64 generator(1);
+  // Random values within the error bound of the FFT, and values with all
+  // limbs at -2^14 beyond it, which fall back to the number-theoretic
+  // transforms.
+  for (size_t size : {size_t(1) << 15, size_t(1) << 16}) {
+    std::vector<Mod> a = random_values<Mod>(size, generator);
+    std::vector<Mod> b = random_values<Mod>(size, generator);
+    if (size == (size_t(1) << 16)) {
+      std::fill(a.begin(), a.end(), (1u << 31) - (1u << 29) - (1u << 14));
+      std::fill(b.begin(), b.end(), (1u << 31) - (1u << 29) - (1u << 14));
+    }
+    std::vector<uint32_t> x = convolution_internal::to_lanes<Mod>(a),
+                          y = convolution_internal::to_lanes<Mod>(b);
+    EXPECT_EQ(convolution_internal::convolve_fft<Mod::modulus>(x, y).empty(),
+              size == (size_t(1) << 16));
+    std::vector<Mod> result = convolve_fft_mod<Mod>(a, b);
+    ASSERT_EQ(result.size(), 2 * size - 1);
+    EXPECT_EQ(result, convolve<Mod>(a, b));
+    EXPECT_EQ(result,
+              convolution_internal::from_lanes<Mod>(
+                  convolution_internal::convolve_three_primes<Mod::modulus>(
+                      x, y)));
+    // Spot checks against the definition.
+    for (size_t k : {size_t(0), size - 1, size, 2 * size - 2}) {
+      Mod expected = 0;
+      for (size_t i = k < size ? 0 : k - size + 1; i <= k && i < size; ++i)
+        expected += a[i] * b[k - i];
+      EXPECT_EQ(result[k], expected);
+    }
+  }
+}
+
+TEST(ConvolutionTest, LengthLimit) {
+  // The transforms modulo three primes reach 2^23 values, which is the limit
+  // of the roots of unity modulo 998244353.
+  using Mod = Modular<1000000007>;
+  size_t size = size_t(1) << 22;
+  std::vector<Mod> a(size, Mod(1)), b(size + 1, Mod(1));
+  std::vector<Mod> result = convolve<Mod>(a, b);
+  ASSERT_EQ(result.size(), size_t(1) << 23);
+  EXPECT_EQ(result[0], Mod(1));
+  EXPECT_EQ(result[size - 1], Mod(size));
+  EXPECT_EQ(result[size], Mod(size));
+  EXPECT_EQ(result.back(), Mod(1));
+  b.push_back(1);
+  EXPECT_THROW(convolve<Mod>(a, b), std::length_error);
+  EXPECT_THROW(convolve_ntt<Mod>(a, b), std::length_error);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,221 @@
+#ifndef NUMBER_THEORY_CRT_MODULAR_H_
+#define NUMBER_THEORY_CRT_MODULAR_H_
+
+#include <stddef.h>
+
+#include <iostream>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "number_theory/modular.h"
+
+// Modular arithmetic over composite moduli, decomposed by the Chinese
+// remainder theorem.
+
+namespace tql {
+namespace number_theory {
+
+namespace crt_modular_internal {
+
+// Returns whether the product of |moduli| fits T, and they are pairwise
+// coprime.
+template <typename T, size_t kSize>
+constexpr bool is_valid_decomposition(const T (&moduli)[kSize]) {
+  T product = 1;
+  for (size_t i = 0; i < kSize; ++i) {
+    if (moduli[i] <= 0 || __builtin_mul_overflow(product, moduli[i], &product))
+      return false;
+    for (size_t j = 0; j < i; ++j) {
+      if (std::gcd(moduli[i], moduli[j]) != 1)
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace crt_modular_internal
+
+// Ring of integers modulo the product of the pairwise coprime |moduli|, which
+// stores the residues modulo each of them. By the Chinese remainder theorem,
+// the ring is the product of the rings Modular<moduli>.
+//
+// For a composite modulus m = p1^e1 * ... * pk^ek, use the prime powers as the
+// moduli. Then every operation is done per component in a smaller ring: an
+// element is a unit if and only if each component is, division inverts each
+// component, and pow raises each component to the power. The value modulo m is
+// only reconstructed by get().
+template <auto... moduli>
+class CrtModular {
+ public:
+  // The base type of the values, which holds the product of the moduli.
+  using type = std::common_type_t<decltype(moduli)...>;
+  // The modulus of the ring, which is the product of the moduli.
+  static constexpr type modulus = (static_cast<type>(moduli) * ...);
+
+  static_assert(sizeof...(moduli) > 0 &&
+                    crt_modular_internal::is_valid_decomposition<type>(
+                        {static_cast<type>(moduli)...}),
+                "CrtModular requires pairwise coprime positive moduli, whose "
+                "product fits their type.");
+
+  // This is an implicit constructor, like the one of Modular.
+  CrtModular(type value = 0)  // NOLINT(runtime/explicit)
+      : components_(component_of<moduli>(value)...) {}
+
+  // Constructs an element from its components.
+  explicit CrtModular(const Modular<moduli> &...components)
+      : components_(components...) {}
+
+  CrtModular(const CrtModular &other) = default;
+  CrtModular(CrtModular &&other) = default;
+  CrtModular &operator=(const CrtModular &other) = default;
+  CrtModular &operator=(CrtModular &&other) = default;
+
+  // Returns the component modulo the |index|-th modulus.
+  template <size_t index>
+  const auto &component() const {
+    return std::get<index>(components_);
+  }
+
+  // Returns the value in [0, modulus), reconstructed with Garner's algorithm.
+  type get() const {
+    type value = 0;
+    type product = 1;
+    std::apply(
+        [&](const auto &...components) {
+          (garner_step(components, value, product), ...);
+        },
+        components_);
+    return value;
+  }
+
+  // Addition in the modular ring.
+  CrtModular add(const CrtModular &rhs) const {
+    return transform(rhs, [](const auto &a, const auto &b) { return a + b; });
+  }
+
+  // Returns the additive inverse.
+  CrtModular negate() const {
+    return transform(*this, [](const auto &a, const auto &) { return -a; });
+  }
+
+  // Subtraction in the modular ring.
+  CrtModular subtract(const CrtModular &rhs) const {
+    return transform(rhs, [](const auto &a, const auto &b) { return a - b; });
+  }
+
+  // Multiplication in the modular ring.
+  CrtModular multiply(const CrtModular &rhs) const {
+    return transform(rhs, [](const auto &a, const auto &b) { return a * b; });
+  }
+
+  // Division in the modular ring. Throws std::domain_error if the
+  // multiplicative inverse does not exist.
+  CrtModular divide(const CrtModular &rhs) const {
+    return multiply(rhs.inverse());
+  }
+
+  // Multiplicative inverse in the modular ring, which inverts each component.
+  // Throws std::domain_error if it does not exist.
+  CrtModular inverse() const {
+    return transform(*this,
+                     [](const auto &a, const auto &) { return a.inverse(); });
+  }
+
+  // Returns whether the value has a multiplicative inverse, which is whether
+  // each component has one.
+  bool is_unit() const {
+    return std::apply(
+        [](const auto &...components) {
+          return (components.is_unit() && ...);
+        },
+        components_);
+  }
+
+  // Compares for equality.
+  bool equal(const CrtModular &rhs) const {
+    return components_ == rhs.components_;
+  }
+  bool not_equal(const CrtModular &rhs) const { return !equal(rhs); }
+
+  friend CrtModular operator+(const CrtModular &lhs, const CrtModular &rhs) {
+    return lhs.add(rhs);
+  }
+  friend CrtModular operator-(const CrtModular &lhs, const CrtModular &rhs) {
+    return lhs.subtract(rhs);
+  }
+  friend CrtModular operator*(const CrtModular &lhs, const CrtModular &rhs) {
+    return lhs.multiply(rhs);
+  }
+  friend CrtModular operator/(const CrtModular &lhs, const CrtModular &rhs) {
+    return lhs.divide(rhs);
+  }
+  friend CrtModular &operator+=(CrtModular &lhs, const CrtModular &rhs) {
+    return lhs = lhs.add(rhs);
+  }
+  friend CrtModular &operator-=(CrtModular &lhs, const CrtModular &rhs) {
+    return lhs = lhs.subtract(rhs);
+  }
+  friend CrtModular &operator*=(CrtModular &lhs, const CrtModular &rhs) {
+    return lhs = lhs.multiply(rhs);
+  }
+  friend CrtModular &operator/=(CrtModular &lhs, const CrtModular &rhs) {
+    return lhs = lhs.divide(rhs);
+  }
+  friend CrtModular operator-(const CrtModular &x) { return x.negate(); }
+  friend bool operator==(const CrtModular &lhs, const CrtModular &rhs) {
+    return lhs.equal(rhs);
+  }
+
+  friend std::ostream &operator<<(std::ostream &stream, const CrtModular &x) {
+    return stream << x.get();
+  }
+
+ private:
+  std::tuple<Modular<moduli>...> components_;
+
+  // Returns the component of |value| modulo |mod|.
+  template <auto mod>
+  static Modular<mod> component_of(type value) {
+    return Modular<mod>(static_cast<typename Modular<mod>::type>(
+        modular_internal::normalize(value, static_cast<type>(mod))));
+  }
+
+  // Extends |value| modulo |product| to the modulus of |component|, and
+  // multiplies |product| by it.
+  template <typename M>
+  static void garner_step(const M &component, type &value, type &product) {
+    constexpr auto kModulus = static_cast<type>(M::modulus);
+    // value + t * product = component (mod kModulus).
+    M t = (component - component_of<M::modulus>(value)) /
+          component_of<M::modulus>(product);
+    value += static_cast<type>(t.get()) * product;
+    product *= kModulus;
+  }
+
+  // Returns the element whose components are |function| of the components of
+  // this and |rhs|.
+  template <typename Function>
+  CrtModular transform(const CrtModular &rhs, Function function) const {
+    return transform(rhs, function,
+                     std::make_index_sequence<sizeof...(moduli)>());
+  }
+
+  template <typename Function, size_t... indices>
+  CrtModular transform(const CrtModular &rhs,
+                       Function function,
+                       std::index_sequence<indices...>) const {
+    return CrtModular(function(std::get<indices>(components_),
+                               std::get<indices>(rhs.components_))...);
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::CrtModular;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_CRT_MODULAR_H_
@@ -0,0 +1,68 @@
+#include <stdint.h>
+
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/crt_modular.h"
+#include "number_theory/modular.h"
+
+namespace tql::number_theory {
+
+TEST(CrtModularTest, Arithmetic) {
+  // 360 = 2^3 * 3^2 * 5.
+  using Crt = CrtModular<8, 9, 5>;
+  using Mod = Modular<360>;
+  static_assert(Crt::modulus == 360);
+  for (int a = -360; a < 720; a += 7) {
+    Crt x = a;
+    EXPECT_EQ(x.get(), Mod(a).get());
+    EXPECT_EQ(x.component<0>(), Modular<8>(a));
+    EXPECT_EQ(x.component<1>(), Modular<9>(a));
+    EXPECT_EQ(x.component<2>(), Modular<5>(a));
+  }
+  for (int a = 0; a < 360; ++a) {
+    Crt x = a;
+    EXPECT_EQ((-x).get(), (-Mod(a)).get());
+    EXPECT_EQ(x.is_unit(), std::gcd(a, 360) == 1);
+    EXPECT_EQ(x.is_unit(), Mod(a).is_unit());
+    if (x.is_unit()) {
+      EXPECT_EQ(x.inverse().get(), Mod(a).inverse().get());
+      EXPECT_EQ(x * x.inverse(), Crt(1));
+    } else {
+      EXPECT_THROW(x.inverse(), std::domain_error);
+    }
+    for (int b = 0; b < 360; b += 13) {
+      Crt y = b;
+      EXPECT_EQ((x + y).get(), (Mod(a) + Mod(b)).get());
+      EXPECT_EQ((x - y).get(), (Mod(a) - Mod(b)).get());
+      EXPECT_EQ((x * y).get(), (Mod(a) * Mod(b)).get());
+      if (y.is_unit())
+        EXPECT_EQ((x / y).get(), (Mod(a) / Mod(b)).get());
+    }
+  }
+  EXPECT_EQ(pow(Crt(7), 12345).get(), pow(Mod(7), 12345).get());
+  EXPECT_EQ(pow(Crt(7), -3).get(), pow(Mod(7), -3).get());
+}
+
+TEST(CrtModularTest, Operators) {
+  using Crt = CrtModular<int64_t(998244353), int64_t(1000000007)>;
+  Crt x(Modular<int64_t(998244353)>(3), Modular<int64_t(1000000007)>(5));
+  EXPECT_EQ(x.get() % 998244353, 3);
+  EXPECT_EQ(x.get() % 1000000007, 5);
+  Crt y = x;
+  y += 1;
+  y *= 2;
+  y -= x;
+  y /= 3;
+  EXPECT_EQ(y * 3, x + 2);
+  EXPECT_TRUE(y != x);
+  EXPECT_EQ(x + 1, 1 + x);
+  std::ostringstream stream;
+  stream << Crt(-1);
+  EXPECT_EQ(stream.str(), "998244359987710470");
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,135 @@
+#ifndef NUMBER_THEORY_DIVISOR_H_
+#define NUMBER_THEORY_DIVISOR_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "number_theory/factorization.h"
+
+// Divisors and divisor functions computed from prime factorizations.
+
+namespace tql {
+namespace number_theory {
+
+namespace divisor_internal {
+
+// Returns |a| * |b|. Throws overflow_error exception if it overflows.
+template <typename T>
+T checked_multiply(const T &a, const T &b) {
+  T result;
+  if (__builtin_mul_overflow(a, b, &result))
+    throw std::overflow_error("The divisor function overflows.");
+  return result;
+}
+
+// Returns |a| + |b|. Throws overflow_error exception if it overflows.
+template <typename T>
+T checked_add(const T &a, const T &b) {
+  T result;
+  if (__builtin_add_overflow(a, b, &result))
+    throw std::overflow_error("The divisor function overflows.");
+  return result;
+}
+
+}  // namespace divisor_internal
+
+// Calls |function|(d) for each positive divisor d of the number factorized by
+// |factorization|, including 1 and the number itself. The divisors are not
+// visited in increasing order.
+//
+// It enumerates the exponent vectors like an odometer, keeping the products of
+// the higher prime powers, so each divisor takes amortized O(1)
+// multiplications. It does not recurse or allocate memory.
+template <typename T, typename Function>
+void for_each_divisor(const Factorization<T> &factorization,
+                      Function function) {
+  constexpr size_t kMaxPrimes = Factorization<T>::kMaxPrimes;
+  // products[i] is the product of prime_j^exponents[j] for j >= i.
+  std::array<T, kMaxPrimes + 1> products;
+  std::array<int, kMaxPrimes> exponents{};
+  products.fill(1);
+  size_t size = factorization.size();
+
+  function(T(1));
+  while (true) {
+    size_t i = 0;
+    while (i < size && exponents[i] == factorization[i].exponent)
+      ++i;
+    if (i == size)
+      return;
+    ++exponents[i];
+    products[i] *= factorization[i].prime;
+    for (size_t j = 0; j < i; ++j) {
+      exponents[j] = 0;
+      products[j] = products[i];
+    }
+    function(products[0]);
+  }
+}
+
+// Returns the number of positive divisors (tau) of the number factorized by
+// |factorization| in O(omega(n)) time.
+template <typename T>
+T num_divisors(const Factorization<T> &factorization) {
+  T result = 1;
+  for (const auto &[prime, exponent] : factorization)
+    result *= static_cast<T>(exponent + 1);
+  return result;
+}
+
+// Returns the sum of positive divisors (sigma) of the number factorized by
+// |factorization| in O(omega(n)) time, not counting the exponentiations.
+// Throws overflow_error exception if the sum does not fit in T.
+template <typename T>
+T sum_divisors(const Factorization<T> &factorization) {
+  using divisor_internal::checked_add;
+  using divisor_internal::checked_multiply;
+  T result = 1;
+  for (const auto &[prime, exponent] : factorization) {
+    // 1 + p + p^2 + ... + p^e
+    T sum = 1;
+    T power = 1;
+    for (int i = 0; i < exponent; ++i) {
+      power *= prime;
+      sum = checked_add(sum, power);
+    }
+    result = checked_multiply(result, sum);
+  }
+  return result;
+}
+
+// Writes the positive divisors of the number factorized by |factorization| to
+// the beginning of |out|, and returns the number of divisors. If |sorted| is
+// true, the divisors are sorted in increasing order.
+// It does not allocate memory. Throws length_error exception if |out| is too
+// short.
+template <typename T>
+size_t divisors(const Factorization<T> &factorization,
+                std::span<T> out,
+                bool sorted = false) {
+  if (std::cmp_greater(num_divisors(factorization), out.size()))
+    throw std::length_error("The span is too short to hold all divisors.");
+  size_t size = 0;
+  for_each_divisor(factorization,
+                   [out, &size](const T &d) { out[size++] = d; });
+  if (sorted)
+    std::sort(out.begin(), out.begin() + size);
+  return size;
+}
+
+}  // namespace number_theory
+
+using number_theory::divisors;
+using number_theory::for_each_divisor;
+using number_theory::num_divisors;
+using number_theory::sum_divisors;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_DIVISOR_H_
@@ -0,0 +1,85 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/divisor.h"
+#include "number_theory/factorization.h"
+#include "number_theory/sieve.h"
+
+namespace tql::number_theory {
+
+template <typename T>
+void test_divisors() {
+  EulerSieve<T> sieve(100);
+  for (T n = 1; n <= 100; ++n) {
+    std::vector<T> expected;
+    for (T d = 1; d <= n; ++d) {
+      if (n % d == 0)
+        expected.push_back(d);
+    }
+    Factorization<T> factorization = factorize(n, sieve);
+    EXPECT_EQ(num_divisors(factorization), T(expected.size()));
+    int64_t sum = 0;
+    for (const T &d : expected)
+      sum += d;
+    if (std::in_range<T>(sum))
+      EXPECT_EQ(sum_divisors(factorization), sum);
+    else
+      EXPECT_THROW(sum_divisors(factorization), std::overflow_error);
+
+    std::vector<T> visited;
+    for_each_divisor(factorization, [&visited](T d) { visited.push_back(d); });
+    std::sort(visited.begin(), visited.end());
+    EXPECT_EQ(visited, expected);
+
+    std::array<T, 16> out;
+    size_t size = divisors(factorization, std::span<T>(out), /*sorted=*/true);
+    EXPECT_EQ(std::vector<T>(out.begin(), out.begin() + size), expected);
+  }
+}
+
+TEST(DivisorTest, SmallNumbers) {
+  test_divisors<int8_t>();
+  test_divisors<int16_t>();
+  test_divisors<int32_t>();
+  test_divisors<int64_t>();
+  test_divisors<uint8_t>();
+  test_divisors<uint16_t>();
+  test_divisors<uint32_t>();
+  test_divisors<uint64_t>();
+}
+
+TEST(DivisorTest, LargeNumbers) {
+  // 2^4 * 3^2 * 5 * 7 * 11 * 13 * 17 * 19 * 23 * 29 * 31 * 37 * 41 * 43
+  uint64_t number = uint64_t(13082761331670030) * 24;
+  Factorization<uint64_t> factorization = factorize(number);
+  EXPECT_EQ(num_divisors(factorization), 15u * 4096);
+  std::vector<uint64_t> out(num_divisors(factorization));
+  EXPECT_EQ(divisors(factorization, std::span<uint64_t>(out), true),
+            out.size());
+  EXPECT_TRUE(std::is_sorted(out.begin(), out.end()));
+  EXPECT_EQ(out.front(), 1u);
+  EXPECT_EQ(out.back(), number);
+  for (uint64_t d : out)
+    ASSERT_EQ(number % d, 0u);
+
+  EXPECT_EQ(sum_divisors(factorize(uint64_t(999999937) * 999999929)),
+            uint64_t(999999937 + 1) * (999999929 + 1));
+  EXPECT_EQ(sum_divisors(factorize(uint64_t(1) << 63)),
+            std::numeric_limits<uint64_t>::max());
+  EXPECT_THROW(sum_divisors(factorize(uint64_t(3) << 62)),
+               std::overflow_error);
+  std::array<uint64_t, 3> short_out;
+  EXPECT_THROW(
+      divisors(factorize(uint64_t(12)), std::span<uint64_t>(short_out)),
+      std::length_error);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,371 @@
+#ifndef NUMBER_THEORY_ECM_H_
+#define NUMBER_THEORY_ECM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "number_theory/montgomery.h"
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+
+// Lenstra's elliptic curve method (ECM) of factorization.
+
+namespace tql {
+namespace number_theory {
+
+namespace ecm_internal {
+
+// The giant step of stage 2. The baby steps are the odd multiples i of the
+// point for i < kGiantStep / 2, so that each prime q is covered by the pair
+// (j, i) with q = j * kGiantStep +- i.
+inline constexpr uint64_t kGiantStep = 2 * 3 * 5 * 7 * 11;
+inline constexpr size_t kNumBabySteps = kGiantStep / 4;
+// Stage 2 covers the primes up to kStage2Ratio times the stage 1 bound.
+inline constexpr uint64_t kStage2Ratio = 100;
+
+// The precomputed work of a bound |b1|, shared by all curves and moduli.
+struct Plan {
+  explicit Plan(uint64_t b1);
+
+  uint64_t b1;
+  // The product of the largest powers of the primes up to b1 which do not
+  // exceed b1, as little-endian 64-bit words.
+  std::vector<uint64_t> multiplier;
+  // The first giant step j. Giant step first_giant + k pairs with the baby
+  // steps babies[offsets[k]], ..., babies[offsets[k + 1] - 1], where a baby
+  // step i is stored as i / 2.
+  uint64_t first_giant = 1;
+  std::vector<uint32_t> offsets;
+  std::vector<uint16_t> babies;
+};
+
+inline Plan::Plan(uint64_t b1) : b1(b1), multiplier{1} {
+  uint64_t b2 = b1 * kStage2Ratio;
+  Sieve<uint64_t> sieve(b2);
+
+  // Multiplies the multiplier by the word |factor|.
+  auto multiply = [this](uint64_t factor) {
+    uint64_t carry = 0;
+    for (uint64_t &word : multiplier) {
+      unsigned __int128 product =
+          static_cast<unsigned __int128>(word) * factor + carry;
+      word = static_cast<uint64_t>(product);
+      carry = static_cast<uint64_t>(product >> 64);
+    }
+    if (carry != 0)
+      multiplier.push_back(carry);
+  };
+  // Collects several prime powers in a word before a multiplication.
+  uint64_t word = 1;
+  for (uint64_t p = 2; p <= b1; ++p) {
+    if (!sieve.is_prime(p))
+      continue;
+    uint64_t power = p;
+    while (power <= b1 / p)
+      power *= p;
+    if (word > std::numeric_limits<uint64_t>::max() / power) {
+      multiply(word);
+      word = 1;
+    }
+    word *= power;
+  }
+  multiply(word);
+
+  // The primes in (b1, b2], grouped by their giant steps. A baby step which
+  // covers both j * kGiantStep - i and j * kGiantStep + i is stored once.
+  uint64_t first = std::max(b1, kGiantStep / 2) + 1;
+  first_giant = (first + kGiantStep / 2) / kGiantStep;
+  uint64_t last_giant = (b2 + kGiantStep / 2) / kGiantStep;
+  std::vector<bool> covered(kNumBabySteps);
+  for (uint64_t j = first_giant; j <= last_giant; ++j) {
+    offsets.push_back(babies.size());
+    std::fill(covered.begin(), covered.end(), false);
+    uint64_t center = j * kGiantStep;
+    for (uint64_t i = 1; i < kGiantStep / 2; i += 2) {
+      for (uint64_t q : {center - i, center + i}) {
+        if (q >= first && q <= b2 && sieve.is_prime(q))
+          covered[i / 2] = true;
+      }
+    }
+    for (size_t i = 0; i < kNumBabySteps; ++i) {
+      if (covered[i])
+        babies.push_back(static_cast<uint16_t>(i));
+    }
+  }
+  offsets.push_back(babies.size());
+}
+
+// A point (x : z) on a Montgomery curve b y^2 = x^3 + a x^2 + x, without the
+// y coordinate, with x and z in the Montgomery form.
+template <typename U>
+struct Point {
+  U x;
+  U z;
+};
+
+// A Montgomery curve with (a + 2) / 4 = |numerator| / |denominator|, which is
+// kept as a fraction so that no modular inverse is needed.
+template <typename U>
+class Curve {
+ public:
+  Curve(const Montgomery<U> &montgomery, U numerator, U denominator)
+      : montgomery_(montgomery),
+        numerator_(numerator),
+        denominator_(denominator) {}
+
+  // Returns 2 |p|.
+  Point<U> twice(const Point<U> &p) const {
+    const Montgomery<U> &m = montgomery_;
+    U sum = m.add(p.x, p.z);
+    U difference = m.subtract(p.x, p.z);
+    U sum2 = m.multiply(sum, sum);
+    U difference2 = m.multiply(difference, difference);
+    // 4 x z
+    U product = m.subtract(sum2, difference2);
+    U scaled = m.multiply(denominator_, difference2);
+    return {m.multiply(sum2, scaled),
+            m.multiply(product,
+                       m.add(scaled, m.multiply(numerator_, product)))};
+  }
+
+  // Returns |p| + |q|, where |difference| is |p| - |q|.
+  Point<U> sum(const Point<U> &p,
+               const Point<U> &q,
+               const Point<U> &difference) const {
+    const Montgomery<U> &m = montgomery_;
+    U u = m.multiply(m.subtract(p.x, p.z), m.add(q.x, q.z));
+    U v = m.multiply(m.add(p.x, p.z), m.subtract(q.x, q.z));
+    U plus = m.add(u, v);
+    U minus = m.subtract(u, v);
+    return {m.multiply(difference.z, m.multiply(plus, plus)),
+            m.multiply(difference.x, m.multiply(minus, minus))};
+  }
+
+  // Returns k |p| and (k + 1) |p| with the Montgomery ladder, where k > 0 is
+  // given by the little-endian 64-bit words |scalar|.
+  std::pair<Point<U>, Point<U>> ladder(
+      const Point<U> &p,
+      std::span<const uint64_t> scalar) const {
+    size_t size = scalar.size();
+    while (scalar[size - 1] == 0)
+      --size;
+    int top = 63 - std::countl_zero(scalar[size - 1]);
+    Point<U> low = p, high = twice(p);
+    for (size_t w = size; w-- > 0;) {
+      for (int b = (w + 1 == size ? top : 64) - 1; b >= 0; --b) {
+        if ((scalar[w] >> b) & 1) {
+          low = sum(high, low, p);
+          high = twice(high);
+        } else {
+          high = sum(high, low, p);
+          low = twice(low);
+        }
+      }
+    }
+    return {low, high};
+  }
+
+ private:
+  const Montgomery<U> &montgomery_;
+  U numerator_;
+  U denominator_;
+};
+
+// Runs stage 1 and stage 2 of |plan| on the curve with Suyama's parameter
+// |sigma| > 5 modulo the odd modulus n of |montgomery|. Returns a factor of n,
+// which is n itself if the curve fails. If |stop| is set by another thread,
+// the curve gives up at the next giant step.
+template <typename U>
+U run_curve(const Montgomery<U> &montgomery,
+            const Plan &plan,
+            uint64_t sigma,
+            const std::atomic<bool> *stop = nullptr) {
+  const Montgomery<U> &m = montgomery;
+  U n = m.modulus();
+  auto result = [n](U divisor) { return divisor == 1 ? n : divisor; };
+
+  // Suyama's parametrization gives a curve whose group order is divisible by
+  // 12: with u = sigma^2 - 5 and v = 4 sigma, the point is (u^3 : v^3) and
+  // (a + 2) / 4 = (v - u)^3 (3 u + v) / (16 u^3 v).
+  U s = m.to(sigma);
+  U u = m.subtract(m.multiply(s, s), m.to(5));
+  U v = m.add(m.add(s, s), m.add(s, s));
+  U u3 = m.multiply(m.multiply(u, u), u);
+  U v3 = m.multiply(m.multiply(v, v), v);
+  U v_u = m.subtract(v, u);
+  U numerator = m.multiply(m.multiply(m.multiply(v_u, v_u), v_u),
+                           m.add(m.add(m.add(u, u), u), v));
+  U denominator = m.multiply(m.multiply(m.to(16), u3), v);
+  // A factor shared with the denominator makes the curve degenerate.
+  if (U divisor = std::gcd(denominator, n); divisor != 1)
+    return divisor;
+  Curve<U> curve(m, numerator, denominator);
+
+  // Stage 1: the group order is smooth up to b1.
+  Point<U> q = curve.ladder({u3, v3}, plan.multiplier).first;
+  if (U divisor = std::gcd(q.z, n); divisor != 1)
+    return divisor;
+
+  // Stage 2: the group order has one more prime in (b1, b2]. Then
+  // (j kGiantStep) q = +-i q for some pair, so their x coordinates agree.
+  std::vector<Point<U>> babies(kNumBabySteps);
+  Point<U> q2 = curve.twice(q);
+  babies[0] = q;
+  babies[1] = curve.sum(q2, q, q);
+  for (size_t i = 2; i < kNumBabySteps; ++i)
+    babies[i] = curve.sum(babies[i - 1], q2, babies[i - 2]);
+
+  const uint64_t giant_step[] = {kGiantStep};
+  Point<U> giant = curve.ladder(q, giant_step).first;
+  const uint64_t first_giant[] = {plan.first_giant};
+  auto [current, next] = curve.ladder(giant, first_giant);
+  U product = m.one();
+  for (size_t k = 0; k + 1 < plan.offsets.size(); ++k) {
+    if (stop != nullptr && stop->load(std::memory_order_relaxed))
+      return n;
+    for (uint32_t b = plan.offsets[k]; b < plan.offsets[k + 1]; ++b) {
+      const Point<U> &baby = babies[plan.babies[b]];
+      product = m.multiply(product, m.subtract(m.multiply(current.x, baby.z),
+                                               m.multiply(baby.x, current.z)));
+    }
+    Point<U> after = curve.sum(next, giant, current);
+    current = next;
+    next = after;
+  }
+  return result(std::gcd(product, n));
+}
+
+// Runs the curves with parameters |first_sigma|, ..., |first_sigma| +
+// |num_curves| - 1. Returns a non-trivial factor of the odd modulus n of
+// |montgomery|, or n if all curves fail.
+template <typename U>
+U find_factor(const Montgomery<U> &montgomery,
+              const Plan &plan,
+              size_t num_curves,
+              uint64_t first_sigma) {
+  U n = montgomery.modulus();
+  for (size_t i = 0; i < num_curves; ++i) {
+    U divisor = run_curve(montgomery, plan, first_sigma + i);
+    if (divisor != n)
+      return divisor;
+  }
+  return n;
+}
+
+// Parallel version of find_factor, which runs the curves as tasks on |pool|.
+// The curve finding a factor first stops the others.
+template <typename U>
+U find_factor(const Montgomery<U> &montgomery,
+              const Plan &plan,
+              size_t num_curves,
+              uint64_t first_sigma,
+              ThreadPool &pool) {
+  U n = montgomery.modulus();
+  std::atomic<bool> found = false;
+  U factor = n;
+  TaskGroup group(pool);
+  for (size_t i = 0; i < num_curves; ++i) {
+    group.run([&, i]() {
+      if (found.load(std::memory_order_relaxed))
+        return;
+      U divisor = run_curve(montgomery, plan, first_sigma + i, &found);
+      if (divisor != n && !found.exchange(true, std::memory_order_relaxed))
+        factor = divisor;
+    });
+  }
+  group.wait();
+  return factor;
+}
+
+// The bounds and the numbers of curves which find most prime factors up to
+// a number of decimal digits, from the tables of GMP-ECM.
+struct Level {
+  uint64_t b1;
+  size_t num_curves;
+};
+inline constexpr Level kLevels[] = {
+    {2000, 25},    // 15 digits
+    {11000, 90},   // 20 digits
+    {50000, 300},  // 25 digits
+};
+
+// Returns the plan of kLevels[|level|], which is built on first use.
+template <size_t level>
+const Plan &level_plan() {
+  static const Plan plan(kLevels[level].b1);
+  return plan;
+}
+
+// Calls |function|(level, plan) for each of the first |num_levels| levels
+// until it returns true.
+template <typename Function>
+bool for_each_level(size_t num_levels, Function function) {
+  return [&]<size_t... level>(std::index_sequence<level...>) {
+    return ((level < num_levels &&
+             function(kLevels[level], level_plan<level>())) ||
+            ...);
+  }(std::make_index_sequence<std::size(kLevels)>());
+}
+
+// Converts the odd number |n| > 1 to the unsigned type of its width.
+template <typename T>
+auto to_modulus(const T &n) {
+  if (n < 3 || n % 2 == 0)
+    throw std::domain_error("ECM requires an odd number above 2.");
+  using U = std::conditional_t<(std::numeric_limits<T>::digits > 64),
+                               unsigned __int128, uint64_t>;
+  return static_cast<U>(n);
+}
+
+}  // namespace ecm_internal
+
+// Returns a non-trivial factor of the odd |n| found by the elliptic curve
+// method with |num_curves| curves, or |n| itself if no curve finds one.
+// Stage 1 multiplies a random point by the prime powers up to |b1|, and
+// stage 2 looks for one more prime up to 100 * |b1| with baby and giant steps.
+// A prime factor p is likely found when |b1| is about exp(sqrt(log p log log
+// p / 2)), which makes the method faster than Pollard's rho for factors above
+// about 2^40.
+// Throws domain_error exception if |n| is even or below 3.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 128, bool> = true>
+T ecm_find_factor(const T &n, uint64_t b1, size_t num_curves) {
+  auto modulus = ecm_internal::to_modulus(n);
+  Montgomery<decltype(modulus)> montgomery(modulus);
+  ecm_internal::Plan plan(b1);
+  return static_cast<T>(ecm_internal::find_factor(montgomery, plan,
+                                                  num_curves, 6));
+}
+
+// Parallel version of ecm_find_factor, which runs the curves on |pool|.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 128, bool> = true>
+T ecm_find_factor(const T &n,
+                  uint64_t b1,
+                  size_t num_curves,
+                  ThreadPool &pool) {
+  auto modulus = ecm_internal::to_modulus(n);
+  Montgomery<decltype(modulus)> montgomery(modulus);
+  ecm_internal::Plan plan(b1);
+  return static_cast<T>(ecm_internal::find_factor(montgomery, plan,
+                                                  num_curves, 6, pool));
+}
+
+}  // namespace number_theory
+
+using number_theory::ecm_find_factor;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_ECM_H_
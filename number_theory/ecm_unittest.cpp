@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/ecm.h"
+
+namespace tql::number_theory {
+
+TEST(EcmTest, Plan) {
+  ecm_internal::Plan plan(2000);
+  // 2^10 * 3^6 * 5^4 * ... has about 1.44 * 2000 bits.
+  EXPECT_EQ(plan.multiplier.size(), 45u);
+  EXPECT_EQ(plan.multiplier[0] % 1024, 0u);
+  EXPECT_NE(plan.multiplier[0] % 2048, 0u);
+  EXPECT_EQ(plan.first_giant, 1u);
+  // Each prime in (2000, 200000] is covered once or shares a pair.
+  EXPECT_EQ(plan.offsets.size(), 200000 / ecm_internal::kGiantStep + 2);
+  EXPECT_GT(plan.babies.size(), 10000u);
+  EXPECT_LT(plan.babies.size(), 17700u);
+}
+
+TEST(EcmTest, FindFactor) {
+  using u128 = unsigned __int128;
+  uint64_t n64 = uint64_t(681143423) * 4294967291;
+  uint64_t factor64 = ecm_find_factor(n64, 2000, 100);
+  EXPECT_TRUE(factor64 == 681143423 || factor64 == 4294967291);
+
+  u128 p = 681143423, q = 27204228634625293;
+  u128 factor = ecm_find_factor(p * q, 2000, 100);
+  EXPECT_TRUE(factor == p || factor == q);
+  // A prime has no factor to find.
+  EXPECT_EQ(ecm_find_factor(q, 2000, 3), q);
+
+  EXPECT_THROW(ecm_find_factor(uint64_t(100), 2000, 1), std::domain_error);
+  EXPECT_THROW(ecm_find_factor(1, 2000, 1), std::domain_error);
+}
+
+TEST(EcmTest, FindFactorParallel) {
+  using u128 = unsigned __int128;
+  ThreadPool pool(3);
+  u128 p = 859933207772791, q = 27204228634625293;
+  u128 factor = ecm_find_factor(p * q, 2000, 200, pool);
+  EXPECT_TRUE(factor == p || factor == q);
+}
+
+}  // namespace tql::number_theory
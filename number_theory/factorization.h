@@ -0,0 +1,569 @@
+#ifndef NUMBER_THEORY_FACTORIZATION_H_
+#define NUMBER_THEORY_FACTORIZATION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "number_theory/ecm.h"
+#include "number_theory/montgomery.h"
+#include "number_theory/prime.h"
+#include "number_theory/sieve.h"
+#include "number_theory/siqs.h"
+#include "number_theory/thread_pool.h"
+#include "number_theory/utility.h"
+
+// Prime factorization of integers.
+
+namespace tql {
+namespace number_theory {
+
+// A prime power prime^exponent in a factorization.
+template <typename T>
+struct PrimePower {
+  T prime;
+  int exponent;
+
+  friend bool operator==(const PrimePower &, const PrimePower &) = default;
+};
+
+namespace factorization_internal {
+
+// Returns the maximum number of distinct prime factors of a number of type T,
+// which is the number of primes whose product (the primorial) fits in T.
+template <typename T>
+constexpr size_t max_num_primes() {
+  using Unsigned_T = std::make_unsigned_t<T>;
+  Unsigned_T limit = std::numeric_limits<T>::max();
+  Unsigned_T product = 1;
+  size_t count = 0;
+  for (Unsigned_T p = 2;; ++p) {
+    bool p_is_prime = true;
+    for (Unsigned_T d = 2; d * d <= p; ++d) {
+      if (p % d == 0)
+        p_is_prime = false;
+    }
+    if (!p_is_prime)
+      continue;
+    if (product > limit / p)
+      return count;
+    product *= p;
+    ++count;
+  }
+}
+
+}  // namespace factorization_internal
+
+// The prime factorization of a positive integer, as a list of prime powers in
+// increasing order of the primes. The prime powers are stored inline, so a
+// factorization never allocates memory.
+template <typename T>
+class Factorization {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "Factorization must use integer types.");
+
+ public:
+  // The type of numbers in the factorization.
+  using type = T;
+  using value_type = PrimePower<T>;
+  using const_iterator = const PrimePower<T> *;
+
+  // The maximum number of distinct prime factors of a number of type T.
+  static constexpr size_t kMaxPrimes =
+      factorization_internal::max_num_primes<T>();
+
+  // Constructs the factorization of 1.
+  Factorization() = default;
+
+  Factorization(const Factorization &) = default;
+  Factorization(Factorization &&) = default;
+  Factorization &operator=(const Factorization &) = default;
+  Factorization &operator=(Factorization &&) = default;
+
+  // Multiplies the factorization by |prime|^|exponent|.
+  // Throws length_error exception if there are too many distinct primes.
+  void multiply(const T &prime, int exponent = 1) {
+    PrimePower<T> *end = factors_.data() + size_;
+    PrimePower<T> *position =
+        std::lower_bound(factors_.data(), end, prime,
+                         [](const PrimePower<T> &factor, const T &p) {
+                           return factor.prime < p;
+                         });
+    if (position != end && position->prime == prime) {
+      position->exponent += exponent;
+      return;
+    }
+    if (size_ == kMaxPrimes)
+      throw std::length_error("Too many prime factors in Factorization.");
+    std::move_backward(position, end, end + 1);
+    *position = {prime, exponent};
+    ++size_;
+  }
+
+  // Returns the number of distinct prime factors.
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const PrimePower<T> &operator[](size_t index) const {
+    return factors_[index];
+  }
+  const_iterator begin() const { return factors_.data(); }
+  const_iterator end() const { return factors_.data() + size_; }
+
+  // Returns the factorized number.
+  T value() const {
+    T result = 1;
+    for (const auto &[prime, exponent] : *this) {
+      for (int i = 0; i < exponent; ++i)
+        result *= prime;
+    }
+    return result;
+  }
+
+  friend bool operator==(const Factorization &lhs, const Factorization &rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+ private:
+  std::array<PrimePower<T>, kMaxPrimes> factors_{};
+  size_t size_ = 0;
+};
+
+namespace factorization_internal {
+
+// Primes used for trial division before Pollard's rho algorithm.
+inline constexpr uint64_t kSmallPrimes[] = {
+    3,  5,  7,  11, 13, 17, 19, 23, 29, 31, 37, 41, 43,
+    47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97};
+// Numbers without prime factors up to kSmallPrimes are prime below this.
+inline constexpr uint64_t kTrialDivisionLimit = 101 * 101;
+
+// Number of steps between two gcd computations in pollard_rho.
+inline constexpr uint64_t kRhoBatchSize = 128;
+
+// Composites from this size are split with parallel walks by the parallel
+// factorize. Smaller ones are split faster than a task is scheduled.
+inline constexpr uint64_t kParallelRhoThreshold = uint64_t(1) << 48;
+
+// Composites above 2^64 are first walked this many rho steps, which find most
+// factors below 2^40, and then split with ECM.
+inline constexpr uint64_t kRhoStepsBeforeEcm = uint64_t(1) << 20;
+
+// Composites from this size are split with the quadratic sieve after the
+// first ECM level, because their smallest factor is likely too large for ECM.
+inline constexpr unsigned __int128 kSiqsThreshold =
+    static_cast<unsigned __int128>(1) << 100;
+
+// Returns |x - y| without a branch, which would be mispredicted at random.
+template <typename U>
+constexpr U absolute_difference(U x, U y) {
+  U mask = 0 - static_cast<U>(x < y);
+  return ((x - y) ^ mask) - mask;
+}
+
+// Pollard's rho algorithm with Brent's cycle detection, iterating
+// x -> x^2 + |c| from |x0| (both in the Montgomery form) modulo the odd
+// composite modulus of |montgomery|. The differences are multiplied together,
+// so a gcd is only computed every kRhoBatchSize steps.
+// Returns a non-trivial factor, or the modulus itself if the walk fails. If
+// |stop| is set by another thread, or after about |max_steps| steps, the walk
+// gives up at the next gcd.
+template <typename U>
+U pollard_rho(const Montgomery<U> &montgomery,
+              U c,
+              U x0,
+              const std::atomic<bool> *stop = nullptr,
+              uint64_t max_steps = std::numeric_limits<uint64_t>::max()) {
+  U n = montgomery.modulus();
+  auto step = [&montgomery, c](U x) {
+    return montgomery.add(montgomery.multiply(x, x), c);
+  };
+  auto distance = [](U x, U y) { return absolute_difference(x, y); };
+
+  U x = x0, y = x0, saved_y = x0;
+  U product = montgomery.one();
+  U divisor = 1;
+  for (uint64_t length = 1; divisor == 1; length *= 2) {
+    // A round takes 2 * length steps.
+    if (length > max_steps / 2)
+      return n;
+    x = y;
+    for (uint64_t i = 0; i < length; ++i)
+      y = step(y);
+    for (uint64_t k = 0; k < length && divisor == 1; k += kRhoBatchSize) {
+      if (stop != nullptr && stop->load(std::memory_order_relaxed))
+        return n;
+      saved_y = y;
+      uint64_t batch = std::min(kRhoBatchSize, length - k);
+      for (uint64_t i = 0; i < batch; ++i) {
+        y = step(y);
+        product = montgomery.multiply(product, distance(x, y));
+      }
+      divisor = std::gcd(product, n);
+    }
+  }
+  if (divisor == n) {
+    // The product of the last batch is a multiple of n. Redo the batch one
+    // step at a time.
+    do {
+      saved_y = step(saved_y);
+      divisor = std::gcd(distance(x, saved_y), n);
+    } while (divisor == 1);
+  }
+  return divisor;
+}
+
+// Returns a non-trivial factor of the odd composite number |n|.
+//
+// Numbers below 2^64 use Pollard's rho algorithm with the faster 64-bit
+// arithmetic. Larger ones are walked kRhoStepsBeforeEcm rho steps, and then
+// split with ECM on the curves of the ECM levels. From kSiqsThreshold, the
+// quadratic sieve replaces the ECM levels after the first. Pollard's rho
+// algorithm without a limit is the last resort.
+template <typename U>
+U find_factor(U n) {
+  if constexpr (std::numeric_limits<U>::digits > 64) {
+    if (n <= std::numeric_limits<uint64_t>::max())
+      return find_factor(static_cast<uint64_t>(n));
+  }
+  Montgomery<U> montgomery(n);
+  U c = 1;
+  if constexpr (std::numeric_limits<U>::digits > 64) {
+    U divisor = pollard_rho(montgomery, montgomery.to(c), montgomery.to(c + 1),
+                            nullptr, kRhoStepsBeforeEcm);
+    ++c;
+    if (divisor != n)
+      return divisor;
+    bool use_siqs = n >= kSiqsThreshold;
+    uint64_t sigma = 6;
+    bool found = ecm_internal::for_each_level(
+        use_siqs ? 1 : std::size(ecm_internal::kLevels),
+        [&](const ecm_internal::Level &level, const ecm_internal::Plan &plan) {
+          divisor = ecm_internal::find_factor(montgomery, plan,
+                                              level.num_curves, sigma);
+          sigma += level.num_curves;
+          return divisor != n;
+        });
+    if (found)
+      return divisor;
+    if (use_siqs) {
+      divisor = static_cast<U>(siqs_find_factor(n));
+      if (divisor != n)
+        return divisor;
+    }
+  }
+  for (;; ++c) {
+    U divisor =
+        pollard_rho(montgomery, montgomery.to(c), montgomery.to(c + 1));
+    if (divisor != n)
+      return divisor;
+  }
+}
+
+// Returns a non-trivial factor of the odd composite number |n| with
+// |num_walks| independent walks on |pool|. The walk finding a factor first
+// stops the others. Numbers above 2^64 are split like find_factor does, with
+// the walks and the ECM curves run in parallel.
+template <typename U>
+U find_factor_parallel(U n, size_t num_walks, ThreadPool &pool) {
+  if (n < kParallelRhoThreshold || num_walks <= 1)
+    return find_factor(n);
+  // Walk i tries the constants i + 1, i + 1 + num_walks, ...
+  auto walk = [n, num_walks](const auto &montgomery, size_t index,
+                             uint64_t max_steps, std::atomic<bool> &found,
+                             U &factor) {
+    using V = typename std::decay_t<decltype(montgomery)>::type;
+    for (V c = index + 1; !found.load(std::memory_order_relaxed);
+         c += num_walks) {
+      V divisor = pollard_rho(montgomery, montgomery.to(c),
+                              montgomery.to(c + 1), &found, max_steps);
+      if (divisor != n) {
+        if (!found.exchange(true, std::memory_order_relaxed))
+          factor = divisor;
+        return;
+      }
+      if (max_steps != std::numeric_limits<uint64_t>::max())
+        return;
+    }
+  };
+  auto walks = [&](const auto &montgomery, uint64_t max_steps) {
+    std::atomic<bool> found = false;
+    U factor = n;
+    TaskGroup group(pool);
+    for (size_t i = 0; i < num_walks; ++i)
+      group.run([&, i]() { walk(montgomery, i, max_steps, found, factor); });
+    group.wait();
+    return factor;
+  };
+  if (n <= std::numeric_limits<uint64_t>::max()) {
+    return walks(Montgomery<uint64_t>(static_cast<uint64_t>(n)),
+                 std::numeric_limits<uint64_t>::max());
+  }
+  Montgomery<U> montgomery(n);
+  U divisor = walks(montgomery, kRhoStepsBeforeEcm);
+  if (divisor != n)
+    return divisor;
+  bool use_siqs = n >= kSiqsThreshold;
+  uint64_t sigma = 6;
+  bool found = ecm_internal::for_each_level(
+      use_siqs ? 1 : std::size(ecm_internal::kLevels),
+      [&](const ecm_internal::Level &level, const ecm_internal::Plan &plan) {
+        divisor = ecm_internal::find_factor(montgomery, plan,
+                                            level.num_curves, sigma, pool);
+        sigma += level.num_curves;
+        return divisor != n;
+      });
+  if (found)
+    return divisor;
+  if (use_siqs) {
+    divisor = static_cast<U>(siqs_find_factor(n, pool));
+    if (divisor != n)
+      return divisor;
+  }
+  return walks(montgomery, std::numeric_limits<uint64_t>::max());
+}
+
+// Calls |callback|(prime, exponent) for the prime factors of |n| > 0, not
+// necessarily in order. The same prime may be reported more than once.
+// The composites left after trial division are split with
+// |find_factor|(composite).
+template <typename U, typename FindFactor, typename Callback>
+void factorize_unsigned(U n, FindFactor find_factor, Callback callback) {
+  if (int twos = std::countr_zero(n); twos != 0) {
+    callback(U(2), twos);
+    n >>= twos;
+  }
+  for (uint64_t p : kSmallPrimes) {
+    if (p * p > n)
+      break;
+    int exponent = 0;
+    while (n % p == 0) {
+      n /= p;
+      ++exponent;
+    }
+    if (exponent != 0)
+      callback(U(p), exponent);
+  }
+  if (n == 1)
+    return;
+  if (n < kTrialDivisionLimit) {
+    callback(n, 1);
+    return;
+  }
+
+  // Split the remaining composites with Pollard's rho algorithm.
+  std::array<U, std::numeric_limits<U>::digits> stack;
+  size_t size = 0;
+  stack[size++] = n;
+  while (size != 0) {
+    U m = stack[--size];
+    if (prime_internal::is_prime_u128(m)) {
+      callback(m, 1);
+      continue;
+    }
+    U divisor = find_factor(m);
+    stack[size++] = divisor;
+    stack[size++] = m / divisor;
+  }
+}
+
+// Returns the prime factorization of the positive |number|, splitting the
+// composites with |find_factor|.
+template <typename T, typename FindFactor>
+Factorization<T> factorize(const T &number, FindFactor find_factor) {
+  using U = std::conditional_t<(std::numeric_limits<T>::digits > 64),
+                               unsigned __int128, uint64_t>;
+  if (number <= 0)
+    throw std::domain_error("Only positive numbers can be factorized.");
+  Factorization<T> factorization;
+  factorize_unsigned(static_cast<U>(number), find_factor,
+                     [&factorization](U prime, int exponent) {
+                       factorization.multiply(static_cast<T>(prime), exponent);
+                     });
+  return factorization;
+}
+
+}  // namespace factorization_internal
+
+// Returns the prime factorization of |number| with trial division by small
+// primes and Pollard's rho algorithm. The expected time complexity is
+// O(|number|^(1/4)) multiplications. Composites above 2^64 whose factors
+// escape a short rho walk are split with the elliptic curve method, or the
+// quadratic sieve from 2^100, so that factors around 2^64 take seconds
+// instead of hours.
+// Throws domain_error exception if |number| is not positive.
+//
+// This overload is only available for numbers below 2^128. The primality of
+// factors above 3.3 * 10^24 is tested with the Baillie-PSW test.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 128, bool> = true>
+Factorization<T> factorize(const T &number) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "factorize argument |number| must be an integer.");
+  using U = std::conditional_t<(std::numeric_limits<T>::digits > 64),
+                               unsigned __int128, uint64_t>;
+  return factorization_internal::factorize(
+      number, factorization_internal::find_factor<U>);
+}
+
+// Parallel version of factorize, which splits each large composite with
+// |num_walks| independent rho walks on |pool|. The first walk to find a
+// factor stops the others, which cuts the latency tail of hard semiprimes.
+// If |num_walks| is zero, one walk per thread of |pool| is used.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 128, bool> = true>
+Factorization<T> factorize(const T &number,
+                           ThreadPool &pool,
+                           size_t num_walks = 0) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "factorize argument |number| must be an integer.");
+  using U = std::conditional_t<(std::numeric_limits<T>::digits > 64),
+                               unsigned __int128, uint64_t>;
+  if (num_walks == 0)
+    num_walks = pool.num_threads();
+  return factorization_internal::factorize(
+      number, [num_walks, &pool](U composite) {
+        return factorization_internal::find_factor_parallel(composite,
+                                                            num_walks, pool);
+      });
+}
+
+// Factorizes a batch of |numbers| into |results| on |pool|, distributing the
+// numbers across the threads. Each number is factorized by a single thread,
+// which gives the best throughput for large batches.
+// Throws invalid_argument exception if the sizes of the batch mismatch.
+template <typename T>
+void factorize_many(std::span<const T> numbers,
+                    std::span<Factorization<T>> results,
+                    ThreadPool &pool = ThreadPool::global()) {
+  sieve_internal::check_batch_size(numbers.size(), results.size());
+  // A few chunks per thread balance the load without a task per number.
+  size_t num_chunks = std::min(numbers.size(), pool.num_threads() * 4);
+  pool.parallel_for(0, num_chunks, [&](size_t chunk) {
+    size_t begin = numbers.size() * chunk / num_chunks;
+    size_t end = numbers.size() * (chunk + 1) / num_chunks;
+    for (size_t i = begin; i < end; ++i)
+      results[i] = factorize(numbers[i]);
+  });
+}
+
+// Returns the prime factorization of |number| with the table of minimum prime
+// factors of an EulerSieve, in O(log |number|) time.
+// Throws domain_error exception if |number| is not positive, and
+// out_of_range exception if it exceeds the limit of the table.
+template <typename T>
+Factorization<T> factorize(
+    const T &number,
+    const std::type_identity_t<FactorTableView<T>> &table) {
+  if (number <= 0)
+    throw std::domain_error("Only positive numbers can be factorized.");
+  if (number > table.get_limit())
+    throw std::out_of_range("The number exceeds the limit of Sieve.");
+  Factorization<T> factorization;
+  std::span<const T> min_prime_factor = table.min_prime_factors();
+  T remaining = number;
+  while (remaining > 1) {
+    T prime = min_prime_factor[remaining];
+    int exponent = 0;
+    do {
+      remaining /= prime;
+      ++exponent;
+    } while (remaining % prime == 0);
+    factorization.multiply(prime, exponent);
+  }
+  return factorization;
+}
+
+// A factorization backend, which looks up a table of minimum prime factors
+// for numbers up to the limit of the table, and uses Pollard's rho algorithm
+// for larger numbers or when there is no table.
+//
+// It can also memoize the factorizations of the most recently used numbers
+// in an LRU cache of |memo_capacity| entries, which pays off when the same
+// arguments repeat. A Factorizer with a memo is not thread-safe, while one
+// without a memo can be shared by threads.
+template <typename T>
+class Factorizer {
+  static_assert(std::numeric_limits<T>::is_integer &&
+                    std::numeric_limits<T>::digits <= 64,
+                "Factorizer must use integer types up to 64 bits.");
+
+ public:
+  // The type of numbers used by the Factorizer.
+  using type = T;
+
+  // Constructs a Factorizer without a table.
+  explicit Factorizer(size_t memo_capacity = 0)
+      : memo_capacity_(memo_capacity) {}
+
+  // Constructs a Factorizer with a table, which must outlive the Factorizer.
+  explicit Factorizer(const FactorTableView<T> &table,
+                      size_t memo_capacity = 0)
+      : table_(table), memo_capacity_(memo_capacity) {}
+
+  // The memo refers to its own entries, so it is movable but not copyable.
+  Factorizer(const Factorizer &) = delete;
+  Factorizer(Factorizer &&) = default;
+  Factorizer &operator=(const Factorizer &) = delete;
+  Factorizer &operator=(Factorizer &&) = default;
+
+  // Returns the prime factorization of |number|.
+  // Throws domain_error exception if |number| is not positive.
+  Factorization<T> factorize(const T &number) {
+    if (memo_capacity_ == 0)
+      return compute(number);
+    if (auto it = memo_index_.find(number); it != memo_index_.end()) {
+      // Move the entry to the front as the most recently used one.
+      memo_.splice(memo_.begin(), memo_, it->second);
+      return it->second->second;
+    }
+    Factorization<T> factorization = compute(number);
+    if (memo_.size() == memo_capacity_) {
+      memo_index_.erase(memo_.back().first);
+      memo_.pop_back();
+    }
+    memo_.emplace_front(number, factorization);
+    memo_index_.emplace(number, memo_.begin());
+    return factorization;
+  }
+
+ private:
+  using MemoList = std::list<std::pair<T, Factorization<T>>>;
+
+  std::optional<FactorTableView<T>> table_;
+  size_t memo_capacity_;
+  // The memoized factorizations from the most recently used to the least.
+  MemoList memo_;
+  std::unordered_map<T, typename MemoList::iterator> memo_index_;
+
+  Factorization<T> compute(const T &number) const {
+    if (table_ && number > 0 && number <= table_->get_limit())
+      return number_theory::factorize(number, *table_);
+    return number_theory::factorize(number);
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::factorize;
+using number_theory::factorize_many;
+using number_theory::Factorization;
+using number_theory::Factorizer;
+using number_theory::PrimePower;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_FACTORIZATION_H_
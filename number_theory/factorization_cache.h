@@ -0,0 +1,309 @@
+#ifndef NUMBER_THEORY_FACTORIZATION_CACHE_H_
+#define NUMBER_THEORY_FACTORIZATION_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "number_theory/factorization.h"
+#include "number_theory/sieve.h"
+
+// A factorization cache shared by threads.
+
+namespace tql {
+namespace number_theory {
+
+namespace factorization_cache_internal {
+
+// Number of slots in a bucket.
+inline constexpr size_t kWays = 4;
+
+// Number of prime words in a slot, which makes a slot one cache line.
+inline constexpr size_t kPrimeWords = 5;
+
+// Bits of an exponent in the packed exponent word. The 4 lowest bits of the
+// word hold the number of distinct primes.
+inline constexpr int kExponentBits = 6;
+
+// Mixes the bits of |x| (the finalizer of MurmurHash3).
+inline uint64_t hash(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51'afd7'ed55'8ccd;
+  x ^= x >> 33;
+  x *= 0xc4ce'b9fe'1a85'ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace factorization_cache_internal
+
+// A bounded, thread-safe cache of factorizations in front of a Factorizer.
+//
+// The cache is split into shards, and each shard is a set-associative hash
+// table of buckets of 4 slots. The factorizations are packed inline in the
+// slots, so an entry never allocates memory. Lookups do not take locks: each
+// slot is guarded by a sequence counter, and a reader retries the lookup as a
+// miss if a writer changed the slot meanwhile. Insertions lock their shard and
+// evict an entry of the bucket with the CLOCK algorithm, which gives a second
+// chance to the entries hit since the hand last passed them.
+//
+// A slot holds at most kInlinePrimes distinct primes. Numbers with more
+// distinct primes are factorized every time without being cached.
+template <typename T>
+class FactorizationCache {
+  static_assert(std::numeric_limits<T>::is_integer &&
+                    std::numeric_limits<T>::digits <= 64,
+                "FactorizationCache must use integer types up to 64 bits.");
+
+ public:
+  // The type of numbers used by the cache.
+  using type = T;
+
+  // Counters of the cache, summed over the shards.
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  // The maximum number of distinct primes of a cached factorization.
+  static constexpr size_t kInlinePrimes =
+      std::min(Factorization<T>::kMaxPrimes,
+               factorization_cache_internal::kPrimeWords * sizeof(uint64_t) /
+                   sizeof(T));
+  static_assert(4 + factorization_cache_internal::kExponentBits *
+                        kInlinePrimes <=
+                    64,
+                "The exponents must fit in a word.");
+
+  // Constructs a cache of at least |capacity| entries, factorizing the numbers
+  // with Pollard's rho algorithm. The cache is split into |num_shards| shards,
+  // rounded up to a power of two. If |num_shards| is zero, four shards per
+  // hardware thread are used.
+  // Throws invalid_argument exception if |capacity| is zero.
+  explicit FactorizationCache(size_t capacity, size_t num_shards = 0)
+      : FactorizationCache(Factorizer<T>(), capacity, num_shards) {}
+
+  // Constructs a cache which factorizes the numbers up to the limit of |table|
+  // with the table. The table must outlive the cache.
+  FactorizationCache(const FactorTableView<T> &table,
+                     size_t capacity,
+                     size_t num_shards = 0)
+      : FactorizationCache(Factorizer<T>(table), capacity, num_shards) {}
+
+  FactorizationCache(const FactorizationCache &) = delete;
+  FactorizationCache &operator=(const FactorizationCache &) = delete;
+
+  // Returns the number of entries the cache can hold.
+  size_t capacity() const {
+    return num_shards_ * num_buckets_ * factorization_cache_internal::kWays;
+  }
+
+  // Returns the prime factorization of |number|, from the cache if possible.
+  // Throws domain_error exception if |number| is not positive.
+  Factorization<T> factorize(const T &number) {
+    if (number <= 0)
+      throw std::domain_error("Only positive numbers can be factorized.");
+    uint64_t key = static_cast<uint64_t>(number);
+    uint64_t hash = factorization_cache_internal::hash(key);
+    Shard &shard = shards_[hash & (num_shards_ - 1)];
+    Bucket &bucket = shard.buckets[(hash >> shard_bits_) % num_buckets_];
+
+    Factorization<T> factorization;
+    for (size_t i = 0; i < factorization_cache_internal::kWays; ++i) {
+      if (load(bucket.slots[i], key, factorization)) {
+        // Avoid writing to the shared cache line if the bit is already set.
+        uint8_t bit = uint8_t(1) << i;
+        if ((bucket.referenced.load(std::memory_order_relaxed) & bit) == 0)
+          bucket.referenced.fetch_or(bit, std::memory_order_relaxed);
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        return factorization;
+      }
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    factorization = factorizer_.factorize(number);
+    if (factorization.size() <= kInlinePrimes)
+      insert(shard, bucket, key, factorization);
+    return factorization;
+  }
+
+  // Returns the counters. The counters of different shards are not read at the
+  // same instant, so the result is approximate while other threads are using
+  // the cache.
+  Stats stats() const {
+    Stats stats;
+    for (size_t i = 0; i < num_shards_; ++i) {
+      stats.hits += shards_[i].hits.load(std::memory_order_relaxed);
+      stats.misses += shards_[i].misses.load(std::memory_order_relaxed);
+      stats.evictions += shards_[i].evictions.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+ private:
+  using Unsigned_T = std::make_unsigned_t<T>;
+  static constexpr size_t kPrimesPerWord = sizeof(uint64_t) / sizeof(T);
+
+  // An entry. The sequence is odd while a writer updates the slot, and zero if
+  // the slot has never been written.
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> key{0};
+    // The number of distinct primes and the exponents.
+    std::atomic<uint64_t> exponents{0};
+    std::atomic<uint64_t> primes[factorization_cache_internal::kPrimeWords]{};
+  };
+
+  struct Bucket {
+    std::array<Slot, factorization_cache_internal::kWays> slots;
+    // Bit i is set if slot i has been hit since the CLOCK hand passed it.
+    std::atomic<uint8_t> referenced{0};
+    // The CLOCK hand, guarded by the mutex of the shard.
+    uint8_t hand = 0;
+  };
+
+  struct alignas(64) Shard {
+    // Serializes the writers of the shard.
+    std::mutex mutex;
+    std::unique_ptr<Bucket[]> buckets;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+  };
+
+  Factorizer<T> factorizer_;
+  size_t num_shards_;
+  int shard_bits_;
+  // The number of buckets in each shard.
+  size_t num_buckets_;
+  std::unique_ptr<Shard[]> shards_;
+
+  FactorizationCache(Factorizer<T> &&factorizer,
+                     size_t capacity,
+                     size_t num_shards)
+      : factorizer_(std::move(factorizer)) {
+    if (capacity == 0)
+      throw std::invalid_argument("FactorizationCache capacity must be > 0.");
+    if (num_shards == 0)
+      num_shards = std::max<size_t>(std::thread::hardware_concurrency(), 1) * 4;
+    num_shards_ = std::bit_ceil(num_shards);
+    shard_bits_ = std::countr_zero(num_shards_);
+    size_t bucket_capacity = num_shards_ * factorization_cache_internal::kWays;
+    num_buckets_ = (capacity + bucket_capacity - 1) / bucket_capacity;
+    shards_ = std::make_unique<Shard[]>(num_shards_);
+    for (size_t i = 0; i < num_shards_; ++i)
+      shards_[i].buckets = std::make_unique<Bucket[]>(num_buckets_);
+  }
+
+  // Reads the factorization of |key| from |slot| into |factorization|.
+  // Returns false if the slot holds another number or is being written.
+  static bool load(const Slot &slot,
+                   uint64_t key,
+                   Factorization<T> &factorization) {
+    using factorization_cache_internal::kExponentBits;
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == 0 || sequence % 2 != 0 ||
+        slot.key.load(std::memory_order_relaxed) != key)
+      return false;
+    uint64_t exponents = slot.exponents.load(std::memory_order_relaxed);
+    std::array<uint64_t, factorization_cache_internal::kPrimeWords> primes;
+    for (size_t i = 0; i < primes.size(); ++i)
+      primes[i] = slot.primes[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence ||
+        slot.key.load(std::memory_order_relaxed) != key)
+      return false;
+
+    factorization = Factorization<T>();
+    size_t size = exponents & 0xf;
+    for (size_t i = 0; i < size; ++i) {
+      int exponent = static_cast<int>(
+          (exponents >> (4 + kExponentBits * i)) & ((1 << kExponentBits) - 1));
+      int shift = static_cast<int>(i % kPrimesPerWord * sizeof(T) * 8);
+      auto prime = static_cast<Unsigned_T>(primes[i / kPrimesPerWord] >> shift);
+      factorization.multiply(static_cast<T>(prime), exponent);
+    }
+    return true;
+  }
+
+  // Writes the factorization of |key| into |slot|. The caller must hold the
+  // mutex of the shard.
+  static void store(Slot &slot,
+                    uint64_t key,
+                    const Factorization<T> &factorization) {
+    using factorization_cache_internal::kExponentBits;
+    uint64_t exponents = factorization.size();
+    std::array<uint64_t, factorization_cache_internal::kPrimeWords> primes{};
+    for (size_t i = 0; i < factorization.size(); ++i) {
+      exponents |= static_cast<uint64_t>(factorization[i].exponent)
+                   << (4 + kExponentBits * i);
+      int shift = static_cast<int>(i % kPrimesPerWord * sizeof(T) * 8);
+      primes[i / kPrimesPerWord] |=
+          static_cast<uint64_t>(static_cast<Unsigned_T>(factorization[i].prime))
+          << shift;
+    }
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.key.store(key, std::memory_order_relaxed);
+    slot.exponents.store(exponents, std::memory_order_relaxed);
+    for (size_t i = 0; i < primes.size(); ++i)
+      slot.primes[i].store(primes[i], std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Inserts the factorization of |key| into |bucket| of |shard|, evicting an
+  // entry with the CLOCK algorithm if the bucket is full.
+  void insert(Shard &shard,
+              Bucket &bucket,
+              uint64_t key,
+              const Factorization<T> &factorization) {
+    constexpr size_t kWays = factorization_cache_internal::kWays;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // Another thread may have inserted the number after our lookup.
+    for (const Slot &slot : bucket.slots) {
+      if (slot.sequence.load(std::memory_order_relaxed) != 0 &&
+          slot.key.load(std::memory_order_relaxed) == key)
+        return;
+    }
+    // The hand stops at the first slot which is empty or not referenced, and
+    // clears the referenced bits it passes, so it stops within two rounds.
+    while (true) {
+      size_t i = bucket.hand;
+      bucket.hand = static_cast<uint8_t>((i + 1) % kWays);
+      uint8_t bit = uint8_t(1) << i;
+      Slot &slot = bucket.slots[i];
+      if (slot.sequence.load(std::memory_order_relaxed) == 0) {
+        store(slot, key, factorization);
+        return;
+      }
+      if ((bucket.referenced.fetch_and(static_cast<uint8_t>(~bit),
+                                       std::memory_order_relaxed) &
+           bit) == 0) {
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+        store(slot, key, factorization);
+        return;
+      }
+    }
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::FactorizationCache;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_FACTORIZATION_CACHE_H_
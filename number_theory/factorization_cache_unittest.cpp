@@ -0,0 +1,113 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/factorization.h"
+#include "number_theory/factorization_cache.h"
+#include "number_theory/sieve.h"
+
+namespace tql::number_theory {
+
+template <typename T>
+void test_factorization_cache() {
+  FactorizationCache<T> cache(64, 2);
+  EXPECT_GE(cache.capacity(), 64u);
+  int64_t limit = std::min<int64_t>(std::numeric_limits<T>::max(), 2000);
+  for (int round = 0; round < 2; ++round) {
+    for (int64_t i = 1; i <= limit; ++i)
+      ASSERT_EQ(cache.factorize(T(i)), factorize(T(i))) << i;
+  }
+  EXPECT_THROW(cache.factorize(T(0)), std::domain_error);
+}
+
+TEST(FactorizationCacheTest, Factorize) {
+  test_factorization_cache<int8_t>();
+  test_factorization_cache<uint8_t>();
+  test_factorization_cache<int16_t>();
+  test_factorization_cache<uint16_t>();
+  test_factorization_cache<int32_t>();
+  test_factorization_cache<uint32_t>();
+  test_factorization_cache<int64_t>();
+  test_factorization_cache<uint64_t>();
+}
+
+TEST(FactorizationCacheTest, Stats) {
+  FactorizationCache<uint64_t> cache(1024, 1);
+  uint64_t large = uint64_t(4294967291) * 4294967279;
+  EXPECT_EQ(cache.factorize(large), factorize(large));
+  EXPECT_EQ(cache.factorize(large), factorize(large));
+  EXPECT_EQ(cache.factorize(360), factorize(uint64_t(360)));
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.evictions, 0u);
+
+  // Factorizations with too many distinct primes are not cached.
+  uint64_t primorial = 614889782588491410;
+  ASSERT_GT(factorize(primorial).size(),
+            FactorizationCache<uint64_t>::kInlinePrimes);
+  EXPECT_EQ(cache.factorize(primorial), factorize(primorial));
+  EXPECT_EQ(cache.factorize(primorial), factorize(primorial));
+  EXPECT_EQ(cache.stats().misses, 4u);
+}
+
+TEST(FactorizationCacheTest, Eviction) {
+  FactorizationCache<uint32_t> cache(8, 1);
+  ASSERT_EQ(cache.capacity(), 8u);
+  for (uint32_t i = 1; i <= 1000; ++i)
+    EXPECT_EQ(cache.factorize(i), factorize(i));
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.misses, 1000u);
+  EXPECT_EQ(stats.evictions, 1000u - 8);
+
+  // Entries that are hit get a second chance.
+  FactorizationCache<uint32_t> hot(4, 1);
+  ASSERT_EQ(hot.capacity(), 4u);
+  for (uint32_t i = 1; i <= 4; ++i)
+    hot.factorize(i);
+  hot.factorize(1);
+  hot.factorize(5);
+  hot.factorize(1);
+  EXPECT_EQ(hot.stats().hits, 2u);
+}
+
+TEST(FactorizationCacheTest, Table) {
+  EulerSieve<int64_t> sieve(1000);
+  FactorizationCache<int64_t> cache(sieve.view(), 256);
+  for (int64_t i = 1; i < 3000; i += 7)
+    EXPECT_EQ(cache.factorize(i), factorize(i));
+}
+
+TEST(FactorizationCacheTest, Concurrent) {
+  FactorizationCache<uint64_t> cache(512, 4);
+  std::vector<std::thread> threads;
+  std::vector<int> failures(4);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, &failures, t] {
+      std::mt19937_64 generator(t);
+      // A skewed distribution, so that the threads share entries.
+      std::geometric_distribution<uint64_t> distribution(0.002);
+      for (int i = 0; i < 20000; ++i) {
+        uint64_t n = (distribution(generator) + 1) * 1000000007;
+        if (!(cache.factorize(n) == factorize(n)))
+          ++failures[t];
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+  for (int failure : failures)
+    EXPECT_EQ(failure, 0);
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits + stats.misses, 80000u);
+  EXPECT_GT(stats.hits, 0u);
+}
+
+}  // namespace tql::number_theory
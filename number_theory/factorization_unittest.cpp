@@ -0,0 +1,253 @@
+#include <stdint.h>
+
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/factorization.h"
+#include "number_theory/prime.h"
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+
+namespace tql::number_theory {
+
+// Checks that |factorization| is a valid prime factorization of |number|.
+template <typename T>
+void check_factorization(const Factorization<T> &factorization,
+                         const T &number) {
+  ASSERT_EQ(factorization.value(), number);
+  for (size_t i = 0; i < factorization.size(); ++i) {
+    ASSERT_TRUE(is_prime(factorization[i].prime));
+    ASSERT_GT(factorization[i].exponent, 0);
+    if (i > 0)
+      ASSERT_LT(factorization[i - 1].prime, factorization[i].prime);
+  }
+}
+
+TEST(FactorizationTest, Multiply) {
+  Factorization<int> factorization;
+  EXPECT_TRUE(factorization.empty());
+  EXPECT_EQ(factorization.value(), 1);
+  factorization.multiply(5);
+  factorization.multiply(2, 3);
+  factorization.multiply(5, 2);
+  factorization.multiply(3);
+  ASSERT_EQ(factorization.size(), 3u);
+  EXPECT_EQ(factorization[0], (PrimePower<int>{2, 3}));
+  EXPECT_EQ(factorization[1], (PrimePower<int>{3, 1}));
+  EXPECT_EQ(factorization[2], (PrimePower<int>{5, 3}));
+  EXPECT_EQ(factorization.value(), 3000);
+
+  static_assert(Factorization<uint8_t>::kMaxPrimes == 4);
+  static_assert(Factorization<int32_t>::kMaxPrimes == 9);
+  static_assert(Factorization<uint32_t>::kMaxPrimes == 9);
+  static_assert(Factorization<uint64_t>::kMaxPrimes == 15);
+  Factorization<uint8_t> small;
+  for (uint8_t p : {2, 3, 5, 7})
+    small.multiply(p);
+  EXPECT_THROW(small.multiply(11), std::length_error);
+}
+
+template <typename T>
+void test_factorize_small() {
+  for (T i = 1; i < 120; ++i)
+    check_factorization(factorize(i), i);
+  EXPECT_THROW(factorize(T(0)), std::domain_error);
+  if (std::numeric_limits<T>::is_signed)
+    EXPECT_THROW(factorize(T(-6)), std::domain_error);
+}
+
+TEST(FactorizationTest, FactorizeSmall) {
+  test_factorize_small<int8_t>();
+  test_factorize_small<int16_t>();
+  test_factorize_small<int32_t>();
+  test_factorize_small<int64_t>();
+  test_factorize_small<uint8_t>();
+  test_factorize_small<uint16_t>();
+  test_factorize_small<uint32_t>();
+  test_factorize_small<uint64_t>();
+}
+
+TEST(FactorizationTest, FactorizeLarge) {
+  // Semiprimes, prime powers, primes and highly composite numbers.
+  for (uint64_t number :
+       {uint64_t(4294967291) * 4294967279, uint64_t(999999937) * 999999929,
+        uint64_t(3) * 6148914691236517199, uint64_t(1) << 63,
+        uint64_t(3486784401) * 3486784401, uint64_t(18446744073709551557u),
+        uint64_t(18446744073709551615u), uint64_t(614889782588491410),
+        uint64_t(1000003) * 1000003 * 1000003}) {
+    check_factorization(factorize(number), number);
+  }
+  Factorization<uint64_t> expected;
+  expected.multiply(4294967279);
+  expected.multiply(4294967291);
+  EXPECT_EQ(factorize(uint64_t(4294967291) * 4294967279), expected);
+
+  std::default_random_engine engine(
+      testing::UnitTest::GetInstance()->random_seed());
+  std::uniform_int_distribution<uint64_t> distribution(
+      1, std::numeric_limits<uint64_t>::max());
+  for (int i = 0; i < 200; ++i) {
+    uint64_t number = distribution(engine);
+    check_factorization(factorize(number), number);
+  }
+}
+
+template <typename T>
+void test_factorize_with_table() {
+  EulerSieve<T> sieve(100);
+  for (T i = 1; i <= 100; ++i)
+    EXPECT_EQ(factorize(i, sieve), factorize(i));
+  EXPECT_THROW(factorize(T(0), sieve), std::domain_error);
+  EXPECT_THROW(factorize(T(101), sieve), std::out_of_range);
+}
+
+TEST(FactorizationTest, FactorizeWithTable) {
+  test_factorize_with_table<int8_t>();
+  test_factorize_with_table<int16_t>();
+  test_factorize_with_table<int32_t>();
+  test_factorize_with_table<int64_t>();
+  test_factorize_with_table<uint8_t>();
+  test_factorize_with_table<uint16_t>();
+  test_factorize_with_table<uint32_t>();
+  test_factorize_with_table<uint64_t>();
+}
+
+TEST(FactorizationTest, Factorize128) {
+  using u128 = unsigned __int128;
+  static_assert(Factorization<u128>::kMaxPrimes == 26);
+  u128 mersenne71 = (u128(1) << 71) - 1;
+  Factorization<u128> expected;
+  expected.multiply(228479);
+  expected.multiply(48544121);
+  expected.multiply(212885833);
+  EXPECT_EQ(factorize(mersenne71), expected);
+
+  u128 prime = (u128(1) << 64) + 13;
+  for (u128 number : {u128(1000000007) * 998244353 * 4294967291 * 243,
+                      prime * 1000003, prime * prime, prime << 40,
+                      u128(4294967291) * 4294967279 * 4294967291 * 1000003,
+                      ~u128(0)}) {
+    check_factorization(factorize(number), number);
+  }
+  check_factorization(factorize(__int128(prime) * 15), __int128(prime) * 15);
+  EXPECT_THROW(factorize(-__int128(6)), std::domain_error);
+}
+
+TEST(FactorizationTest, FactorizeWithEcm) {
+  using u128 = unsigned __int128;
+  // Both factors are beyond the reach of the short rho walk.
+  u128 p = 859933207772791, q = 27204228634625293;
+  Factorization<u128> expected;
+  expected.multiply(p);
+  expected.multiply(q);
+  EXPECT_EQ(factorize(p * q), expected);
+  ThreadPool pool(2);
+  EXPECT_EQ(factorize(p * q * 3, pool), factorize(p * q * 3));
+}
+
+TEST(FactorizationTest, FactorizeWithSiqs) {
+  using u128 = unsigned __int128;
+  u128 p = 8757509311326744407u, q = 1147658516613294997;
+  Factorization<u128> expected;
+  expected.multiply(q);
+  expected.multiply(p);
+  EXPECT_EQ(factorize(p * q), expected);
+  ThreadPool pool(2);
+  EXPECT_EQ(factorize(p * q, pool), expected);
+}
+
+TEST(FactorizationTest, FactorizeParallel) {
+  using u128 = unsigned __int128;
+  ThreadPool pool(3);
+  for (uint64_t number :
+       {uint64_t(4294967291) * 4294967279, uint64_t(999999937) * 999999929,
+        uint64_t(1000003) * 1000003 * 1000003, uint64_t(360),
+        uint64_t(18446744073709551557u)}) {
+    EXPECT_EQ(factorize(number, pool), factorize(number));
+    EXPECT_EQ(factorize(number, pool, 5), factorize(number));
+  }
+  u128 number = u128(4294967291) * 4294967279 * 1000000007;
+  EXPECT_EQ(factorize(number, pool), factorize(number));
+  EXPECT_THROW(factorize(int64_t(0), pool), std::domain_error);
+}
+
+TEST(FactorizationTest, FactorizeMany) {
+  ThreadPool pool(2);
+  std::vector<int64_t> numbers;
+  for (int64_t i = 1; i <= 100; ++i)
+    numbers.push_back(i * 999999937);
+  std::vector<Factorization<int64_t>> results(numbers.size());
+  factorize_many<int64_t>(numbers, results, pool);
+  for (size_t i = 0; i < numbers.size(); ++i)
+    EXPECT_EQ(results[i], factorize(numbers[i]));
+  factorize_many<int64_t>(numbers, results);
+  EXPECT_THROW(factorize_many<int64_t>(numbers, std::span(results).first(3)),
+               std::invalid_argument);
+  factorize_many<int64_t>({}, {}, pool);
+}
+
+TEST(FactorizationTest, FactorizeManyMixed) {
+  // Semiprimes, prime powers, primes and random numbers.
+  std::vector<uint64_t> numbers = {
+      uint64_t(4294967291) * 4294967279, uint64_t(1000003) * 1000003 * 1000003,
+      uint64_t(18446744073709551557u),   uint64_t(3486784401) * 3486784401,
+      uint64_t(614889782588491410),      uint64_t(1),
+      uint64_t(101) * 101,               uint64_t(103) * 107 * 109 * 113};
+  std::default_random_engine engine(
+      testing::UnitTest::GetInstance()->random_seed());
+  std::uniform_int_distribution<uint64_t> distribution(
+      1, std::numeric_limits<uint64_t>::max());
+  std::uniform_int_distribution<uint64_t> prime_distribution(1 << 30, 1 << 31);
+  for (int i = 0; i < 100; ++i) {
+    numbers.push_back(distribution(engine));
+    uint64_t p = prime_distribution(engine), q = prime_distribution(engine);
+    while (!is_prime(p))
+      ++p;
+    while (!is_prime(q))
+      ++q;
+    numbers.push_back(p * q);
+  }
+  ThreadPool pool(1);
+  std::vector<Factorization<uint64_t>> results(numbers.size());
+  factorize_many<uint64_t>(numbers, results, pool);
+  for (size_t i = 0; i < numbers.size(); ++i)
+    check_factorization(results[i], numbers[i]);
+
+  std::vector<int32_t> negative = {6, -6};
+  std::vector<Factorization<int32_t>> negative_results(2);
+  EXPECT_THROW(factorize_many<int32_t>(negative, negative_results, pool),
+               std::domain_error);
+}
+
+TEST(FactorizerTest, Backends) {
+  EulerSieve<int64_t> sieve(1000);
+  Factorizer<int64_t> with_table(sieve);
+  Factorizer<int64_t> without_table;
+  for (int64_t n : {int64_t(1), int64_t(840), int64_t(1000), int64_t(1001),
+                    int64_t(999999000001)}) {
+    EXPECT_EQ(with_table.factorize(n), factorize(n));
+    EXPECT_EQ(without_table.factorize(n), factorize(n));
+  }
+  EXPECT_THROW(with_table.factorize(0), std::domain_error);
+  EXPECT_THROW(without_table.factorize(-1), std::domain_error);
+}
+
+TEST(FactorizerTest, Memo) {
+  Factorizer<uint64_t> factorizer(/*memo_capacity=*/2);
+  for (int round = 0; round < 3; ++round) {
+    for (uint64_t n : {uint64_t(12), uint64_t(12), uint64_t(4294967291) * 3,
+                       uint64_t(35), uint64_t(12), uint64_t(35)})
+      EXPECT_EQ(factorizer.factorize(n), factorize(n));
+  }
+  Factorizer<uint64_t> moved = std::move(factorizer);
+  EXPECT_EQ(moved.factorize(35), factorize(uint64_t(35)));
+  EXPECT_EQ(moved.factorize(36), factorize(uint64_t(36)));
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,277 @@
+#ifndef NUMBER_THEORY_MEMORY_H_
+#define NUMBER_THEORY_MEMORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <bit>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+// Memory allocation for large tables.
+
+namespace tql {
+namespace number_theory {
+
+// Page size requested for an allocation.
+enum class HugePages {
+  // Regular pages.
+  kNone,
+  // Regular pages aligned to 2 MB, advising the kernel to back them with
+  // transparent huge pages.
+  kTransparent,
+  // Explicit 2 MB huge pages from the hugetlb pool.
+  k2MB,
+  // Explicit 1 GB huge pages from the hugetlb pool.
+  k1GB,
+};
+
+// Placement of the pages on NUMA nodes.
+enum class NumaPolicy {
+  // The kernel default, which is usually the node of the first touching CPU.
+  kDefault,
+  // Pages are interleaved across the nodes.
+  kInterleave,
+  // Pages are allocated only on the nodes.
+  kBind,
+};
+
+// Allocation policy of PageAllocator.
+struct AllocationPolicy {
+  HugePages huge_pages = HugePages::kTransparent;
+  NumaPolicy numa = NumaPolicy::kDefault;
+  // Bit mask of the NUMA nodes used by kInterleave and kBind. Bit i stands for
+  // node i. Nodes which are not online are ignored by the kernel.
+  uint64_t numa_nodes = ~uint64_t(0);
+};
+
+namespace memory_internal {
+
+// Allocations smaller than this use the global operator new.
+inline constexpr size_t kMinPageAllocation = size_t(1) << 20;
+
+inline constexpr size_t k2MB = size_t(1) << 21;
+inline constexpr size_t k1GB = size_t(1) << 30;
+
+// Returns the alignment and the length granularity of a mapping.
+inline size_t page_size(HugePages huge_pages) {
+  switch (huge_pages) {
+    case HugePages::kNone:
+      return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    case HugePages::kTransparent:
+    case HugePages::k2MB:
+      return k2MB;
+    case HugePages::k1GB:
+      return k1GB;
+  }
+  return k2MB;
+}
+
+// Maps |length| bytes of anonymous memory aligned to |alignment|.
+// Returns nullptr on failure.
+inline void *map_aligned(size_t length, size_t alignment) {
+  size_t padded = length + alignment;
+  void *address = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (address == MAP_FAILED)
+    return nullptr;
+  // Trim the unaligned head and the tail.
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+  uintptr_t aligned = (begin + alignment - 1) / alignment * alignment;
+  if (aligned != begin)
+    munmap(address, aligned - begin);
+  if (size_t tail = begin + padded - (aligned + length); tail != 0)
+    munmap(reinterpret_cast<void *>(aligned + length), tail);
+  return reinterpret_cast<void *>(aligned);
+}
+
+// Maps |length| bytes from the hugetlb pool. Returns nullptr if the pool
+// cannot serve the request.
+inline void *map_huge_pages([[maybe_unused]] size_t length,
+                            [[maybe_unused]] HugePages huge_pages) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  int page_shift = huge_pages == HugePages::k1GB ? 30 : 21;
+  void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                           (page_shift << MAP_HUGE_SHIFT),
+                       -1, 0);
+  if (address != MAP_FAILED)
+    return address;
+#endif
+  return nullptr;
+}
+
+// Applies the NUMA policy to the mapping. This is best effort: if the kernel
+// does not support NUMA, the mapping keeps the default policy.
+inline void apply_numa_policy([[maybe_unused]] void *address,
+                              [[maybe_unused]] size_t length,
+                              const AllocationPolicy &policy) {
+  if (policy.numa == NumaPolicy::kDefault)
+    return;
+#if defined(__linux__) && defined(SYS_mbind)
+  // Values of MPOL_BIND and MPOL_INTERLEAVE in <linux/mempolicy.h>.
+  constexpr int kMpolBind = 2;
+  constexpr int kMpolInterleave = 3;
+  unsigned long nodes = static_cast<unsigned long>(policy.numa_nodes);
+  int mode = policy.numa == NumaPolicy::kBind ? kMpolBind : kMpolInterleave;
+  syscall(SYS_mbind, address, length, mode, &nodes,
+          std::numeric_limits<unsigned long>::digits, 0);
+#endif
+}
+
+}  // namespace memory_internal
+
+// An allocator for large tables, which maps memory directly from the kernel
+// with the page size and the NUMA placement given by an AllocationPolicy.
+//
+// Elements are value-initialized as with std::allocator, so the pages are
+// touched by the thread which constructs a container. With NumaPolicy::kDefault
+// they are placed on the NUMA node of that thread. The multi-threaded
+// EulerSieve default-initializes its table instead, so that its pages are
+// first touched by the threads which sieve them.
+//
+// Explicit huge pages require a reserved hugetlb pool. If the pool cannot
+// serve a request, the allocator falls back to transparent huge pages, which
+// are only aligned and rounded to 2 MB. Allocations smaller than 1 MB use the
+// global operator new.
+template <typename T>
+class PageAllocator {
+ public:
+  using value_type = T;
+
+  PageAllocator() = default;
+  explicit PageAllocator(const AllocationPolicy &policy) : policy_(policy) {}
+
+  template <typename U>
+  PageAllocator(const PageAllocator<U> &other)  // NOLINT(runtime/explicit)
+      : policy_(other.policy()) {}
+
+  // Returns the allocation policy.
+  const AllocationPolicy &policy() const { return policy_; }
+
+  T *allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+      throw std::bad_array_new_length();
+    size_t bytes = n * sizeof(T);
+    if (bytes < memory_internal::kMinPageAllocation) {
+      return static_cast<T *>(::operator new(bytes));
+    }
+
+    void *address = nullptr;
+    size_t length = mapping_length(bytes, policy_.huge_pages);
+    if (policy_.huge_pages == HugePages::k2MB ||
+        policy_.huge_pages == HugePages::k1GB) {
+      address = memory_internal::map_huge_pages(length, policy_.huge_pages);
+    }
+    if (address == nullptr) {
+      HugePages fallback = fallback_pages();
+      length = mapping_length(bytes, fallback);
+      address = memory_internal::map_aligned(
+          length, memory_internal::page_size(fallback));
+      if (address == nullptr)
+        throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+      if (policy_.huge_pages != HugePages::kNone)
+        madvise(address, length, MADV_HUGEPAGE);
+#endif
+    }
+    memory_internal::apply_numa_policy(address, length, policy_);
+    return static_cast<T *>(address);
+  }
+
+  void deallocate(T *pointer, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (bytes < memory_internal::kMinPageAllocation) {
+      ::operator delete(pointer);
+      return;
+    }
+    // A mapping of explicit 1 GB pages is longer than the fallback mapping
+    // unless the lengths agree. The kernel refuses to unmap a part of huge
+    // pages, so the shorter length is tried first.
+    HugePages fallback = fallback_pages();
+    if (munmap(pointer, mapping_length(bytes, fallback)) != 0 &&
+        policy_.huge_pages == HugePages::k1GB) {
+      munmap(pointer, mapping_length(bytes, policy_.huge_pages));
+    }
+  }
+
+  // Allocators with the same page size can deallocate the memory allocated by
+  // each other.
+  template <typename U>
+  bool operator==(const PageAllocator<U> &other) const {
+    return policy_.huge_pages == other.policy().huge_pages;
+  }
+
+ private:
+  AllocationPolicy policy_;
+
+  // Returns the pages used when the hugetlb pool cannot serve a request.
+  HugePages fallback_pages() const {
+    return policy_.huge_pages == HugePages::kNone ? HugePages::kNone
+                                                  : HugePages::kTransparent;
+  }
+
+  // Returns the length of the mapping for |bytes| bytes with |huge_pages|,
+  // which is a multiple of the page size.
+  static size_t mapping_length(size_t bytes, HugePages huge_pages) {
+    size_t page = memory_internal::page_size(huge_pages);
+    return (bytes + page - 1) / page * page;
+  }
+};
+
+// An allocator which aligns the memory to |kAlignment| bytes, for example to
+// cache lines for vectorized loops.
+template <typename T, size_t kAlignment = 64>
+class AlignedAllocator {
+  static_assert(kAlignment >= alignof(T) && std::has_single_bit(kAlignment),
+                "AlignedAllocator requires a power of two alignment.");
+
+ public:
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, kAlignment>;
+  };
+
+  AlignedAllocator() = default;
+
+  template <typename U>
+  AlignedAllocator(  // NOLINT(runtime/explicit)
+      const AlignedAllocator<U, kAlignment> &) {}
+
+  T *allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+      throw std::bad_array_new_length();
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(kAlignment)));
+  }
+
+  void deallocate(T *pointer, size_t) {
+    ::operator delete(pointer, std::align_val_t(kAlignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, kAlignment> &) const {
+    return true;
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::AlignedAllocator;
+using number_theory::AllocationPolicy;
+using number_theory::HugePages;
+using number_theory::NumaPolicy;
+using number_theory::PageAllocator;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_MEMORY_H_
@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/memory.h"
+
+namespace tql::number_theory {
+
+void test_page_allocator(const AllocationPolicy &policy) {
+  // Small allocations and large allocations.
+  for (size_t size : {size_t(10), size_t(1) << 16, size_t(1) << 19}) {
+    std::vector<uint32_t, PageAllocator<uint32_t>> values(
+        size, PageAllocator<uint32_t>(policy));
+    EXPECT_EQ(values.get_allocator().policy().huge_pages, policy.huge_pages);
+    // The memory should be zero-filled.
+    for (size_t i = 0; i < size; i += 997)
+      ASSERT_EQ(values[i], 0u);
+    for (size_t i = 0; i < size; ++i)
+      values[i] = static_cast<uint32_t>(i);
+    for (size_t i = 0; i < size; i += 997)
+      ASSERT_EQ(values[i], i);
+    values.resize(size * 2);
+    EXPECT_EQ(values[size - 1], size - 1);
+    EXPECT_EQ(values[size * 2 - 1], 0u);
+  }
+}
+
+TEST(PageAllocatorTest, ValueInitialization) {
+  // The storage is reused after the elements are destroyed, so the new
+  // elements must be value-initialized.
+  for (size_t size : {size_t(1000), size_t(1) << 20}) {
+    std::vector<int, PageAllocator<int>> values(size);
+    std::fill(values.begin(), values.end(), 7);
+    values.resize(0);
+    values.resize(size);
+    EXPECT_EQ(values.front(), 0);
+    EXPECT_EQ(values.back(), 0);
+    std::fill(values.begin(), values.end(), 7);
+    values.clear();
+    values.resize(size);
+    EXPECT_EQ(values[size / 2], 0);
+  }
+}
+
+TEST(PageAllocatorTest, MappingLength) {
+  // Without explicit 1 GB pages, the fallback mapping is not rounded to 1 GB.
+  PageAllocator<char> allocator({.huge_pages = HugePages::k1GB});
+  for (size_t size : {size_t(3) << 20, size_t(5) << 21}) {
+    char *pointer = allocator.allocate(size);
+    pointer[0] = 1;
+    pointer[size - 1] = 1;
+    allocator.deallocate(pointer, size);
+  }
+}
+
+TEST(PageAllocatorTest, Policies) {
+  for (HugePages huge_pages : {HugePages::kNone, HugePages::kTransparent,
+                               HugePages::k2MB, HugePages::k1GB}) {
+    for (NumaPolicy numa :
+         {NumaPolicy::kDefault, NumaPolicy::kInterleave, NumaPolicy::kBind}) {
+      test_page_allocator({.huge_pages = huge_pages, .numa = numa});
+    }
+  }
+}
+
+TEST(PageAllocatorTest, Alignment) {
+  PageAllocator<char> allocator({.huge_pages = HugePages::kTransparent});
+  size_t size = size_t(3) << 20;
+  char *pointer = allocator.allocate(size);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pointer) % (size_t(1) << 21), 0u);
+  allocator.deallocate(pointer, size);
+}
+
+TEST(PageAllocatorTest, Equality) {
+  PageAllocator<int> a({.huge_pages = HugePages::kTransparent});
+  PageAllocator<char> b({.huge_pages = HugePages::kTransparent,
+                         .numa = NumaPolicy::kInterleave});
+  PageAllocator<int> c({.huge_pages = HugePages::k1GB});
+  EXPECT_TRUE(a == b);
+  EXPECT_FALSE(a == c);
+  EXPECT_TRUE(a == PageAllocator<int>(b));
+}
+
+TEST(AlignedAllocatorTest, Alignment) {
+  std::vector<uint8_t, AlignedAllocator<uint8_t>> bytes(100, 1);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(bytes.data()) % 64, 0u);
+  std::vector<uint32_t, AlignedAllocator<uint32_t, 4096>> values(3, 7);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(values.data()) % 4096, 0u);
+  EXPECT_EQ(values[2], 7u);
+  EXPECT_TRUE(AlignedAllocator<int>() == AlignedAllocator<char>());
+}
+
+}  // namespace tql::number_theory
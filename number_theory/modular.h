@@ -2,16 +2,21 @@
 #define NUMBER_THEORY_MODULAR_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <algorithm>
 #include <bit>
 #include <concepts>
 #include <iostream>
 #include <limits>
+#include <numeric>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
 
+#include "number_theory/montgomery.h"
 #include "number_theory/numeric.h"
+#include "number_theory/prime.h"
 #include "number_theory/utility.h"
 
 // Modular arithmetic
@@ -51,19 +56,266 @@ struct ModulusWrapper {
       : value(std::move(x)) {}
 };
 
+// Returns |a| * |b| modulo |modulus| for 64-bit operands.
+constexpr uint64_t multiply_u64(uint64_t a, uint64_t b, uint64_t modulus) {
+  return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b %
+                               modulus);
+}
+
+// Returns |base|^|exponent| modulo |modulus| for 64-bit operands.
+constexpr uint64_t pow_u64(uint64_t base, uint64_t exponent, uint64_t modulus) {
+  uint64_t result = 1 % modulus;
+  for (; exponent != 0; exponent /= 2) {
+    if (exponent % 2 != 0)
+      result = multiply_u64(result, base, modulus);
+    base = multiply_u64(base, base, modulus);
+  }
+  return result;
+}
+
+// Returns |a| * |b| modulo the fixed |modulus| for |a|, |b| in [0, modulus),
+// where the product may not fit in 128 bits. Odd moduli use two Montgomery
+// multiplications: the first gives a b R^-1, and the second multiplies it by
+// R^2. The modulus of even moduli must be below 2^127.
+template <typename U, U modulus>
+U multiply_wide(U a, U b) {
+  using u128 = unsigned __int128;
+  if constexpr (modulus % 2 != 0 && modulus != 1) {
+    static constexpr Montgomery<U> montgomery(modulus);
+    static constexpr U r2 = montgomery.to(montgomery.one());
+    return montgomery.multiply(montgomery.multiply(a, b), r2);
+  } else if constexpr (std::numeric_limits<U>::digits <= 64) {
+    return static_cast<U>(static_cast<u128>(a) * b % modulus);
+  } else {
+    // Doubling and adding, from the highest bit of |b|.
+    U result = 0;
+    for (int i = std::bit_width(b) - 1; i >= 0; --i) {
+      result *= 2;
+      if (result >= modulus)
+        result -= modulus;
+      if ((b >> i) & 1) {
+        result += a;
+        if (result >= modulus)
+          result -= modulus;
+      }
+    }
+    return result;
+  }
+}
+
+// Returns all ones if |condition| holds, and zero otherwise.
+template <typename U>
+constexpr U mask(bool condition) {
+  return U(0) - static_cast<U>(condition);
+}
+
+// Returns |x| / 2 modulo the odd |modulus|, where |half| is (modulus + 1) / 2.
+template <typename U>
+constexpr U halve(U x, U half) {
+  return (x >> 1) + (half & mask<U>(x & 1));
+}
+
+// Returns |x| / 2^|shift| modulo the odd |modulus| for |x| < |modulus| and
+// |shift| <= 64, where |negative_inverse| is -1 / |modulus| modulo 2^64. This
+// is a Montgomery reduction, which adds the multiple of |modulus| making the
+// low |shift| bits zero.
+template <typename U>
+constexpr U divide_power_of_two(U x, int shift, U modulus,
+                                uint64_t negative_inverse) {
+  using u128 = unsigned __int128;
+  uint64_t q = static_cast<uint64_t>(x) * negative_inverse;
+  if (shift < 64)
+    q &= (uint64_t(1) << shift) - 1;
+  // The result (x + q * modulus) / 2^shift is below |modulus|.
+  if constexpr (std::numeric_limits<U>::digits <= 64) {
+    return static_cast<U>((static_cast<u128>(q) * modulus + x) >> shift);
+  } else {
+    u128 high = 0, low = 0;
+    montgomery_internal::multiply_wide(q, modulus, high, low);
+    low += x;
+    high += low < x;
+    return high << (128 - shift) | low >> shift;
+  }
+}
+
+// Returns the inverse of |number| in [0, |modulus|) modulo the odd |modulus|
+// with Kaliski's binary algorithm, which only shifts and subtracts, skipping
+// the zero bits at once. It computes number^-1 * 2^k for some k, which is
+// divided by 2^k at the end in 64-bit Montgomery reductions.
+// Throws domain_error exception if the inverse does not exist.
+template <typename U>
+constexpr U binary_inverse(U number, U modulus) {
+  // Invariant: modulus = u * s + v * r, number * s = v * 2^k and
+  // number * r = -u * 2^k modulo |modulus|. Then r and s are at most
+  // |modulus|, and u and v are odd.
+  if (number == 0) {
+    if (modulus != 1)
+      throw std::domain_error("The modular inverse does not exist.");
+    return 0;
+  }
+  U u = modulus, v = number, r = 0, s = 1;
+  int k = std::countr_zero(v);
+  v >>= k;
+  while (v != 0) {
+    if (u > v) {
+      U difference = u - v;
+      int shift = std::countr_zero(difference);
+      u = difference >> shift;
+      r += s;
+      s <<= shift;
+      k += shift;
+    } else {
+      U difference = v - u;
+      s += r;
+      if (difference == 0)
+        break;
+      int shift = std::countr_zero(difference);
+      v = difference >> shift;
+      r <<= shift;
+      k += shift;
+    }
+  }
+  // Now u is the gcd.
+  if (u != 1)
+    throw std::domain_error("The modular inverse does not exist.");
+  if (modulus == 1)
+    return 0;
+  auto low = static_cast<uint64_t>(modulus);
+  uint64_t inverse = low;
+  for (int i = 0; i < 5; ++i)
+    inverse *= 2 - low * inverse;
+  U x = modulus - r;
+  for (; k > 0; k -= 64)
+    x = divide_power_of_two(x, std::min(k, 64), modulus, 0 - inverse);
+  return x;
+}
+
+// Returns the inverse of |number| in [0, |modulus|) modulo the odd |modulus|
+// in a time which does not depend on |number|. This is the binary algorithm
+// one bit per iteration, where every iteration runs the same instructions,
+// selecting with masks instead of branches. The number of iterations is
+// 2 * bits, which bounds the total length of u and v.
+// Throws domain_error exception if the inverse does not exist.
+template <typename U>
+constexpr U constant_time_inverse(U number, U modulus) {
+  U half = modulus / 2 + 1;
+  U u = number, v = modulus, x1 = 1, x2 = 0;
+  for (int i = 0; i < 2 * std::numeric_limits<U>::digits; ++i) {
+    U odd = mask<U>(u & 1);
+    U swap = odd & mask<U>(u < v);
+    U t = (u ^ v) & swap;
+    u ^= t;
+    v ^= t;
+    t = (x1 ^ x2) & swap;
+    x1 ^= t;
+    x2 ^= t;
+    u -= v & odd;
+    U y = x2 & odd;
+    x1 = x1 - y + (modulus & mask<U>(x1 < y));
+    u >>= 1;
+    x1 = halve(x1, half);
+  }
+  if (v != 1)
+    throw std::domain_error("The modular inverse does not exist.");
+  return x2 & mask<U>(modulus != 1);
+}
+
+// Returns the gcd of |number| in [0, |modulus|) and |modulus| with a value x
+// in [0, |modulus|) such that number * x = gcd modulo |modulus|. This is the
+// extended Euclidean algorithm on the magnitudes of the coefficients, which
+// alternate in sign and never exceed |modulus|, so it works for the whole
+// range of the unsigned type.
+template <typename U>
+constexpr std::pair<U, U> partial_inverse(U number, U modulus) {
+  if (number == 0)
+    return {modulus, 0};
+  // Invariant: r0 = (-1)^negative s0 number and r1 = -(-1)^negative s1 number
+  // modulo |modulus|.
+  U r0 = modulus, r1 = number, s0 = 0, s1 = 1;
+  bool negative = true;
+  while (r1 != 0) {
+    U q = r0 / r1;
+    r0 = std::exchange(r1, r0 - q * r1);
+    s0 = std::exchange(s1, s0 + q * s1);
+    negative = !negative;
+  }
+  return {r0, negative && s0 != 0 ? modulus - s0 : s0};
+}
+
 }  // namespace modular_internal
 
+// Returns the smaller square root of |number| modulo the prime |prime| with
+// the Tonelli-Shanks algorithm, in O(log^2 |prime|) multiplications.
+// Throws domain_error exception if |number| is not a square modulo |prime|.
+// The result is unspecified if |prime| is not a prime.
+//
+// This overload is only available for primes below 2^64.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 64, bool> = true>
+T sqrt_mod(const T &number, const T &prime) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "sqrt_mod arguments must be integers.");
+  using modular_internal::multiply_u64;
+  using modular_internal::pow_u64;
+  if (prime < 2)
+    throw std::invalid_argument("The modulus must be a prime.");
+  uint64_t p = static_cast<uint64_t>(prime);
+  uint64_t a =
+      static_cast<uint64_t>(modular_internal::normalize(number, prime));
+  if (a == 0 || p == 2)
+    return static_cast<T>(a);
+  // Euler's criterion.
+  if (pow_u64(a, (p - 1) / 2, p) != 1)
+    throw std::domain_error("The number is not a quadratic residue.");
+
+  // p - 1 = q * 2^s with odd q.
+  int s = std::countr_zero(p - 1);
+  uint64_t q = (p - 1) >> s;
+  uint64_t z = 2;
+  while (pow_u64(z, (p - 1) / 2, p) == 1)
+    ++z;
+  // Invariant: r^2 = a t, where the order of t divides 2^(m - 1), and c has
+  // the order 2^m.
+  uint64_t c = pow_u64(z, q, p);
+  uint64_t r = pow_u64(a, (q + 1) / 2, p);
+  uint64_t t = pow_u64(a, q, p);
+  int m = s;
+  while (t != 1) {
+    int i = 0;
+    for (uint64_t t2 = t; t2 != 1; t2 = multiply_u64(t2, t2, p))
+      ++i;
+    uint64_t b = c;
+    for (int j = 0; j < m - i - 1; ++j)
+      b = multiply_u64(b, b, p);
+    r = multiply_u64(r, b, p);
+    c = multiply_u64(b, b, p);
+    t = multiply_u64(t, c, p);
+    m = i;
+  }
+  return static_cast<T>(std::min(r, p - r));
+}
+
 // Returns the modular inverse of |number| in modulo |modulus| if exists.
-// Otherwise, throws domain_error exception.
+// Otherwise, throws domain_error exception. This uses exgcd, or the binary
+// algorithm of inverse_mod_binary for odd moduli which do not fit the signed
+// type.
 template <typename T>
 T inverse_mod(const T &number, const T &modulus) {
   static_assert(std::numeric_limits<T>::is_integer,
                 "inverse_mod arguments must be integers.");
+  if (modulus <= 0)
+    throw std::invalid_argument("The modulus must be positive.");
   using Signed_T = std::make_signed_t<T>;
+  using U = std::make_unsigned_t<T>;
+  if (static_cast<U>(modulus) >
+          static_cast<U>(std::numeric_limits<Signed_T>::max()) &&
+      modulus % 2 != 0) {
+    return static_cast<T>(modular_internal::binary_inverse<U>(
+        static_cast<U>(modular_internal::normalize(number, modulus)),
+        static_cast<U>(modulus)));
+  }
   Signed_T num = numeric_cast<Signed_T>(number);
   Signed_T mod = numeric_cast<Signed_T>(modulus);
-  if (mod <= 0)
-    throw std::invalid_argument("The modulus must be positive.");
   auto [x, y] = exgcd(num, mod);
   // Note that this will not overflow. If T has b bits, x*n + y*mod should be
   // equal to k * 2^b + 1 and by definition of exgcd, k must be zero.
@@ -78,6 +330,74 @@ T inverse_mod(const T &number, const T &modulus) {
   return modular_internal::normalize(std::move(x), mod);
 }
 
+// Returns the modular inverse of |number| in modulo the odd |modulus| with
+// Kaliski's binary algorithm, which only shifts and subtracts. It avoids the
+// hardware divider, which pays off on cores where the division is slow; on
+// cores with a fast divider, inverse_mod is slightly faster.
+// Throws invalid_argument exception if |modulus| is not odd and positive.
+// Throws domain_error exception if the inverse does not exist.
+template <typename T>
+T inverse_mod_binary(const T &number, const T &modulus) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "inverse_mod_binary arguments must be integers.");
+  if (modulus <= 0 || modulus % 2 == 0)
+    throw std::invalid_argument("The modulus must be odd and positive.");
+  using U = std::make_unsigned_t<T>;
+  return static_cast<T>(modular_internal::binary_inverse<U>(
+      static_cast<U>(modular_internal::normalize(number, modulus)),
+      static_cast<U>(modulus)));
+}
+
+// The gcd of a number and a modulus, with a partial inverse of the number,
+// which is the inverse when the gcd is 1.
+template <typename T>
+struct PartialInverse {
+  // gcd(number, modulus), which is in [1, modulus].
+  T gcd;
+  // A value in [0, modulus) with number * inverse = gcd (mod modulus).
+  T inverse;
+
+  friend bool operator==(const PartialInverse &,
+                         const PartialInverse &) = default;
+};
+
+// Returns the gcd of |number| and |modulus| with the partial inverse of
+// |number|, which never fails. Together they tell whether |number| is a unit or
+// a zero divisor, and which factor of |modulus| it shares.
+// Throws invalid_argument exception if |modulus| is not positive.
+template <typename T>
+PartialInverse<T> partial_inverse_mod(const T &number, const T &modulus) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "partial_inverse_mod arguments must be integers.");
+  if (modulus <= 0)
+    throw std::invalid_argument("The modulus must be positive.");
+  using U = std::make_unsigned_t<T>;
+  auto [gcd, inverse] = modular_internal::partial_inverse<U>(
+      static_cast<U>(modular_internal::normalize(number, modulus)),
+      static_cast<U>(modulus));
+  return {static_cast<T>(gcd), static_cast<T>(inverse)};
+}
+
+// Returns the modular inverse of |number| in modulo the odd |modulus| in a
+// time which does not depend on |number|, for secret numbers such as keys. It
+// takes 2 * bits iterations of shifts, subtractions and masks, which is a few
+// times slower than inverse_mod.
+// Throws invalid_argument exception if |modulus| is not odd and positive, or
+// |number| is not in [0, |modulus|). Throws domain_error exception if the
+// inverse does not exist.
+template <typename T>
+T inverse_mod_constant_time(const T &number, const T &modulus) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "inverse_mod_constant_time arguments must be integers.");
+  if (modulus <= 0 || modulus % 2 == 0)
+    throw std::invalid_argument("The modulus must be odd and positive.");
+  if (number < 0 || number >= modulus)
+    throw std::invalid_argument("The number must be in [0, modulus).");
+  using U = std::make_unsigned_t<T>;
+  return static_cast<T>(modular_internal::constant_time_inverse<U>(
+      static_cast<U>(number), static_cast<U>(modulus)));
+}
+
 // Ring of integers modulo |mod|.
 template <modular_internal::ModulusWrapper mod>
 class Modular {
@@ -132,10 +452,19 @@ class Modular {
   // Subtraction in the modular ring.
   Modular subtract(const Modular &rhs) const { return add(rhs.negate()); }
 
-  // Multiplication in the modular ring.
+  // Multiplication in the modular ring. If the product may overflow the type,
+  // it is computed in wider or Montgomery arithmetic, for moduli up to 2^127.
   Modular multiply(const Modular &rhs) const {
     check_multiplication_overflow();
-    return Modular(value_ * rhs.value_);
+    if constexpr (modulus_width * 2 <= type_width) {
+      return Modular(value_ * rhs.value_);
+    } else {
+      using U = std::conditional_t<type_width <= 64, uint64_t,
+                                   unsigned __int128>;
+      return Modular(static_cast<type>(
+          modular_internal::multiply_wide<U, static_cast<U>(modulus)>(
+              static_cast<U>(value_), static_cast<U>(rhs.value_))));
+    }
   }
 
   // Division in the modular ring. Throws std::domain_error if the
@@ -145,6 +474,28 @@ class Modular {
   // Multiplicative inverse in the modular ring.
   Modular inverse() const { return inverse_mod(value_, modulus); }
 
+  // Returns whether the value has a multiplicative inverse. The structure of
+  // the modulus is known at compile time: this is a comparison for prime
+  // moduli and a parity check for powers of two, and a gcd otherwise.
+  bool is_unit() const {
+    using Unsigned = std::make_unsigned_t<type>;
+    constexpr auto kModulus = static_cast<Unsigned>(modulus);
+    if constexpr (prime_internal::is_prime_u128(kModulus))
+      return value_ != 0;
+    else if constexpr (std::has_single_bit(kModulus))
+      return value_ % 2 != 0 || kModulus == 1;
+    else
+      return std::gcd(static_cast<Unsigned>(value_), kModulus) == 1;
+  }
+
+  // Multiplicative inverse in a time which does not depend on the value, for
+  // secret values. This is only available for odd moduli.
+  Modular constant_time_inverse() const {
+    static_assert(modulus % 2 != 0,
+                  "constant_time_inverse requires an odd modulus.");
+    return inverse_mod_constant_time(value_, modulus);
+  }
+
   // Compares for equality.
   bool equal(const Modular &rhs) const { return value_ == rhs.value_; }
   bool not_equal(const Modular &rhs) const { return !equal(rhs); }
@@ -165,9 +516,10 @@ class Modular {
         "Modular addition may overflow. Please use larger integer types.");
   }
 
-  // Emits a compilation error if multiplication may overflow.
+  // Emits a compilation error if multiplication may overflow, which is only
+  // possible for types wider than 128 bits.
   void check_multiplication_overflow() const {
-    static_assert(modulus_width * 2 <= type_width,
+    static_assert(modulus_width * 2 <= type_width || type_width <= 128,
                   "Modular multiplication may overflow. "
                   "Please use larger integer types.");
   }
@@ -300,7 +652,12 @@ std::ostream &operator<<(std::ostream &stream, const M &modular) {
 }  // namespace number_theory
 
 using number_theory::inverse_mod;
+using number_theory::inverse_mod_binary;
+using number_theory::inverse_mod_constant_time;
 using number_theory::Modular;
+using number_theory::partial_inverse_mod;
+using number_theory::PartialInverse;
+using number_theory::sqrt_mod;
 
 }  // namespace tql
 
@@ -0,0 +1,363 @@
+#ifndef NUMBER_THEORY_MODULAR_IO_H_
+#define NUMBER_THEORY_MODULAR_IO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "number_theory/modular.h"
+
+// Bulk input and output of Modular values, in text and in binary.
+
+namespace tql {
+namespace number_theory {
+
+namespace modular_io_internal {
+
+// The size of the blocks in which values are written.
+inline constexpr size_t kBlockSize = 1 << 16;
+
+// Returns whether |c| separates the numbers in text.
+constexpr bool is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+// Returns the 8 bytes at |p| as a little-endian word.
+inline uint64_t load_word(const char *p) {
+  uint64_t word = 0;
+  for (int i = 0; i < 8; ++i)
+    word |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+  return word;
+}
+
+// Returns whether the 8 bytes of |word| are all ASCII digits. Adding 6 to a
+// digit keeps its high nibble 3, while any other byte with the high nibble 3
+// carries into it.
+constexpr bool are_digits(uint64_t word) {
+  return ((word & 0xf0f0f0f0f0f0f0f0) |
+          (((word + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// Returns the 8-digit number of the ASCII digits in |word|, the first digit in
+// the lowest byte. The digits are combined in pairs, quads and halves, with
+// three multiplications in total.
+constexpr uint32_t parse_digits(uint64_t word) {
+  word -= 0x3030303030303030;
+  word = word * 10 + (word >> 8);
+  word = ((word & 0x000000ff000000ff) * (100 + (1000000ULL << 32)) +
+          ((word >> 16) & 0x000000ff000000ff) * (1 + (10000ULL << 32))) >>
+         32;
+  return static_cast<uint32_t>(word);
+}
+
+// Parses the number at |p| into |value|, and advances |p| past it. The number
+// is an optional minus sign followed by digits, and must be followed by a
+// space or |end|.
+// Throws invalid_argument exception if the number is malformed, or
+// out_of_range exception if it does not fit T.
+template <typename T>
+void parse_number(const char *&p, const char *end, T &value) {
+  // The digits are accumulated in at least 64 bits.
+  using U = std::conditional_t<sizeof(T) < sizeof(uint64_t), uint64_t,
+                               std::make_unsigned_t<T>>;
+  bool negative = false;
+  if constexpr (std::numeric_limits<T>::is_signed) {
+    if (p != end && *p == '-') {
+      negative = true;
+      ++p;
+    }
+  }
+  const char *digits = p;
+  U magnitude = 0;
+  bool overflow = false;
+  for (; end - p >= 8; p += 8) {
+    uint64_t word = load_word(p);
+    if (!are_digits(word))
+      break;
+    overflow |= __builtin_mul_overflow(magnitude, U(100000000), &magnitude);
+    overflow |= __builtin_add_overflow(magnitude, U(parse_digits(word)),
+                                       &magnitude);
+  }
+  for (; p != end && static_cast<unsigned char>(*p - '0') < 10; ++p) {
+    overflow |= __builtin_mul_overflow(magnitude, U(10), &magnitude);
+    overflow |= __builtin_add_overflow(magnitude, U(*p - '0'), &magnitude);
+  }
+  if (p == digits || (p != end && !is_space(*p)))
+    throw std::invalid_argument("The input is not a number.");
+  auto limit = static_cast<U>(std::numeric_limits<T>::max());
+  if (overflow || magnitude > limit + negative)
+    throw std::out_of_range("The number does not fit the type.");
+  value = static_cast<T>(negative ? U(0) - magnitude : magnitude);
+}
+
+// The two digits of each number below 100.
+inline constexpr auto kDigitPairs = [] {
+  std::array<char, 200> pairs{};
+  for (int i = 0; i < 100; ++i) {
+    pairs[2 * i] = static_cast<char>('0' + i / 10);
+    pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+  }
+  return pairs;
+}();
+
+// Writes the digits of |value| >= 0 to the end of the buffer ending at |end|,
+// and returns the beginning.
+template <typename T>
+char *format_number(T value, char *end) {
+  auto x = static_cast<std::make_unsigned_t<T>>(value);
+  while (x >= 100) {
+    const char *pair = &kDigitPairs[2 * (x % 100)];
+    x /= 100;
+    *--end = pair[1];
+    *--end = pair[0];
+  }
+  if (x >= 10) {
+    *--end = kDigitPairs[2 * x + 1];
+    *--end = kDigitPairs[2 * x];
+  } else {
+    *--end = static_cast<char>('0' + x);
+  }
+  return end;
+}
+
+// Checks that Modular M can be copied to and from its binary format.
+template <ModularType M>
+constexpr void check_layout() {
+  static_assert(sizeof(M) == sizeof(typename M::type) &&
+                    std::is_trivially_copyable_v<M>,
+                "Modular must have the layout of its type.");
+}
+
+// Returns whether all |values| copied from the binary format are in
+// [0, modulus). The values are checked without branches, so that the loop is
+// vectorized.
+template <ModularType M>
+bool are_reduced(std::span<const M> values) {
+  using T = typename M::type;
+  bool reduced = true;
+  for (const M &value : values) {
+    T x = value.get();
+    if constexpr (std::numeric_limits<T>::is_signed)
+      reduced &= (x >= 0) & (x < M::modulus);
+    else
+      reduced &= x < M::modulus;
+  }
+  return reduced;
+}
+
+// Converts |values| between the little-endian binary format and the native
+// byte order, in place.
+template <ModularType M>
+void convert_byte_order(std::span<M> values) {
+  if constexpr (std::endian::native != std::endian::little) {
+    for (M &value : values) {
+      auto *bytes = reinterpret_cast<unsigned char *>(&value);
+      std::reverse(bytes, bytes + sizeof(M));
+    }
+  }
+}
+
+// Reduces |values| copied from the binary format, unless they are reduced
+// already.
+template <ModularType M>
+void reduce(std::span<M> values) {
+  convert_byte_order(values);
+  if (are_reduced<M>(values))
+    return;
+  for (M &value : values)
+    value.set(value.get());
+}
+
+}  // namespace modular_io_internal
+
+// Parses the numbers separated by spaces at the beginning of |text| into
+// |values|, reducing them modulo M::modulus. The digits are parsed 8 at a time
+// with SWAR, and no locale is involved. Returns the rest of |text| after the
+// last number.
+// Throws invalid_argument exception if |text| has fewer numbers than |values|
+// or a malformed number, or out_of_range exception if a number does not fit
+// M::type.
+template <ModularType M>
+std::string_view read_modular(std::span<M> values, std::string_view text) {
+  const char *p = text.data();
+  const char *end = p + text.size();
+  for (M &value : values) {
+    while (p != end && modular_io_internal::is_space(*p))
+      ++p;
+    if (p == end)
+      throw std::invalid_argument("The input ends early.");
+    typename M::type x;
+    modular_io_internal::parse_number(p, end, x);
+    value.set(x);
+  }
+  return std::string_view(p, end - p);
+}
+
+// Parses the numbers separated by spaces from |stream| into |values|, as the
+// overload for text does. The stream buffer is read directly, without the
+// formatting of |stream|, and stops right after the last number. For the
+// fastest parsing, map the whole input and use the overload for text.
+// Throws invalid_argument exception if |stream| has fewer numbers than
+// |values| or a malformed number, or out_of_range exception if a number does
+// not fit M::type.
+template <ModularType M>
+void read_modular(std::span<M> values, std::istream &stream) {
+  using Traits = std::istream::traits_type;
+  std::streambuf &buffer = *stream.rdbuf();
+  // Enough for any number without its leading zeros.
+  char token[48];
+  for (M &value : values) {
+    int c = buffer.sgetc();
+    while (c != Traits::eof() &&
+           modular_io_internal::is_space(Traits::to_char_type(c))) {
+      c = buffer.snextc();
+    }
+    if (c == Traits::eof())
+      throw std::invalid_argument("The input ends early.");
+    size_t size = 0;
+    if (c == '-') {
+      token[size++] = '-';
+      c = buffer.snextc();
+    }
+    // Leading zeros are dropped, so that they do not fill |token|.
+    bool zeros = false;
+    for (; c == '0'; c = buffer.snextc())
+      zeros = true;
+    if (zeros && (c == Traits::eof() ||
+                  static_cast<unsigned>(c - '0') >= 10)) {
+      token[size++] = '0';
+    }
+    for (; c != Traits::eof() &&
+           !modular_io_internal::is_space(Traits::to_char_type(c));
+         c = buffer.snextc()) {
+      if (size == sizeof(token))
+        throw std::out_of_range("The number does not fit the type.");
+      token[size++] = Traits::to_char_type(c);
+    }
+    const char *p = token;
+    typename M::type x;
+    modular_io_internal::parse_number(p, token + size, x);
+    value.set(x);
+  }
+}
+
+// Writes |values| to |stream| in text, each followed by |separator|. The
+// values are formatted into blocks without the formatting of |stream|.
+template <ModularType M>
+void write_modular(std::span<const M> values, std::ostream &stream,
+                   char separator = '\n') {
+  // The digits and the separator.
+  constexpr size_t kMaxSize =
+      std::numeric_limits<typename M::type>::digits10 + 2;
+  std::vector<char> block(modular_io_internal::kBlockSize);
+  char number[kMaxSize];
+  size_t size = 0;
+  for (const M &value : values) {
+    if (block.size() - size < kMaxSize) {
+      stream.write(block.data(), size);
+      size = 0;
+    }
+    char *begin = modular_io_internal::format_number(value.get(),
+                                                     number + kMaxSize);
+    size = std::copy(begin, number + kMaxSize, block.data() + size) -
+           block.data();
+    block[size++] = separator;
+  }
+  stream.write(block.data(), size);
+}
+
+// Binary format of Modular values: each value is M::type in little-endian
+// two's complement, without padding or a header.
+
+// Writes |values| to |stream| in the binary format.
+template <ModularType M>
+void write_modular_binary(std::span<const M> values, std::ostream &stream) {
+  modular_io_internal::check_layout<M>();
+  if constexpr (std::endian::native == std::endian::little) {
+    stream.write(reinterpret_cast<const char *>(values.data()),
+                 values.size_bytes());
+  } else {
+    std::vector<M> block;
+    for (size_t i = 0; i < values.size(); i += block.size()) {
+      block.assign(values.begin() + i,
+                   values.begin() + std::min(values.size(), i + 1024));
+      modular_io_internal::convert_byte_order<M>(block);
+      stream.write(reinterpret_cast<const char *>(block.data()),
+                   block.size() * sizeof(M));
+    }
+  }
+}
+
+// Copies |values| from |bytes| in the binary format, reducing them modulo
+// M::modulus unless all of them are reduced already.
+// Throws invalid_argument exception if the size of |bytes| mismatches.
+template <ModularType M>
+void read_modular_binary(std::span<M> values,
+                         std::span<const std::byte> bytes) {
+  modular_io_internal::check_layout<M>();
+  if (bytes.size() != values.size_bytes())
+    throw std::invalid_argument("The input has a wrong size.");
+  memcpy(values.data(), bytes.data(), bytes.size());
+  modular_io_internal::reduce(values);
+}
+
+// Reads |values| from |stream| in the binary format, directly into their
+// memory, reducing them modulo M::modulus unless all of them are reduced
+// already.
+// Throws invalid_argument exception if |stream| ends early.
+template <ModularType M>
+void read_modular_binary(std::span<M> values, std::istream &stream) {
+  modular_io_internal::check_layout<M>();
+  stream.read(reinterpret_cast<char *>(values.data()), values.size_bytes());
+  if (static_cast<size_t>(stream.gcount()) != values.size_bytes())
+    throw std::invalid_argument("The input ends early.");
+  modular_io_internal::reduce(values);
+}
+
+// Returns the values in |bytes| in the binary format without copying them,
+// for example from a mapped file. This is only available on little-endian
+// machines.
+// Throws invalid_argument exception if |bytes| is not aligned for M or its size
+// is not a multiple of M, or out_of_range exception if a value is not reduced
+// modulo M::modulus.
+template <ModularType M>
+std::span<const M> view_modular_binary(std::span<const std::byte> bytes) {
+  static_assert(std::endian::native == std::endian::little,
+                "view_modular_binary requires a little-endian machine.");
+  modular_io_internal::check_layout<M>();
+  if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(M) != 0 ||
+      bytes.size() % sizeof(M) != 0) {
+    throw std::invalid_argument("The input is not aligned for the values.");
+  }
+  std::span<const M> values(reinterpret_cast<const M *>(bytes.data()),
+                            bytes.size() / sizeof(M));
+  if (!modular_io_internal::are_reduced<M>(values))
+    throw std::out_of_range("The values are not reduced.");
+  return values;
+}
+
+}  // namespace number_theory
+
+using number_theory::read_modular;
+using number_theory::read_modular_binary;
+using number_theory::view_modular_binary;
+using number_theory::write_modular;
+using number_theory::write_modular_binary;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_MODULAR_IO_H_
@@ -0,0 +1,150 @@
+#include <stdint.h>
+
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/modular.h"
+#include "number_theory/modular_io.h"
+
+namespace tql::number_theory {
+
+template <typename T>
+void test_read_modular() {
+  using Mod = Modular<T(1000000007)>;
+  std::vector<Mod> values(6);
+  std::string_view rest = read_modular(
+      std::span(values), "  1 -3\n1000000007\t1234567890 00000042 7  9");
+  EXPECT_EQ(values, (std::vector<Mod>{1, -3, 0, 234567883, 42, 7}));
+  EXPECT_EQ(rest, "  9");
+
+  std::istringstream stream(" -0 0 1000000008 1234567890\n000 5");
+  read_modular(std::span(values).first(5), stream);
+  EXPECT_EQ(values[0], 0);
+  EXPECT_EQ(values[1], 0);
+  EXPECT_EQ(values[2], 1);
+  EXPECT_EQ(values[3], 234567883);
+  EXPECT_EQ(values[4], 0);
+  std::string rest_of_stream;
+  std::getline(stream, rest_of_stream);
+  EXPECT_EQ(rest_of_stream, " 5");
+
+  EXPECT_THROW(read_modular(std::span(values), "1 2 3"),
+               std::invalid_argument);
+  EXPECT_THROW(read_modular(std::span(values).first(1), "12a"),
+               std::invalid_argument);
+  EXPECT_THROW(read_modular(std::span(values).first(1), "-"),
+               std::invalid_argument);
+  EXPECT_THROW(read_modular(std::span(values).first(1), "--1"),
+               std::invalid_argument);
+  std::string max = std::to_string(std::numeric_limits<T>::max());
+  std::string min = std::to_string(std::numeric_limits<T>::min());
+  read_modular(std::span(values).first(2), max + " " + min);
+  EXPECT_EQ(values[0], Mod(std::numeric_limits<T>::max()));
+  EXPECT_EQ(values[1], Mod(std::numeric_limits<T>::min()));
+  EXPECT_THROW(read_modular(std::span(values).first(1), max + "0"),
+               std::out_of_range);
+  std::istringstream long_stream(std::string(100, '0') + "1 " + max + "0");
+  read_modular(std::span(values).first(1), long_stream);
+  EXPECT_EQ(values[0], 1);
+  EXPECT_THROW(read_modular(std::span(values).first(1), long_stream),
+               std::out_of_range);
+}
+
+TEST(ModularIOTest, ReadModular) {
+  test_read_modular<int32_t>();
+  test_read_modular<int64_t>();
+
+  using Mod128 = Modular<(__int128(1) << 100) + 1>;
+  std::vector<Mod128> wide(3);
+  read_modular(std::span(wide),
+               "170141183460469231731687303715884105727 "
+               "-170141183460469231731687303715884105728 "
+               "1267650600228229401496703205377");
+  EXPECT_TRUE(wide[0] == std::numeric_limits<__int128>::max());
+  EXPECT_TRUE(wide[1] == std::numeric_limits<__int128>::min());
+  EXPECT_TRUE(wide[2] == 0);
+  EXPECT_THROW(read_modular(std::span(wide).first(1),
+                            "170141183460469231731687303715884105728"),
+               std::out_of_range);
+
+  using Mod = Modular<uint8_t(7)>;
+  Mod value;
+  read_modular(std::span(&value, 1), "255");
+  EXPECT_EQ(value, 3);
+  EXPECT_THROW(read_modular(std::span(&value, 1), "256"), std::out_of_range);
+  EXPECT_THROW(read_modular(std::span(&value, 1), "-1"),
+               std::invalid_argument);
+}
+
+TEST(ModularIOTest, WriteModular) {
+  using Mod = Modular<uint64_t(1) << 63>;
+  std::mt19937_64 generator;
+  std::vector<Mod> values(100000);
+  for (Mod &value : values)
+    value = generator() >> (generator() % 64);
+  std::ostringstream stream;
+  write_modular<Mod>(values, stream);
+  std::ostringstream expected;
+  for (const Mod &value : values)
+    expected << value << '\n';
+  EXPECT_EQ(stream.str(), expected.str());
+
+  std::vector<Mod> parsed(values.size());
+  EXPECT_EQ(read_modular(std::span(parsed), stream.str()), "\n");
+  EXPECT_EQ(parsed, values);
+
+  std::ostringstream spaced;
+  write_modular<Modular<__int128(10)>>(
+      std::vector<Modular<__int128(10)>>{0, 9, 13}, spaced, ' ');
+  EXPECT_EQ(spaced.str(), "0 9 3 ");
+}
+
+TEST(ModularIOTest, Binary) {
+  using Mod = Modular<uint32_t(4000000000)>;
+  std::vector<Mod> values = {0, 1, 3999999999, 123456789};
+  std::ostringstream output;
+  write_modular_binary<Mod>(values, output);
+  std::string bytes = output.str();
+  EXPECT_EQ(bytes.substr(4, 4), std::string("\1\0\0\0", 4));
+  EXPECT_EQ(bytes.size(), values.size() * 4);
+
+  std::vector<Mod> read(values.size());
+  read_modular_binary(std::span(read), std::as_bytes(std::span(bytes)));
+  EXPECT_EQ(read, values);
+  std::istringstream input(bytes);
+  read_modular_binary(std::span(read), input);
+  EXPECT_EQ(read, values);
+  EXPECT_THROW(read_modular_binary(std::span(read), input),
+               std::invalid_argument);
+  EXPECT_THROW(read_modular_binary(std::span(read).first(1),
+                                   std::as_bytes(std::span(bytes))),
+               std::invalid_argument);
+
+  alignas(Mod) std::byte aligned[16];
+  std::copy_n(std::as_bytes(std::span(bytes)).begin(), 16, aligned);
+  std::span<const Mod> view = view_modular_binary<Mod>(aligned);
+  EXPECT_EQ(view.data(), reinterpret_cast<const Mod *>(aligned));
+  EXPECT_EQ(std::vector(view.begin(), view.end()), values);
+  EXPECT_THROW(view_modular_binary<Mod>(std::span(aligned).subspan(1, 8)),
+               std::invalid_argument);
+  EXPECT_THROW(view_modular_binary<Mod>(std::span(aligned).first(7)),
+               std::invalid_argument);
+
+  // Values which are not reduced are reduced when copied, but not viewed.
+  aligned[3] = std::byte(0xff);
+  EXPECT_THROW(view_modular_binary<Mod>(aligned), std::out_of_range);
+  read_modular_binary(std::span(read), std::span(aligned));
+  EXPECT_EQ(read[0], Mod(uint32_t(0xff000000)));
+  EXPECT_EQ(read[1], 1);
+}
+
+}  // namespace tql::number_theory
@@ -1,14 +1,18 @@
 #include <stdint.h>
 
+#include <algorithm>
 #include <limits>
+#include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "number_theory/modular.h"
+#include "number_theory/wide_integer.h"
 
 namespace tql::number_theory {
 
@@ -219,7 +223,75 @@ void test_modular_inverse() {
   EXPECT_THROW(Mod10(num).inverse(), std::domain_error);
 }
 
+// Checks inverse_mod, inverse_mod_binary and inverse_mod_constant_time
+// against exgcd for all numbers modulo |modulus|.
+template <typename T>
+void test_binary_inverse(T modulus) {
+  for (T number = 0; number < modulus; ++number) {
+    auto [x, y] = exgcd(number, modulus);
+    if (x * number + y * modulus != 1) {
+      EXPECT_THROW(inverse_mod(number, modulus), std::domain_error);
+      if (modulus % 2 != 0) {
+        EXPECT_THROW(inverse_mod_binary(number, modulus), std::domain_error);
+        EXPECT_THROW(inverse_mod_constant_time(number, modulus),
+                     std::domain_error);
+      }
+      continue;
+    }
+    auto inverse = static_cast<T>((int64_t(x) % modulus + modulus) % modulus);
+    EXPECT_EQ(inverse_mod(number, modulus), inverse);
+    if (modulus % 2 != 0) {
+      EXPECT_EQ(inverse_mod_binary(number, modulus), inverse);
+      EXPECT_EQ(inverse_mod_constant_time(number, modulus), inverse);
+    }
+  }
+}
+
 TEST(ModularTest, Inverse) {
+  for (int modulus : {1, 2, 3, 9, 15, 64, 101, 105, 255})
+    test_binary_inverse(modulus);
+  test_binary_inverse<uint8_t>(127);
+  test_binary_inverse<int16_t>(32767);
+
+  // Large prime moduli, up to the largest primes of the types.
+  using u128 = unsigned __int128;
+  for (uint64_t modulus : {uint64_t(998244353), (uint64_t(1) << 61) - 1,
+                           ~uint64_t(0) - 58}) {
+    for (uint64_t number : {uint64_t(1), uint64_t(2), modulus - 1,
+                            modulus / 3, uint64_t(1) << 40}) {
+      uint64_t inverse = inverse_mod(number, modulus);
+      EXPECT_EQ(u128(inverse) * number % modulus, 1u);
+      EXPECT_EQ(inverse_mod_binary(number, modulus), inverse);
+      EXPECT_EQ(inverse_mod_constant_time(number % modulus, modulus), inverse);
+    }
+  }
+  for (u128 modulus : {(u128(1) << 127) - 1, ~u128(0) - 158}) {
+    for (u128 number : {u128(2), modulus - 1, modulus / 3, u128(1) << 100}) {
+      u128 inverse = inverse_mod(number, modulus);
+      EXPECT_TRUE(multiply_mod(UInt256(inverse), UInt256(number),
+                               UInt256(modulus)) == 1);
+      EXPECT_TRUE(inverse_mod_binary(number, modulus) == inverse);
+      EXPECT_TRUE(inverse_mod_constant_time(number, modulus) == inverse);
+    }
+  }
+  EXPECT_THROW(inverse_mod(u128(3), ~u128(0)), std::domain_error);
+  EXPECT_THROW(inverse_mod_constant_time(u128(3), ~u128(0)),
+               std::domain_error);
+  EXPECT_THROW(inverse_mod_constant_time(2, 10), std::invalid_argument);
+  EXPECT_THROW(inverse_mod_constant_time(11, 9), std::invalid_argument);
+  EXPECT_THROW(inverse_mod_constant_time(-1, 9), std::invalid_argument);
+  EXPECT_EQ(inverse_mod(-2, 9), 4);
+  // Multiples of the modulus have no inverse.
+  EXPECT_THROW(inverse_mod_binary<uint64_t>(0, 7), std::domain_error);
+  EXPECT_THROW(inverse_mod_binary(14, 7), std::domain_error);
+  EXPECT_THROW(inverse_mod(~uint64_t(0), ~uint64_t(0)), std::domain_error);
+  EXPECT_EQ(inverse_mod_binary(7, 1), 0);
+  EXPECT_THROW(inverse_mod_binary(3, 10), std::invalid_argument);
+
+  using Mod = Modular<998244353>;
+  EXPECT_EQ(Mod(3).constant_time_inverse(), Mod(3).inverse());
+  EXPECT_EQ(Mod(3).constant_time_inverse() * 3, 1);
+
   test_modular_inverse<int8_t>();
   test_modular_inverse<int16_t>();
   test_modular_inverse<int32_t>();
@@ -230,4 +302,130 @@ TEST(ModularTest, Inverse) {
   test_modular_inverse<uint64_t>();
 }
 
+// Checks the multiplication of Modular<mod> against |multiply|, which computes
+// the product of two values in wider arithmetic.
+template <auto mod, typename Function>
+void test_wide_modulus(Function multiply) {
+  using Mod = Modular<mod>;
+  using T = typename Mod::type;
+  T m = Mod::modulus;
+  std::vector<T> values = {0, 1, 2, m / 2, m / 3 + 5, m - 2, m - 1};
+  for (T a : values) {
+    for (T b : values) {
+      EXPECT_TRUE(Mod(a) * Mod(b) == multiply(a, b));
+      EXPECT_TRUE(Mod(a) + Mod(b) == (a >= m - b ? a - (m - b) : a + b));
+    }
+  }
+}
+
+TEST(ModularTest, WideModulus) {
+  using u128 = unsigned __int128;
+  // Odd and even moduli, which do not fit the product of their types.
+  auto multiply_u64 = [](auto modulus) {
+    return [=](uint64_t a, uint64_t b) {
+      return static_cast<uint64_t>(u128(a) * b % modulus);
+    };
+  };
+  test_wide_modulus<uint64_t(9223372036854775783u)>(
+      multiply_u64(9223372036854775783u));
+  test_wide_modulus<(uint64_t(1) << 63) - 2>(
+      multiply_u64((uint64_t(1) << 63) - 2));
+  test_wide_modulus<int64_t(4611686018427387847)>(
+      multiply_u64(4611686018427387847));
+
+  // 2^127 - 1 and 2^127 - 2, against the 256-bit arithmetic.
+  constexpr u128 kPrime = (u128(1) << 127) - 1;
+  auto multiply_u128 = [](u128 modulus) {
+    return [=](u128 a, u128 b) {
+      return static_cast<u128>(multiply_mod(UInt256(a), UInt256(b),
+                                            UInt256(modulus)));
+    };
+  };
+  test_wide_modulus<kPrime>(multiply_u128(kPrime));
+  test_wide_modulus<kPrime - 1>(multiply_u128(kPrime - 1));
+  test_wide_modulus<__int128(1000000000000000000) * 1000000000000000000 + 3>(
+      multiply_u128(u128(1000000000000000000) * 1000000000000000000 + 3));
+
+  using Mod = Modular<kPrime>;
+  Mod a = (u128(1) << 100) + 12345;
+  EXPECT_TRUE(pow(a, kPrime - 1) == 1);
+  EXPECT_TRUE(pow(a, kPrime) == a);
+  EXPECT_TRUE(a * a.inverse() == 1);
+  EXPECT_TRUE(a / a == 1);
+  EXPECT_TRUE(-a + a == 0);
+  Mod b = a;
+  b *= a;
+  b /= a;
+  EXPECT_TRUE(b == a);
+  EXPECT_TRUE(Mod(kPrime - 1) * Mod(kPrime - 1) == 1);
+}
+
+TEST(ModularTest, PartialInverse) {
+  for (int modulus : {1, 12, 13, 360}) {
+    for (int number = -modulus; number < 2 * modulus; ++number) {
+      PartialInverse<int> partial = partial_inverse_mod(number, modulus);
+      int normalized = (number % modulus + modulus) % modulus;
+      EXPECT_EQ(partial.gcd, std::gcd(normalized, modulus));
+      EXPECT_GE(partial.inverse, 0);
+      EXPECT_LT(partial.inverse, modulus);
+      EXPECT_EQ(normalized * partial.inverse % modulus,
+                partial.gcd % modulus);
+    }
+  }
+  EXPECT_EQ(partial_inverse_mod(uint64_t(6), uint64_t(10)),
+            (PartialInverse<uint64_t>{2, 2}));
+  EXPECT_THROW(partial_inverse_mod(1, 0), std::invalid_argument);
+
+  // Moduli near the limits of the types.
+  using u128 = unsigned __int128;
+  auto check = [](uint64_t number, uint64_t modulus, uint64_t gcd) {
+    PartialInverse<uint64_t> partial = partial_inverse_mod(number, modulus);
+    EXPECT_EQ(partial.gcd, gcd);
+    EXPECT_LT(partial.inverse, modulus);
+    EXPECT_EQ(u128(number % modulus) * partial.inverse % modulus,
+              gcd % modulus);
+  };
+  check(3000000000000000019, 4000000000000000037, 1);
+  check(6, (uint64_t(1) << 63) | 2, 2);
+  check(~uint64_t(0) - 1, ~uint64_t(0), 1);
+  check(uint64_t(3) << 62, uint64_t(1) << 63, uint64_t(1) << 62);
+  PartialInverse<int64_t> partial = partial_inverse_mod<int64_t>(
+      3000000000000000019, 4000000000000000037);
+  EXPECT_EQ(partial.gcd, 1);
+  EXPECT_EQ(u128(3000000000000000019) * u128(partial.inverse) %
+                4000000000000000037,
+            1u);
+  EXPECT_EQ(partial_inverse_mod(~u128(0) - 2, ~u128(0)).gcd, 1u);
+}
+
+TEST(ModularTest, IsUnit) {
+  for (int value = 0; value < 64; ++value) {
+    EXPECT_EQ(Modular<64>(value).is_unit(), value % 2 == 1);
+    EXPECT_EQ(Modular<61>(value).is_unit(), value % 61 != 0);
+    EXPECT_EQ(Modular<60>(value).is_unit(), std::gcd(value, 60) == 1);
+  }
+  EXPECT_TRUE(Modular<1>(0).is_unit());
+  using u128 = unsigned __int128;
+  EXPECT_TRUE(Modular<(u128(1) << 127) - 1>(2).is_unit());
+  EXPECT_FALSE(Modular<(u128(1) << 127) - 2>(2).is_unit());
+}
+
+TEST(ModularTest, SqrtMod) {
+  for (uint64_t p : {2, 3, 5, 13, 17, 97, 257, 65537, 998244353}) {
+    for (uint64_t a = 0; a < std::min<uint64_t>(p, 300); ++a) {
+      uint64_t square = a * a % p;
+      uint64_t root = sqrt_mod(square, p);
+      EXPECT_LE(root, p - root);
+      EXPECT_EQ(root * root % p, square);
+    }
+  }
+  // 2^64 - 59 is a prime with p = 5 (mod 8).
+  uint64_t p = 18446744073709551557u;
+  uint64_t root = sqrt_mod(uint64_t(123456789) * 123456789 % p, p);
+  EXPECT_EQ(root, 123456789u);
+  EXPECT_EQ(sqrt_mod(-4, 13), 3);
+  EXPECT_THROW(sqrt_mod(2, 5), std::domain_error);
+  EXPECT_THROW(sqrt_mod(3, 0), std::invalid_argument);
+}
+
 }  // namespace tql::number_theory
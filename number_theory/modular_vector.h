@@ -0,0 +1,380 @@
+#ifndef NUMBER_THEORY_MODULAR_VECTOR_H_
+#define NUMBER_THEORY_MODULAR_VECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "number_theory/memory.h"
+#include "number_theory/modular.h"
+
+// Vectors of Modular values with bulk element-wise arithmetic.
+
+namespace tql {
+namespace number_theory {
+
+namespace modular_vector_internal {
+
+// Arithmetic in 32-bit lanes for a modulus below 2^31, with Montgomery
+// multiplication with R = 2^32 for odd moduli. Every operation is a few
+// 32x32-bit multiplications and a minimum, without branches and divisions, so
+// that the loops over arrays are vectorized.
+class Montgomery32 {
+ public:
+  constexpr explicit Montgomery32(uint32_t modulus)
+      : modulus_(modulus), odd_(modulus % 2 != 0) {
+    if (!odd_)
+      return;
+    // Newton's iteration doubles the correct low bits of the inverse.
+    uint32_t inverse = modulus;
+    for (int i = 0; i < 4; ++i)
+      inverse *= 2 - modulus * inverse;
+    negative_inverse_ = 0 - inverse;
+    r2_ = static_cast<uint32_t>((uint64_t(1) << 63) % modulus * 2 % modulus);
+  }
+
+  constexpr uint32_t modulus() const { return modulus_; }
+
+  // Returns whether the Montgomery reduction is available.
+  constexpr bool odd() const { return odd_; }
+
+  // Returns |a| + |b| modulo the modulus for |a|, |b| in [0, modulus).
+  constexpr uint32_t add(uint32_t a, uint32_t b) const {
+    uint32_t sum = a + b;
+    return std::min(sum, sum - modulus_);
+  }
+
+  // Returns |a| - |b| modulo the modulus for |a|, |b| in [0, modulus).
+  constexpr uint32_t subtract(uint32_t a, uint32_t b) const {
+    uint32_t difference = a - b;
+    return std::min(difference, difference + modulus_);
+  }
+
+  // Returns |t| R^-1 modulo the odd modulus in [0, modulus) for
+  // |t| < modulus * R.
+  constexpr uint32_t reduce(uint64_t t) const {
+    uint32_t m = static_cast<uint32_t>(t) * negative_inverse_;
+    auto u = static_cast<uint32_t>((t + uint64_t(m) * modulus_) >> 32);
+    return std::min(u, u - modulus_);
+  }
+
+  // Returns the multiplier of |a| for multiply_prepared, which is |a| R.
+  constexpr uint32_t prepare(uint32_t a) const {
+    return reduce(uint64_t(a) * r2_);
+  }
+
+  // Returns |a| |b| modulo the odd modulus, where |prepared_b| is
+  // prepare(|b|).
+  constexpr uint32_t multiply_prepared(uint32_t a, uint32_t prepared_b) const {
+    return reduce(uint64_t(a) * prepared_b);
+  }
+
+  // Returns |a| |b| modulo the odd modulus.
+  constexpr uint32_t multiply(uint32_t a, uint32_t b) const {
+    return reduce(uint64_t(reduce(uint64_t(a) * b)) * r2_);
+  }
+
+ private:
+  uint32_t modulus_;
+  bool odd_;
+  uint32_t negative_inverse_ = 0;
+  uint32_t r2_ = 0;
+};
+
+// Returns whether the values of Modular M are stored in 32-bit lanes.
+template <ModularType M>
+constexpr bool uses_lanes() {
+  using T = typename M::type;
+  return std::numeric_limits<T>::digits <= 64 &&
+         static_cast<uint64_t>(M::modulus) < (uint64_t(1) << 31);
+}
+
+// Returns |sum| modulo |modulus|, for a sum of values below 2^32.
+constexpr uint32_t reduce_sum(uint64_t sum, uint32_t modulus) {
+  return static_cast<uint32_t>(sum % modulus);
+}
+
+}  // namespace modular_vector_internal
+
+// A vector of values in the ring of integers modulo |mod|, with vectorized
+// element-wise arithmetic.
+//
+// std::vector<Modular> does every operation through Modular::add and
+// Modular::multiply, whose normalization keeps the compiler from vectorizing
+// the loops. ModularVector stores only the values, in 32-bit lanes when the
+// modulus is below 2^31, aligned to cache lines. Its kernels are branch-free
+// loops, which the compiler vectorizes with the instruction set of the target
+// machine, for example -mavx2 or -mavx512f. Products by a scalar and dot
+// products use Montgomery reduction with R = 2^32 for odd moduli, which takes
+// one reduction per product. Element-wise products divide by the constant
+// modulus. Other moduli fall back to Modular arithmetic one value at a time.
+//
+// The allocator must allocate Modular<|mod>, and is rebound to the lanes.
+template <modular_internal::ModulusWrapper mod,
+          typename Allocator = AlignedAllocator<Modular<mod>>>
+class ModularVector {
+ public:
+  // The type of the values.
+  using value_type = Modular<mod>;
+  // The base type of the values in the ring.
+  using type = typename value_type::type;
+  // The allocator type.
+  using allocator_type = Allocator;
+
+ private:
+  static constexpr bool kUsesLanes =
+      modular_vector_internal::uses_lanes<value_type>();
+  using Lane = std::conditional_t<kUsesLanes, uint32_t, value_type>;
+  using LaneAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Lane>;
+  static constexpr auto kMontgomery = modular_vector_internal::Montgomery32(
+      kUsesLanes ? static_cast<uint32_t>(value_type::modulus) : 1);
+
+ public:
+  // Constructs a vector of |size| zeros.
+  explicit ModularVector(size_t size = 0,
+                         const Allocator &allocator = Allocator())
+      : lanes_(size, Lane(), LaneAllocator(allocator)) {}
+
+  // Constructs a vector of |values|.
+  explicit ModularVector(std::span<const value_type> values,
+                         const Allocator &allocator = Allocator())
+      : lanes_(values.size(), Lane(), LaneAllocator(allocator)) {
+    for (size_t i = 0; i < values.size(); ++i)
+      set(i, values[i]);
+  }
+
+  ModularVector(std::initializer_list<value_type> values,
+                const Allocator &allocator = Allocator())
+      : ModularVector(std::span(values.begin(), values.size()), allocator) {}
+
+  ModularVector(const ModularVector &) = default;
+  ModularVector(ModularVector &&) = default;
+  ModularVector &operator=(const ModularVector &) = default;
+  ModularVector &operator=(ModularVector &&) = default;
+
+  // Returns the number of values.
+  size_t size() const { return lanes_.size(); }
+  bool empty() const { return lanes_.empty(); }
+
+  // Resizes the vector to |size| values, appending zeros.
+  void resize(size_t size) { lanes_.resize(size, Lane()); }
+
+  // Returns the value at |index|.
+  value_type operator[](size_t index) const {
+    return value_type(static_cast<type>(lanes_[index]));
+  }
+
+  // Sets the value at |index| to |value|.
+  void set(size_t index, const value_type &value) {
+    lanes_[index] = static_cast<Lane>(value.get());
+  }
+
+  // Returns the values as Modular.
+  std::vector<value_type> to_vector() const {
+    std::vector<value_type> values(size());
+    for (size_t i = 0; i < size(); ++i)
+      values[i] = (*this)[i];
+    return values;
+  }
+
+  // Adds |rhs| element-wise.
+  // Throws invalid_argument exception if the sizes mismatch.
+  ModularVector &operator+=(const ModularVector &rhs) {
+    check_size(rhs);
+    Lane *x = lanes_.data();
+    const Lane *y = rhs.lanes_.data();
+    for (size_t i = 0; i < size(); ++i)
+      x[i] = add(x[i], y[i]);
+    return *this;
+  }
+
+  // Subtracts |rhs| element-wise.
+  // Throws invalid_argument exception if the sizes mismatch.
+  ModularVector &operator-=(const ModularVector &rhs) {
+    check_size(rhs);
+    Lane *x = lanes_.data();
+    const Lane *y = rhs.lanes_.data();
+    for (size_t i = 0; i < size(); ++i)
+      x[i] = subtract(x[i], y[i]);
+    return *this;
+  }
+
+  // Multiplies by |rhs| element-wise.
+  // Throws invalid_argument exception if the sizes mismatch.
+  //
+  // Neither operand is prepared, so a Montgomery product would take two
+  // reductions. The division by the constant modulus, which the compiler
+  // turns into multiplications, is faster unless the loop is vectorized with
+  // AVX2 or wider, and about as fast then.
+  ModularVector &operator*=(const ModularVector &rhs) {
+    check_size(rhs);
+    Lane *x = lanes_.data();
+    const Lane *y = rhs.lanes_.data();
+    for (size_t i = 0; i < size(); ++i)
+      x[i] = multiply(x[i], y[i]);
+    return *this;
+  }
+
+  // Multiplies every value by |scalar|.
+  ModularVector &operator*=(const value_type &scalar) {
+    Lane *x = lanes_.data();
+    if constexpr (kUsesLanes) {
+      if (kMontgomery.odd()) {
+        uint32_t prepared = kMontgomery.prepare(lane(scalar));
+        for (size_t i = 0; i < size(); ++i)
+          x[i] = kMontgomery.multiply_prepared(x[i], prepared);
+        return *this;
+      }
+    }
+    for (size_t i = 0; i < size(); ++i)
+      x[i] = multiply(x[i], lane(scalar));
+    return *this;
+  }
+
+  // Adds |a| * |x| element-wise.
+  // Throws invalid_argument exception if the sizes mismatch.
+  ModularVector &axpy(const value_type &a, const ModularVector &x) {
+    check_size(x);
+    Lane *y = lanes_.data();
+    const Lane *z = x.lanes_.data();
+    if constexpr (kUsesLanes) {
+      if (kMontgomery.odd()) {
+        uint32_t prepared = kMontgomery.prepare(lane(a));
+        for (size_t i = 0; i < size(); ++i)
+          y[i] = add(y[i], kMontgomery.multiply_prepared(z[i], prepared));
+        return *this;
+      }
+    }
+    for (size_t i = 0; i < size(); ++i)
+      y[i] = add(y[i], multiply(z[i], lane(a)));
+    return *this;
+  }
+
+  // Returns the sum of the values.
+  value_type sum() const {
+    if constexpr (kUsesLanes) {
+      // The lanes are summed without reduction in chunks of 2^32 values.
+      uint32_t result = 0;
+      for (size_t begin = 0; begin < size(); begin += kChunkSize) {
+        size_t end = std::min(size(), begin + kChunkSize);
+        const Lane *x = lanes_.data();
+        uint64_t chunk = 0;
+        for (size_t i = begin; i < end; ++i)
+          chunk += x[i];
+        result = add(result, modular_vector_internal::reduce_sum(
+                                 chunk, kMontgomery.modulus()));
+      }
+      return value_type(static_cast<type>(result));
+    } else {
+      value_type result = 0;
+      for (const Lane &x : lanes_)
+        result += x;
+      return result;
+    }
+  }
+
+  // Returns the dot product of |lhs| and |rhs|.
+  // Throws invalid_argument exception if the sizes mismatch.
+  friend value_type dot(const ModularVector &lhs, const ModularVector &rhs) {
+    lhs.check_size(rhs);
+    const Lane *x = lhs.lanes_.data();
+    const Lane *y = rhs.lanes_.data();
+    if constexpr (kUsesLanes) {
+      if (kMontgomery.odd()) {
+        // The products x y R^-1 are summed without reduction, and the sum is
+        // multiplied by R at the end.
+        uint32_t result = 0;
+        for (size_t begin = 0; begin < lhs.size(); begin += kChunkSize) {
+          size_t end = std::min(lhs.size(), begin + kChunkSize);
+          uint64_t chunk = 0;
+          for (size_t i = begin; i < end; ++i)
+            chunk += kMontgomery.reduce(uint64_t(x[i]) * y[i]);
+          result = add(result, modular_vector_internal::reduce_sum(
+                                   chunk, kMontgomery.modulus()));
+        }
+        return value_type(static_cast<type>(kMontgomery.prepare(result)));
+      }
+    }
+    Lane result = Lane();
+    for (size_t i = 0; i < lhs.size(); ++i)
+      result = add(result, multiply(x[i], y[i]));
+    return value_type(static_cast<type>(result));
+  }
+
+  friend ModularVector operator+(ModularVector lhs, const ModularVector &rhs) {
+    return lhs += rhs;
+  }
+  friend ModularVector operator-(ModularVector lhs, const ModularVector &rhs) {
+    return lhs -= rhs;
+  }
+  friend ModularVector operator*(ModularVector lhs, const ModularVector &rhs) {
+    return lhs *= rhs;
+  }
+  friend ModularVector operator*(ModularVector lhs, const value_type &rhs) {
+    return lhs *= rhs;
+  }
+  friend ModularVector operator*(const value_type &lhs, ModularVector rhs) {
+    return rhs *= lhs;
+  }
+
+  friend bool operator==(const ModularVector &lhs, const ModularVector &rhs) {
+    return std::equal(lhs.lanes_.begin(), lhs.lanes_.end(),
+                      rhs.lanes_.begin(), rhs.lanes_.end());
+  }
+
+ private:
+  // The number of lanes which are summed in 64 bits without overflow.
+  static constexpr size_t kChunkSize = size_t(1) << 32;
+
+  std::vector<Lane, LaneAllocator> lanes_;
+
+  // Throws invalid_argument exception if |other| has a different size.
+  void check_size(const ModularVector &other) const {
+    if (size() != other.size())
+      throw std::invalid_argument("The vectors must have the same size.");
+  }
+
+  static Lane lane(const value_type &value) {
+    return static_cast<Lane>(value.get());
+  }
+
+  static Lane add(Lane a, Lane b) {
+    if constexpr (kUsesLanes)
+      return kMontgomery.add(a, b);
+    else
+      return a + b;
+  }
+
+  static Lane subtract(Lane a, Lane b) {
+    if constexpr (kUsesLanes)
+      return kMontgomery.subtract(a, b);
+    else
+      return a - b;
+  }
+
+  // Multiplies the lanes by division, for the moduli without Montgomery
+  // reduction.
+  static Lane multiply(Lane a, Lane b) {
+    if constexpr (kUsesLanes)
+      return static_cast<Lane>(uint64_t(a) * b % kMontgomery.modulus());
+    else
+      return a * b;
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::ModularVector;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_MODULAR_VECTOR_H_
@@ -0,0 +1,104 @@
+#include <stdint.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/memory.h"
+#include "number_theory/modular.h"
+#include "number_theory/modular_vector.h"
+
+namespace tql::number_theory {
+
+// Checks the kernels of ModularVector<mod> against Modular.
+template <auto mod>
+void test_modular_vector() {
+  using Mod = Modular<mod>;
+  using T = typename Mod::type;
+  std::mt19937_64 generator(static_cast<uint64_t>(Mod::modulus));
+  size_t size = 1000;
+  std::vector<Mod> x(size), y(size);
+  for (size_t i = 0; i < size; ++i) {
+    x[i] = static_cast<T>(generator() % static_cast<uint64_t>(Mod::modulus));
+    y[i] = static_cast<T>(generator() % static_cast<uint64_t>(Mod::modulus));
+  }
+  // The extreme values.
+  x[0] = Mod::modulus - 1;
+  y[0] = Mod::modulus - 1;
+  x[1] = 0;
+  y[1] = Mod::modulus - 1;
+  Mod a = x[2] + y[3];
+
+  ModularVector<mod> u(x), v(y);
+  EXPECT_EQ(u.size(), size);
+  EXPECT_EQ(u.to_vector(), x);
+  std::vector<Mod> sum(size), difference(size), product(size), scaled(size),
+      axpy(size);
+  Mod total = 0, inner = 0;
+  for (size_t i = 0; i < size; ++i) {
+    sum[i] = x[i] + y[i];
+    difference[i] = x[i] - y[i];
+    product[i] = x[i] * y[i];
+    scaled[i] = x[i] * a;
+    axpy[i] = y[i] + a * x[i];
+    total += x[i];
+    inner += x[i] * y[i];
+  }
+  EXPECT_EQ((u + v).to_vector(), sum);
+  EXPECT_EQ((u - v).to_vector(), difference);
+  EXPECT_EQ((u * v).to_vector(), product);
+  EXPECT_EQ((u * a).to_vector(), scaled);
+  EXPECT_EQ((a * u).to_vector(), scaled);
+  EXPECT_EQ(ModularVector<mod>(v).axpy(a, u).to_vector(), axpy);
+  EXPECT_EQ(u.sum(), total);
+  EXPECT_EQ(dot(u, v), inner);
+  EXPECT_EQ(dot(u, v), dot(v, u));
+
+  // In place, and aliased.
+  ModularVector<mod> w = u;
+  w -= u;
+  EXPECT_EQ(w, ModularVector<mod>(size));
+  w = u;
+  w *= w;
+  EXPECT_EQ(w, u * u);
+}
+
+TEST(ModularVectorTest, Kernels) {
+  test_modular_vector<int32_t(10007)>();
+  test_modular_vector<uint32_t(65535)>();
+  test_modular_vector<int64_t(998244353)>();
+  test_modular_vector<int64_t(2147483647)>();
+  test_modular_vector<uint64_t(1000000000)>();
+  test_modular_vector<uint64_t(4294967291)>();
+  test_modular_vector<int64_t(1)>();
+}
+
+TEST(ModularVectorTest, Elements) {
+  using Mod = Modular<int64_t(998244353)>;
+  ModularVector<998244353> u{1, -1, 998244354};
+  EXPECT_EQ(u.size(), 3u);
+  EXPECT_EQ(u[1], Mod(-1));
+  EXPECT_EQ(u[2], Mod(1));
+  u.set(0, 5);
+  EXPECT_EQ(u[0], Mod(5));
+  u.resize(5);
+  EXPECT_EQ(u[4], Mod(0));
+  EXPECT_FALSE(u.empty());
+  EXPECT_TRUE(ModularVector<998244353>().empty());
+
+  ModularVector<998244353> v(4);
+  EXPECT_THROW(u += v, std::invalid_argument);
+  EXPECT_THROW(u -= v, std::invalid_argument);
+  EXPECT_THROW(u *= v, std::invalid_argument);
+  EXPECT_THROW(u.axpy(2, v), std::invalid_argument);
+  EXPECT_THROW(dot(u, v), std::invalid_argument);
+
+  ModularVector<998244353, PageAllocator<Mod>> w(
+      std::size_t(1) << 20, PageAllocator<Mod>(AllocationPolicy()));
+  w.set(12345, 3);
+  EXPECT_EQ(w.sum(), Mod(3));
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,208 @@
+#ifndef NUMBER_THEORY_MONTGOMERY_H_
+#define NUMBER_THEORY_MONTGOMERY_H_
+
+#include <stdint.h>
+
+#include <stdexcept>
+#include <type_traits>
+
+// Montgomery modular multiplication.
+
+namespace tql {
+namespace number_theory {
+
+// Modular arithmetic in the Montgomery form for an odd modulus of type U.
+//
+// A residue x is represented by x*R mod n, where R = 2^(bits of U), so that a
+// modular multiplication only needs multiplications and no divisions. Values
+// in the Montgomery form are always in the range [0, modulus).
+template <typename U>
+class Montgomery;
+
+template <>
+class Montgomery<uint64_t> {
+ public:
+  using type = uint64_t;
+
+  // Throws invalid_argument exception if |modulus| is even or one.
+  constexpr explicit Montgomery(uint64_t modulus) : modulus_(modulus) {
+    if (modulus % 2 == 0 || modulus == 1)
+      throw std::invalid_argument("Montgomery modulus must be odd and > 1.");
+    // Newton's iteration doubles the correct low bits of the inverse each step.
+    inverse_ = modulus;
+    for (int i = 0; i < 5; ++i)
+      inverse_ *= 2 - modulus * inverse_;
+    unsigned __int128 r = (static_cast<unsigned __int128>(1) << 64) % modulus;
+    r2_ = static_cast<uint64_t>(r * r % modulus);
+  }
+
+  // Returns the modulus.
+  constexpr uint64_t modulus() const { return modulus_; }
+
+  // Converts |x| to the Montgomery form.
+  constexpr uint64_t to(uint64_t x) const {
+    return multiply(x % modulus_, r2_);
+  }
+
+  // Converts |x| from the Montgomery form.
+  constexpr uint64_t from(uint64_t x) const { return reduce(x); }
+
+  // Returns the Montgomery form of 1.
+  constexpr uint64_t one() const { return to(1); }
+
+  // The corrections below select between two computed values, so that they
+  // compile to conditional moves instead of branches, which would be
+  // mispredicted half of the time.
+  constexpr uint64_t add(uint64_t a, uint64_t b) const {
+    uint64_t c = a + b;
+    uint64_t d = c - modulus_;
+    return (c < a) | (c >= modulus_) ? d : c;
+  }
+
+  constexpr uint64_t subtract(uint64_t a, uint64_t b) const {
+    uint64_t c = a - b;
+    uint64_t d = c + modulus_;
+    return a < b ? d : c;
+  }
+
+  constexpr uint64_t multiply(uint64_t a, uint64_t b) const {
+    return reduce(static_cast<unsigned __int128>(a) * b);
+  }
+
+  // Computes |base|^|exponent| in the Montgomery form.
+  constexpr uint64_t pow(uint64_t base, uint64_t exponent) const {
+    uint64_t result = one();
+    while (exponent != 0) {
+      if (exponent % 2 != 0)
+        result = multiply(result, base);
+      base = multiply(base, base);
+      exponent /= 2;
+    }
+    return result;
+  }
+
+ private:
+  uint64_t modulus_;
+  // modulus * inverse_ == 1 (mod 2^64).
+  uint64_t inverse_ = 0;
+  // 2^128 mod modulus.
+  uint64_t r2_ = 0;
+
+  // Returns x / 2^64 (mod modulus) for x < modulus * 2^64.
+  constexpr uint64_t reduce(unsigned __int128 x) const {
+    uint64_t m = static_cast<uint64_t>(x) * inverse_;
+    uint64_t high = static_cast<uint64_t>(x >> 64);
+    uint64_t mn = static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(m) * modulus_) >> 64);
+    // x - m * modulus is divisible by 2^64, and its low half is zero.
+    uint64_t c = high - mn;
+    uint64_t d = c + modulus_;
+    return high < mn ? d : c;
+  }
+};
+
+namespace montgomery_internal {
+
+// Returns the 256-bit product of |a| and |b| in |high| and |low|.
+constexpr void multiply_wide(unsigned __int128 a,
+                             unsigned __int128 b,
+                             unsigned __int128 &high,
+                             unsigned __int128 &low) {
+  using u128 = unsigned __int128;
+  u128 a0 = static_cast<uint64_t>(a), a1 = a >> 64;
+  u128 b0 = static_cast<uint64_t>(b), b1 = b >> 64;
+  u128 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+  // The sum of three 64-bit numbers does not overflow.
+  u128 middle = (p00 >> 64) + static_cast<uint64_t>(p01) +
+                static_cast<uint64_t>(p10);
+  low = middle << 64 | static_cast<uint64_t>(p00);
+  high = p11 + (p01 >> 64) + (p10 >> 64) + (middle >> 64);
+}
+
+}  // namespace montgomery_internal
+
+// The 128-bit version, where a multiplication takes four 64-bit
+// multiplications and the reduction takes four more.
+template <>
+class Montgomery<unsigned __int128> {
+ public:
+  using type = unsigned __int128;
+
+  // Throws invalid_argument exception if |modulus| is even or one.
+  constexpr explicit Montgomery(type modulus) : modulus_(modulus) {
+    if (modulus % 2 == 0 || modulus == 1)
+      throw std::invalid_argument("Montgomery modulus must be odd and > 1.");
+    inverse_ = modulus;
+    for (int i = 0; i < 6; ++i)
+      inverse_ *= 2 - modulus * inverse_;
+    // 2^128 mod modulus, doubled 128 times.
+    r2_ = (0 - modulus) % modulus;
+    for (int i = 0; i < 128; ++i)
+      r2_ = add(r2_, r2_);
+  }
+
+  // Returns the modulus.
+  constexpr type modulus() const { return modulus_; }
+
+  // Converts |x| to the Montgomery form.
+  constexpr type to(type x) const { return multiply(x % modulus_, r2_); }
+
+  // Converts |x| from the Montgomery form.
+  constexpr type from(type x) const { return reduce(0, x); }
+
+  // Returns the Montgomery form of 1.
+  constexpr type one() const { return to(1); }
+
+  constexpr type add(type a, type b) const {
+    type c = a + b;
+    return c - (modulus_ & mask((c < a) | (c >= modulus_)));
+  }
+
+  constexpr type subtract(type a, type b) const {
+    return a - b + (modulus_ & mask(a < b));
+  }
+
+  constexpr type multiply(type a, type b) const {
+    type high = 0, low = 0;
+    montgomery_internal::multiply_wide(a, b, high, low);
+    return reduce(high, low);
+  }
+
+  // Computes |base|^|exponent| in the Montgomery form.
+  constexpr type pow(type base, type exponent) const {
+    type result = one();
+    while (exponent != 0) {
+      if (exponent % 2 != 0)
+        result = multiply(result, base);
+      base = multiply(base, base);
+      exponent /= 2;
+    }
+    return result;
+  }
+
+ private:
+  type modulus_;
+  // modulus * inverse_ == 1 (mod 2^128).
+  type inverse_ = 0;
+  // 2^256 mod modulus.
+  type r2_ = 0;
+
+  // Returns (|high| * 2^128 + |low|) / 2^128 (mod modulus) for the dividend
+  // below modulus * 2^128.
+  constexpr type reduce(type high, type low) const {
+    type m = low * inverse_;
+    type mn_high = 0, mn_low = 0;
+    montgomery_internal::multiply_wide(m, modulus_, mn_high, mn_low);
+    return high - mn_high + (modulus_ & mask(high < mn_high));
+  }
+
+  // Returns all ones if |condition| holds, and zero otherwise.
+  static constexpr type mask(bool condition) {
+    return 0 - static_cast<type>(condition);
+  }
+};
+
+}  // namespace number_theory
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_MONTGOMERY_H_
@@ -0,0 +1,96 @@
+#include <stdint.h>
+
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/montgomery.h"
+
+namespace tql::number_theory {
+
+void test_montgomery_u64(uint64_t modulus, std::default_random_engine &engine) {
+  using u128 = unsigned __int128;
+  Montgomery<uint64_t> montgomery(modulus);
+  EXPECT_EQ(montgomery.modulus(), modulus);
+  EXPECT_EQ(montgomery.from(montgomery.one()), 1u);
+  std::uniform_int_distribution<uint64_t> distribution(0, modulus - 1);
+  for (int i = 0; i < 100; ++i) {
+    uint64_t a = distribution(engine), b = distribution(engine);
+    uint64_t ma = montgomery.to(a), mb = montgomery.to(b);
+    EXPECT_EQ(montgomery.from(ma), a);
+    EXPECT_EQ(montgomery.from(montgomery.add(ma, mb)),
+              static_cast<uint64_t>((u128(a) + b) % modulus));
+    EXPECT_EQ(montgomery.from(montgomery.subtract(ma, mb)),
+              static_cast<uint64_t>((u128(a) + modulus - b) % modulus));
+    EXPECT_EQ(montgomery.from(montgomery.multiply(ma, mb)),
+              static_cast<uint64_t>(u128(a) * b % modulus));
+  }
+  // Fermat's little theorem for primes.
+  if (modulus == 998244353 || modulus == 18446744073709551557u)
+    EXPECT_EQ(montgomery.pow(montgomery.to(3), modulus - 1), montgomery.one());
+}
+
+TEST(MontgomeryTest, U64) {
+  std::default_random_engine engine(
+      testing::UnitTest::GetInstance()->random_seed());
+  for (uint64_t modulus :
+       {uint64_t(3), uint64_t(998244353), uint64_t(1) << 63 | 1,
+        uint64_t(18446744073709551557u), std::numeric_limits<uint64_t>::max()})
+    test_montgomery_u64(modulus, engine);
+
+  EXPECT_THROW(Montgomery<uint64_t>(10), std::invalid_argument);
+  EXPECT_THROW(Montgomery<uint64_t>(1), std::invalid_argument);
+  static_assert(Montgomery<uint64_t>(7).from(Montgomery<uint64_t>(7).to(9)) ==
+                2);
+}
+
+TEST(MontgomeryTest, U128) {
+  using u128 = unsigned __int128;
+  std::default_random_engine engine(
+      testing::UnitTest::GetInstance()->random_seed());
+  std::uniform_int_distribution<uint64_t> distribution;
+  // Checks the results against 64-bit moduli, where the products fit in 128
+  // bits.
+  for (uint64_t modulus : {uint64_t(3), uint64_t(998244353),
+                           uint64_t(18446744073709551557u)}) {
+    Montgomery<u128> montgomery(modulus);
+    EXPECT_EQ(montgomery.from(montgomery.one()), 1u);
+    for (int i = 0; i < 100; ++i) {
+      u128 a = distribution(engine) % modulus, b = distribution(engine) % modulus;
+      u128 ma = montgomery.to(a), mb = montgomery.to(b);
+      EXPECT_TRUE(montgomery.from(ma) == a);
+      EXPECT_TRUE(montgomery.from(montgomery.add(ma, mb)) == (a + b) % modulus);
+      EXPECT_TRUE(montgomery.from(montgomery.subtract(ma, mb)) ==
+                  (a + modulus - b) % modulus);
+      EXPECT_TRUE(montgomery.from(montgomery.multiply(ma, mb)) ==
+                  a * b % modulus);
+    }
+  }
+
+  // Large moduli: (2^127 - 1) is prime, and -1 squared is 1.
+  for (u128 modulus : {(u128(1) << 127) - 1, ~u128(0), (u128(1) << 127) | 1}) {
+    Montgomery<u128> montgomery(modulus);
+    u128 minus_one = montgomery.to(modulus - 1);
+    EXPECT_TRUE(montgomery.from(montgomery.multiply(minus_one, minus_one)) ==
+                1);
+    u128 a = (u128(distribution(engine)) << 64 | distribution(engine)) % modulus;
+    u128 ma = montgomery.to(a);
+    EXPECT_TRUE(montgomery.from(ma) == a);
+    EXPECT_TRUE(montgomery.from(montgomery.multiply(ma, montgomery.to(2))) ==
+                montgomery.from(montgomery.add(ma, ma)));
+    // a^2 * a^3 == a^5.
+    EXPECT_TRUE(montgomery.multiply(montgomery.pow(ma, 2),
+                                    montgomery.pow(ma, 3)) ==
+                montgomery.pow(ma, 5));
+  }
+  Montgomery<u128> mersenne((u128(1) << 127) - 1);
+  EXPECT_TRUE(mersenne.pow(mersenne.to(3), (u128(1) << 127) - 2) ==
+              mersenne.one());
+
+  EXPECT_THROW(Montgomery<u128>(u128(1) << 100), std::invalid_argument);
+  static_assert(Montgomery<u128>(7).from(Montgomery<u128>(7).to(9)) == 2);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,166 @@
+#ifndef NUMBER_THEORY_ONLINE_CONVOLUTION_H_
+#define NUMBER_THEORY_ONLINE_CONVOLUTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <vector>
+
+#include "number_theory/convolution.h"
+#include "number_theory/modular.h"
+
+// Convolution of sequences of Modular values which are known one at a time.
+
+namespace tql {
+namespace number_theory {
+
+namespace online_convolution_internal {
+
+// From this size, the blocks are multiplied with transforms instead of the
+// schoolbook.
+inline constexpr size_t kTransformBlockSize = 16;
+
+}  // namespace online_convolution_internal
+
+// Online convolution, also known as relaxed multiplication: the values of two
+// sequences a and b are pushed one at a time, and each push returns the next
+// value of their convolution c_n = a_0 b_n + a_1 b_(n-1) + ... + a_n b_0. This
+// computes c from recurrences where a_n or b_n depends on c_(n-1), which a
+// single convolution cannot do.
+//
+// For example, f_n = f_0 g_n + ... + f_(n-1) g_1 is computed by
+// f_n = push(f_(n-1), g_n).
+//
+// The pairs (i, j) with i, j >= 1 are tiled by squares, which are multiplied
+// as soon as their values are known and added to the values of c ahead:
+// [p, 2p) x [p, 2p), and [kp, (k+1)p) x [p, 2p) and its mirror for k >= 2,
+// for each power of two p. The n-th push multiplies the squares of the sizes
+// p dividing n + 1, which takes O(log(n)^2) amortized time with the transforms.
+// If the modulus has roots of unity, the transforms of the blocks
+// [p, 2p) are kept, so that each square takes 2 forward transforms and an
+// inverse one.
+template <ModularType M>
+class OnlineConvolution {
+ public:
+  OnlineConvolution() = default;
+
+  OnlineConvolution(const OnlineConvolution &) = default;
+  OnlineConvolution(OnlineConvolution &&) = default;
+  OnlineConvolution &operator=(const OnlineConvolution &) = default;
+  OnlineConvolution &operator=(OnlineConvolution &&) = default;
+
+  // Returns the number of pushed values.
+  size_t size() const { return a_.size(); }
+
+  // Returns the pushed values of a and b.
+  std::span<const M> a() const { return a_; }
+  std::span<const M> b() const { return b_; }
+
+  // Appends |a_n| to a and |b_n| to b, and returns c_n, where n is size()
+  // before the push.
+  M push(const M &a_n, const M &b_n) {
+    size_t n = a_.size();
+    a_.push_back(a_n);
+    b_.push_back(b_n);
+    c_.resize(std::max(c_.size(), 2 * n + 1));
+    c_[n] += n == 0 ? a_n * b_n : a_n * b_[0] + a_[0] * b_n;
+    for (size_t p = 1; (n + 1) % p == 0 && (n + 1) / p >= 2; p *= 2)
+      add_square(n + 1 - p, p, p);
+    return c_[n];
+  }
+
+ private:
+  // Adds the products of a[|i|, |i| + |p|) and b[|j|, |j| + |p|), and if
+  // |i| != |j| the mirrored one, to c[|i| + |j|, ...).
+  void add_square(size_t i, size_t j, size_t p) {
+    using online_convolution_internal::kTransformBlockSize;
+    M *c = c_.data() + i + j;
+    if (p < kTransformBlockSize) {
+      for (size_t x = 0; x < p; ++x) {
+        for (size_t y = 0; y < p; ++y) {
+          c[x + y] += a_[i + x] * b_[j + y];
+          if (i != j)
+            c[x + y] += b_[i + x] * a_[j + y];
+        }
+      }
+      return;
+    }
+    if constexpr (convolution_internal::fits_lanes<M>()) {
+      constexpr auto kModulus = static_cast<uint32_t>(M::modulus);
+      if constexpr (convolution_internal::has_ntt(kModulus, 2)) {
+        if (2 * p <= convolution_internal::Ntt<kModulus>::kMaxSize) {
+          add_square_ntt<kModulus>(i, j, p, c);
+          return;
+        }
+      }
+    }
+    std::span<const M> a(a_), b(b_);
+    std::vector<M> product = convolve(a.subspan(i, p), b.subspan(j, p));
+    if (i != j) {
+      std::vector<M> mirror = convolve(b.subspan(i, p), a.subspan(j, p));
+      for (size_t k = 0; k < product.size(); ++k)
+        product[k] += mirror[k];
+    }
+    for (size_t k = 0; k < product.size(); ++k)
+      c[k] += product[k];
+  }
+
+  // Does add_square with the number-theoretic transform modulo |prime| and
+  // the kept transforms of the blocks [|p|, 2 |p|).
+  template <uint32_t prime>
+  void add_square_ntt(size_t i, size_t j, size_t p, M *c) {
+    using Ntt = convolution_internal::Ntt<prime>;
+    constexpr auto kMontgomery = Ntt::kMontgomery;
+    // Transforms values[begin, begin + p) padded to 2p into |x|.
+    auto transform = [&](const std::vector<M> &values, size_t begin,
+                         std::vector<uint32_t> &x) {
+      x.assign(2 * p, 0);
+      for (size_t k = 0; k < p; ++k)
+        x[k] = static_cast<uint32_t>(values[begin + k].get());
+      Ntt::transform(x.data(), 2 * p);
+    };
+    // The square [p, 2p) x [p, 2p) comes first for each p.
+    size_t level = std::countr_zero(p);
+    if (i == j) {
+      a_transforms_.resize(level + 1);
+      b_transforms_.resize(level + 1);
+      transform(a_, p, a_transforms_[level]);
+      transform(b_, p, b_transforms_[level]);
+    }
+    const std::vector<uint32_t> &a_block = a_transforms_[level];
+    const std::vector<uint32_t> &b_block = b_transforms_[level];
+    std::vector<uint32_t> &x = scratch_[0], &y = scratch_[1];
+    if (i == j) {
+      x.resize(2 * p);
+      for (size_t k = 0; k < 2 * p; ++k)
+        x[k] = kMontgomery.multiply(a_block[k], b_block[k]);
+    } else {
+      transform(a_, i, x);
+      transform(b_, i, y);
+      for (size_t k = 0; k < 2 * p; ++k) {
+        x[k] = kMontgomery.add(kMontgomery.multiply(x[k], b_block[k]),
+                               kMontgomery.multiply(y[k], a_block[k]));
+      }
+    }
+    Ntt::inverse_transform(x.data(), 2 * p);
+    for (size_t k = 0; k + 1 < 2 * p; ++k)
+      c[k] += static_cast<typename M::type>(x[k]);
+  }
+
+  std::vector<M> a_, b_, c_;
+  // The transforms of a[p, 2p) and b[p, 2p) of the size 2p, by log2(p).
+  std::vector<std::vector<uint32_t>> a_transforms_, b_transforms_;
+  // The buffers of the transforms of the other blocks.
+  std::vector<uint32_t> scratch_[2];
+};
+
+}  // namespace number_theory
+
+using number_theory::OnlineConvolution;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_ONLINE_CONVOLUTION_H_
@@ -0,0 +1,69 @@
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/modular.h"
+#include "number_theory/numeric.h"
+#include "number_theory/online_convolution.h"
+
+namespace tql::number_theory {
+
+// Checks OnlineConvolution modulo |mod| against the definition for |size|
+// random values.
+template <auto mod>
+void test_online_convolution(size_t size) {
+  using Mod = Modular<mod>;
+  using T = typename Mod::type;
+  std::mt19937_64 generator(size);
+  std::vector<Mod> a(size), b(size);
+  for (size_t i = 0; i < size; ++i) {
+    a[i] = static_cast<T>(generator() % static_cast<uint64_t>(Mod::modulus));
+    b[i] = static_cast<T>(generator() % static_cast<uint64_t>(Mod::modulus));
+  }
+  OnlineConvolution<Mod> convolution;
+  for (size_t n = 0; n < size; ++n) {
+    Mod expected = 0;
+    for (size_t i = 0; i <= n; ++i)
+      expected += a[i] * b[n - i];
+    EXPECT_EQ(convolution.push(a[n], b[n]), expected) << n;
+    EXPECT_EQ(convolution.size(), n + 1);
+  }
+  EXPECT_EQ(convolution.a().back(), a.back());
+  EXPECT_EQ(convolution.b().back(), b.back());
+}
+
+TEST(OnlineConvolutionTest, Push) {
+  // With the number-theoretic transform.
+  test_online_convolution<998244353>(1500);
+  // With convolve.
+  test_online_convolution<1000000007>(1500);
+  test_online_convolution<(uint64_t(1) << 61) - 1>(300);
+  test_online_convolution<6>(100);
+}
+
+TEST(OnlineConvolutionTest, Recurrence) {
+  // f_n = f_0 g_n + ... + f_(n-1) g_1 with g = 1 gives f_n = 2^(n-1).
+  using Mod = Modular<998244353>;
+  OnlineConvolution<Mod> convolution;
+  std::vector<Mod> f = {1};
+  for (size_t n = 1; n < 5000; ++n)
+    f.push_back(convolution.push(f[n - 1], 1));
+  for (size_t n = 1; n < f.size(); ++n)
+    EXPECT_EQ(f[n], pow(Mod(2), n - 1));
+
+  // The Catalan numbers: C_(n+1) = C_0 C_n + ... + C_n C_0.
+  OnlineConvolution<Modular<1000000007>> catalan;
+  std::vector<Modular<1000000007>> c = {1};
+  for (size_t n = 0; n < 300; ++n)
+    c.push_back(catalan.push(c[n], c[n]));
+  EXPECT_EQ(c[10], 16796);
+  Modular<1000000007> expected = 1;
+  for (size_t n = 1; n <= 299; ++n)
+    expected = expected * (4 * n - 2) / (n + 1);
+  EXPECT_EQ(c[299], expected);
+}
+
+}  // namespace tql::number_theory
@@ -4,10 +4,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <bit>
 #include <limits>
+#include <memory>
+#include <memory_resource>
 #include <utility>
 #include <vector>
 
+#include "number_theory/montgomery.h"
 #include "number_theory/utility.h"
 
 // This file contains functions related to prime numbers.
@@ -17,14 +21,17 @@ namespace number_theory {
 
 // Generates all coprime pairs of integers under |num_limit| (inclusive).
 // Each pair (x, y) in the results should satisfy num_limit >= x >= y >= 0.
-template <typename T>
-std::vector<std::pair<T, T>> coprime_pairs(const T &num_limit) {
+// The result is allocated with |allocator|.
+template <typename T, typename Allocator = std::allocator<std::pair<T, T>>>
+std::vector<std::pair<T, T>, Allocator> coprime_pairs(
+    const T &num_limit,
+    const Allocator &allocator = Allocator()) {
   static_assert(std::numeric_limits<T>::is_integer,
                 "coprime_pairs argument |num_limit| must be an integer.");
+  std::vector<std::pair<T, T>, Allocator> pairs(allocator);
   if (num_limit <= 0)
-    return {};
+    return pairs;
   uint64_t num_limit_u64 = numeric_cast<uint64_t>(num_limit);
-  std::vector<std::pair<T, T>> pairs;
 
   // Append pair (x, y) to |pairs| if it is under the limit.
   // The caller should make sure x >= y.
@@ -71,8 +78,238 @@ constexpr bool is_prime(const T &number) {
   return true;
 }
 
+namespace pmr {
+
+// Generates coprime pairs in the memory of |resource|.
+template <typename T>
+std::pmr::vector<std::pair<T, T>> coprime_pairs(
+    const T &num_limit,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+  return number_theory::coprime_pairs(
+      num_limit, std::pmr::polymorphic_allocator<std::pair<T, T>>(resource));
+}
+
+}  // namespace pmr
+
+namespace prime_internal {
+
+// Strong probable-prime test of the odd number n > 2 to |base|, where
+// n - 1 == d * 2^s and d is odd.
+template <typename U>
+constexpr bool miller_rabin_test(const Montgomery<U> &montgomery,
+                                 U d,
+                                 int s,
+                                 U base) {
+  U n = montgomery.modulus();
+  base %= n;
+  if (base == 0)
+    return true;
+  U one = montgomery.one();
+  U minus_one = montgomery.subtract(0, one);
+  U x = montgomery.pow(montgomery.to(base), d);
+  if (x == one || x == minus_one)
+    return true;
+  for (int i = 1; i < s; ++i) {
+    x = montgomery.multiply(x, x);
+    if (x == minus_one)
+      return true;
+  }
+  return false;
+}
+
+// Deterministic Miller-Rabin test for 64-bit numbers.
+constexpr bool is_prime_u64(uint64_t n) {
+  if (n < 64)
+    return (0x28208a20a08a28ac >> n) & 1;
+  for (uint64_t p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+    if (n % p == 0)
+      return false;
+  }
+  if (n < 41 * 41)
+    return true;
+
+  uint64_t d = n - 1;
+  int s = 0;
+  while (d % 2 == 0) {
+    d /= 2;
+    ++s;
+  }
+  Montgomery<uint64_t> montgomery(n);
+  // These bases are sufficient for all numbers below 2^64.
+  // https://miller-rabin.appspot.com/
+  for (uint64_t base : {2, 325, 9375, 28178, 450775, 9780504, 1795265022}) {
+    if (!miller_rabin_test(montgomery, d, s, base))
+      return false;
+  }
+  return true;
+}
+
+// Returns whether |n| is a perfect square, by Newton's iteration.
+constexpr bool is_square_u128(unsigned __int128 n) {
+  using u128 = unsigned __int128;
+  if (n < 2)
+    return true;
+  // x starts above the square root and decreases to its floor.
+  int bits = 128 - std::countl_zero(n);
+  u128 x = u128(1) << ((bits + 1) / 2);
+  for (u128 y = (x + n / x) / 2; y < x; y = (x + n / x) / 2)
+    x = y;
+  return x * x == n;
+}
+
+// Returns the Jacobi symbol (|a| / |n|) for the odd |n|.
+constexpr int jacobi_u128(unsigned __int128 a, unsigned __int128 n) {
+  int result = 1;
+  a %= n;
+  while (a != 0) {
+    while (a % 2 == 0) {
+      a /= 2;
+      if (n % 8 == 3 || n % 8 == 5)
+        result = -result;
+    }
+    std::swap(a, n);
+    if (a % 4 == 3 && n % 4 == 3)
+      result = -result;
+    a %= n;
+  }
+  return n == 1 ? result : 0;
+}
+
+// Strong Lucas probable-prime test of the odd number n > 41, which is not a
+// square and below 2^128 - 1, with the parameters of Selfridge's method A:
+// P = 1 and Q = (1 - D) / 4 for the first D in 5, -7, 9, -11, ... with
+// (D / n) = -1. Where n + 1 == d * 2^s and d is odd, n passes if U_d = 0, or
+// V_(d 2^r) = 0 for some r < s.
+constexpr bool strong_lucas_test(
+    const Montgomery<unsigned __int128> &montgomery) {
+  using u128 = unsigned __int128;
+  u128 n = montgomery.modulus();
+  // Returns |x| modulo n.
+  auto normalize = [n](int64_t x) {
+    u128 r = static_cast<u128>(x < 0 ? -x : x) % n;
+    return x < 0 && r != 0 ? n - r : r;
+  };
+  int64_t d_parameter = 5;
+  while (true) {
+    int symbol = jacobi_u128(normalize(d_parameter), n);
+    if (symbol == -1)
+      break;
+    // n shares a factor with D.
+    if (symbol == 0)
+      return false;
+    d_parameter = d_parameter > 0 ? -d_parameter - 2 : -d_parameter + 2;
+  }
+  u128 d_value = montgomery.to(normalize(d_parameter));
+  u128 q = montgomery.to(normalize((1 - d_parameter) / 4));
+  // Returns |x| / 2 modulo the odd n, which also holds in the Montgomery form.
+  auto halve = [n](u128 x) { return (x >> 1) + ((n >> 1) + 1) * (x & 1); };
+
+  u128 d = n + 1;
+  int s = 0;
+  while (d % 2 == 0) {
+    d /= 2;
+    ++s;
+  }
+  // U_k, V_k and Q^k from k = 1, doubling k and adding the bits of d.
+  u128 u = montgomery.one(), v = u, q_power = q;
+  for (int bit = 126 - std::countl_zero(d); bit >= 0; --bit) {
+    u = montgomery.multiply(u, v);
+    v = montgomery.subtract(montgomery.multiply(v, v),
+                            montgomery.add(q_power, q_power));
+    q_power = montgomery.multiply(q_power, q_power);
+    if ((d >> bit) & 1) {
+      u128 next_u = halve(montgomery.add(u, v));
+      v = halve(montgomery.add(montgomery.multiply(d_value, u), v));
+      u = next_u;
+      q_power = montgomery.multiply(q_power, q);
+    }
+  }
+  if (u == 0 || v == 0)
+    return true;
+  for (int r = 1; r < s; ++r) {
+    v = montgomery.subtract(montgomery.multiply(v, v),
+                            montgomery.add(q_power, q_power));
+    if (v == 0)
+      return true;
+    q_power = montgomery.multiply(q_power, q_power);
+  }
+  return false;
+}
+
+// The Miller-Rabin test to the first 13 prime bases is deterministic below
+// this bound.
+inline constexpr unsigned __int128 kMillerRabinBound =
+    static_cast<unsigned __int128>(3317044064679ULL) * 1000000000000ULL +
+    887385961981ULL;
+
+// Primality test for 128-bit numbers. It is the Miller-Rabin test to the first
+// 13 prime bases, which is deterministic below 3.3 * 10^24. Above that, it
+// adds the strong Lucas test, which makes it the Baillie-PSW test: no
+// composite passing it is known, but it is not proven.
+constexpr bool is_prime_u128(unsigned __int128 n) {
+  using u128 = unsigned __int128;
+  if (n >> 64 == 0)
+    return is_prime_u64(static_cast<uint64_t>(n));
+  constexpr uint64_t kBases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41};
+  for (uint64_t p : kBases) {
+    if (n % p == 0)
+      return false;
+  }
+
+  u128 d = n - 1;
+  int s = 0;
+  while (d % 2 == 0) {
+    d /= 2;
+    ++s;
+  }
+  Montgomery<u128> montgomery(n);
+  for (uint64_t base : kBases) {
+    if (!miller_rabin_test<u128>(montgomery, d, s, base))
+      return false;
+  }
+  if (n < kMillerRabinBound)
+    return true;
+  return !is_square_u128(n) && strong_lucas_test(montgomery);
+}
+
+}  // namespace prime_internal
+
+// Tests whether |number| is prime or not.
+//
+// This overload is available for numbers from 2^16 to 2^64. It uses the
+// deterministic Miller-Rabin test in O(log |number|) multiplications.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::is_integer &&
+                               (std::numeric_limits<T>::digits > 16) &&
+                               std::numeric_limits<T>::digits <= 64,
+                           bool> = true>
+constexpr bool is_prime(const T &number) {
+  if (number < 2)
+    return false;
+  return prime_internal::is_prime_u64(static_cast<uint64_t>(number));
+}
+
+// Tests whether |number| is prime or not.
+//
+// This overload is available for numbers from 2^64 to 2^128. It is
+// deterministic below 3.3 * 10^24, and the Baillie-PSW test above. See
+// prime_internal::is_prime_u128.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::is_integer &&
+                               (std::numeric_limits<T>::digits > 64) &&
+                               std::numeric_limits<T>::digits <= 128,
+                           bool> = true>
+constexpr bool is_prime(const T &number) {
+  if (number < 2)
+    return false;
+  return prime_internal::is_prime_u128(
+      static_cast<unsigned __int128>(number));
+}
+
 }  // namespace number_theory
 
+namespace pmr = number_theory::pmr;
+
 using number_theory::coprime_pairs;
 using number_theory::is_prime;
 
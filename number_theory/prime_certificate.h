@@ -0,0 +1,278 @@
+#ifndef NUMBER_THEORY_PRIME_CERTIFICATE_H_
+#define NUMBER_THEORY_PRIME_CERTIFICATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "number_theory/factorization.h"
+#include "number_theory/montgomery.h"
+#include "number_theory/prime.h"
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+
+// Primality certificates, which prove that a number is prime.
+
+namespace tql {
+namespace number_theory {
+
+namespace prime_certificate_internal {
+
+using u128 = unsigned __int128;
+
+// Primes below this are proven by trial division, and need no step.
+inline constexpr u128 kTrialDivisionLimit = 1 << 16;
+
+// Returns whether |n| < kTrialDivisionLimit is prime, by trial division.
+constexpr bool is_small_prime(u128 n) {
+  if (n < 2)
+    return false;
+  for (uint32_t d = 2; d * d <= n; ++d) {
+    if (n % d == 0)
+      return false;
+  }
+  return true;
+}
+
+// Appends |x| to |bytes| in LEB128, 7 bits per byte from the lowest.
+inline void write_varint(u128 x, std::vector<uint8_t> &bytes) {
+  while (x >= 0x80) {
+    bytes.push_back(static_cast<uint8_t>(x | 0x80));
+    x >>= 7;
+  }
+  bytes.push_back(static_cast<uint8_t>(x));
+}
+
+// Reads a LEB128 number from the front of |bytes| and advances it. Returns
+// nullopt if |bytes| ends early or the number exceeds 128 bits.
+inline std::optional<u128> read_varint(std::span<const uint8_t> &bytes) {
+  u128 x = 0;
+  for (int shift = 0; shift < 128; shift += 7) {
+    if (bytes.empty())
+      return std::nullopt;
+    uint8_t byte = bytes.front();
+    bytes = bytes.subspan(1);
+    if (shift == 126 && byte > 3)
+      return std::nullopt;
+    x |= static_cast<u128>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return x;
+  }
+  return std::nullopt;
+}
+
+// Returns whether |witness| proves the odd |prime| with the distinct prime
+// factors |factors| of |prime| - 1, which is Lucas's theorem: the order of
+// |witness| is |prime| - 1 if |witness|^(|prime| - 1) = 1 and
+// |witness|^((|prime| - 1) / q) != 1 for each prime factor q.
+template <typename U>
+bool check_witness(U prime, U witness, std::span<const u128> factors) {
+  Montgomery<U> montgomery(prime);
+  U a = montgomery.to(witness);
+  U one = montgomery.one();
+  if (montgomery.pow(a, prime - 1) != one)
+    return false;
+  for (u128 q : factors) {
+    if (montgomery.pow(a, (prime - 1) / static_cast<U>(q)) == one)
+      return false;
+  }
+  return true;
+}
+
+// Returns whether |witness| proves |prime| with |factors|, in the arithmetic
+// of its width.
+inline bool check_witness(u128 prime, u128 witness,
+                          std::span<const u128> factors) {
+  if (prime <= std::numeric_limits<uint64_t>::max()) {
+    return check_witness<uint64_t>(static_cast<uint64_t>(prime),
+                                   static_cast<uint64_t>(witness), factors);
+  }
+  return check_witness<u128>(prime, witness, factors);
+}
+
+// Appends the steps proving the prime |p| >= kTrialDivisionLimit and the
+// large primes of its proof to |bytes|, unless |proven| has them already.
+inline void prove(u128 p, std::vector<u128> &proven,
+                  std::vector<uint8_t> &bytes) {
+  if (std::find(proven.begin(), proven.end(), p) != proven.end())
+    return;
+  std::vector<u128> factors;
+  for (const auto &[q, exponent] : factorize(p - 1))
+    factors.push_back(q);
+  for (u128 q : factors) {
+    if (q >= kTrialDivisionLimit)
+      prove(q, proven, bytes);
+  }
+  // A primitive root is found among the first few numbers.
+  u128 witness = 2;
+  while (!check_witness(p, witness, factors))
+    ++witness;
+  write_varint(p, bytes);
+  write_varint(witness, bytes);
+  write_varint(factors.size(), bytes);
+  for (u128 q : factors)
+    write_varint(q, bytes);
+  proven.push_back(p);
+}
+
+}  // namespace prime_certificate_internal
+
+// A Pratt certificate, which proves that a number below 2^128 is prime.
+//
+// Each step proves a prime p with a witness a of order p - 1, given the
+// distinct prime factors of p - 1. Its factors below 2^16 are checked by
+// trial division, and the larger ones are proven by earlier steps. The last
+// step proves the number itself.
+//
+// The certificate is stored in a compact binary format: the number followed
+// by the number of steps, and each step as the prime, the witness, the number
+// of factors and the factors, all in LEB128. A 64-bit prime takes about 60
+// bytes, and verifying it takes a few dozen modular exponentiations.
+class PrattCertificate {
+ public:
+  // Constructs an empty certificate, which proves nothing.
+  PrattCertificate() = default;
+
+  // Constructs a certificate from its binary format. It is not verified.
+  explicit PrattCertificate(std::vector<uint8_t> bytes)
+      : bytes_(std::move(bytes)) {}
+
+  PrattCertificate(const PrattCertificate &) = default;
+  PrattCertificate(PrattCertificate &&) = default;
+  PrattCertificate &operator=(const PrattCertificate &) = default;
+  PrattCertificate &operator=(PrattCertificate &&) = default;
+
+  // Returns the binary format.
+  std::span<const uint8_t> bytes() const { return bytes_; }
+
+  // Returns the number which the certificate claims to be prime.
+  // Throws invalid_argument exception if the certificate is malformed.
+  unsigned __int128 number() const {
+    std::span<const uint8_t> bytes = bytes_;
+    std::optional<unsigned __int128> n =
+        prime_certificate_internal::read_varint(bytes);
+    if (!n)
+      throw std::invalid_argument("The certificate is malformed.");
+    return *n;
+  }
+
+  // Returns whether the certificate proves that number() is prime. Malformed
+  // certificates are not valid.
+  bool verify() const { return verify(bytes_); }
+
+  // Returns whether |bytes| is a valid certificate in the binary format.
+  static bool verify(std::span<const uint8_t> bytes);
+
+  friend bool operator==(const PrattCertificate &,
+                         const PrattCertificate &) = default;
+
+ private:
+  std::vector<uint8_t> bytes_;
+};
+
+inline bool PrattCertificate::verify(std::span<const uint8_t> bytes) {
+  using prime_certificate_internal::is_small_prime;
+  using prime_certificate_internal::kTrialDivisionLimit;
+  using prime_certificate_internal::read_varint;
+  using prime_certificate_internal::u128;
+  std::optional<u128> n = read_varint(bytes);
+  std::optional<u128> num_steps = read_varint(bytes);
+  if (!n || !num_steps)
+    return false;
+  if (*n < kTrialDivisionLimit)
+    return *num_steps == 0 && bytes.empty() && is_small_prime(*n);
+
+  // The primes proven so far. A proof has a step per large prime, so it is
+  // short.
+  std::vector<u128> proven;
+  std::vector<u128> factors;
+  for (u128 step = 0; step < *num_steps; ++step) {
+    std::optional<u128> p = read_varint(bytes);
+    std::optional<u128> witness = read_varint(bytes);
+    std::optional<u128> num_factors = read_varint(bytes);
+    if (!p || !witness || !num_factors || *p < kTrialDivisionLimit ||
+        *p % 2 == 0 || *witness >= *p || *num_factors > 128) {
+      return false;
+    }
+    // The factors must be proven primes and make up all of p - 1.
+    factors.clear();
+    u128 rest = *p - 1;
+    for (u128 i = 0; i < *num_factors; ++i) {
+      std::optional<u128> q = read_varint(bytes);
+      if (!q || *q < 2 || rest % *q != 0)
+        return false;
+      if (*q < kTrialDivisionLimit ? !is_small_prime(*q)
+                                   : std::find(proven.begin(), proven.end(),
+                                               *q) == proven.end()) {
+        return false;
+      }
+      while (rest % *q == 0)
+        rest /= *q;
+      factors.push_back(*q);
+    }
+    if (rest != 1 ||
+        !prime_certificate_internal::check_witness(*p, *witness, factors)) {
+      return false;
+    }
+    proven.push_back(*p);
+  }
+  return bytes.empty() && !proven.empty() && proven.back() == *n;
+}
+
+// Returns a Pratt certificate proving that |number| is prime. The prime
+// factors of |number| - 1 are found with factorize, recursively.
+// Throws domain_error exception if |number| is not prime.
+//
+// This function is only available for numbers below 2^128.
+template <typename T,
+          std::enable_if_t<std::numeric_limits<T>::digits <= 128, bool> = true>
+PrattCertificate prove_prime(const T &number) {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "prove_prime argument |number| must be an integer.");
+  using prime_certificate_internal::u128;
+  if (!is_prime(number))
+    throw std::domain_error("Only primes have primality certificates.");
+  auto n = static_cast<u128>(number);
+  std::vector<uint8_t> bytes;
+  prime_certificate_internal::write_varint(n, bytes);
+  std::vector<uint8_t> steps;
+  std::vector<u128> proven;
+  if (n >= prime_certificate_internal::kTrialDivisionLimit)
+    prime_certificate_internal::prove(n, proven, steps);
+  prime_certificate_internal::write_varint(proven.size(), bytes);
+  bytes.insert(bytes.end(), steps.begin(), steps.end());
+  return PrattCertificate(std::move(bytes));
+}
+
+// Verifies a batch of |certificates| into |results| on |pool|. Each chunk of
+// certificates is verified by a single thread.
+// Throws invalid_argument exception if the sizes of the batch mismatch.
+inline void verify_many(std::span<const PrattCertificate> certificates,
+                        std::span<bool> results,
+                        ThreadPool &pool = ThreadPool::global()) {
+  sieve_internal::check_batch_size(certificates.size(), results.size());
+  size_t num_chunks = std::min(certificates.size(), pool.num_threads() * 4);
+  pool.parallel_for(0, num_chunks, [&](size_t chunk) {
+    size_t begin = certificates.size() * chunk / num_chunks;
+    size_t end = certificates.size() * (chunk + 1) / num_chunks;
+    for (size_t i = begin; i < end; ++i)
+      results[i] = certificates[i].verify();
+  });
+}
+
+}  // namespace number_theory
+
+using number_theory::PrattCertificate;
+using number_theory::prove_prime;
+using number_theory::verify_many;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_PRIME_CERTIFICATE_H_
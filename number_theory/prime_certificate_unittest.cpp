@@ -0,0 +1,111 @@
+#include <stdint.h>
+
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/prime_certificate.h"
+#include "number_theory/thread_pool.h"
+
+namespace tql::number_theory {
+
+using u128 = unsigned __int128;
+
+TEST(PrimeCertificateTest, ProvePrime) {
+  for (int n = 2; n < 1000; ++n) {
+    if (!is_prime(n)) {
+      EXPECT_THROW(prove_prime(n), std::domain_error);
+      continue;
+    }
+    PrattCertificate certificate = prove_prime(n);
+    EXPECT_EQ(certificate.number(), u128(n));
+    EXPECT_TRUE(certificate.verify());
+  }
+  std::vector<u128> primes = {
+      65537,
+      1000000007,
+      (uint64_t(1) << 61) - 1,
+      18446744073709551557u,
+      (u128(1) << 89) - 1,
+      (u128(1) << 127) - 1,
+      (u128(1) << 127) + 45,
+  };
+  for (u128 p : primes) {
+    PrattCertificate certificate = prove_prime(p);
+    EXPECT_EQ(certificate.number(), p);
+    EXPECT_TRUE(certificate.verify());
+    EXPECT_TRUE(PrattCertificate::verify(certificate.bytes()));
+  }
+  EXPECT_THROW(prove_prime(uint64_t(1) << 63), std::domain_error);
+  EXPECT_THROW(prove_prime(u128(1) << 127), std::domain_error);
+  EXPECT_THROW(prove_prime(-7), std::domain_error);
+}
+
+TEST(PrimeCertificateTest, Verify) {
+  EXPECT_FALSE(PrattCertificate().verify());
+  EXPECT_THROW(PrattCertificate().number(), std::invalid_argument);
+  // 4 = 2^2 is not prime, and 65537 needs a step.
+  EXPECT_FALSE(PrattCertificate({4, 0}).verify());
+  EXPECT_TRUE(PrattCertificate({7, 0}).verify());
+  EXPECT_FALSE(PrattCertificate({0x81, 0x80, 0x04, 0}).verify());
+  // 65537 = 2^16 + 1 with the witness 3.
+  PrattCertificate certificate({0x81, 0x80, 0x04, 1, 0x81, 0x80, 0x04, 3, 1,
+                                2});
+  EXPECT_TRUE(certificate.verify());
+  EXPECT_EQ(certificate, prove_prime(65537));
+  // 2 has order 32, and 4 is not prime.
+  EXPECT_FALSE(PrattCertificate({0x81, 0x80, 0x04, 1, 0x81, 0x80, 0x04, 2, 1,
+                                 2})
+                   .verify());
+  EXPECT_FALSE(PrattCertificate({0x81, 0x80, 0x04, 1, 0x81, 0x80, 0x04, 3, 1,
+                                 4})
+                   .verify());
+
+  // A corrupted certificate never proves a composite. It may still be valid
+  // if a witness is changed to another primitive root.
+  PrattCertificate large = prove_prime((u128(1) << 127) - 1);
+  std::vector<uint8_t> bytes(large.bytes().begin(), large.bytes().end());
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    for (uint8_t flip : {1, 0x40, 0x80}) {
+      bytes[i] ^= flip;
+      PrattCertificate corrupted(bytes);
+      if (corrupted.verify())
+        EXPECT_TRUE(is_prime(corrupted.number())) << i;
+      bytes[i] ^= flip;
+    }
+  }
+  bytes.push_back(0);
+  EXPECT_FALSE(PrattCertificate::verify(bytes));
+  bytes.resize(bytes.size() - 2);
+  EXPECT_FALSE(PrattCertificate::verify(bytes));
+}
+
+TEST(PrimeCertificateTest, VerifyMany) {
+  std::vector<PrattCertificate> certificates;
+  std::vector<bool> expected;
+  for (uint64_t n = (uint64_t(1) << 40) + 1; certificates.size() < 100;
+       n += 2) {
+    if (!is_prime(n))
+      continue;
+    certificates.push_back(prove_prime(n));
+    expected.push_back(true);
+    std::vector<uint8_t> bytes(certificates.back().bytes().begin(),
+                               certificates.back().bytes().end());
+    bytes.back() ^= 1;
+    certificates.emplace_back(std::move(bytes));
+    expected.push_back(false);
+  }
+  ThreadPool pool(4);
+  auto results = std::make_unique<bool[]>(certificates.size());
+  verify_many(certificates, std::span(results.get(), certificates.size()),
+              pool);
+  for (size_t i = 0; i < certificates.size(); ++i)
+    EXPECT_EQ(results[i], expected[i]) << i;
+  EXPECT_THROW(verify_many(certificates, std::span(results.get(), 1), pool),
+               std::invalid_argument);
+}
+
+}  // namespace tql::number_theory
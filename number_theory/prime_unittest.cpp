@@ -1,8 +1,13 @@
 #include <stdint.h>
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
 #include <numeric>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -38,4 +43,86 @@ TEST(CoprimeTest, CoprimePairs) {
   test_coprime_pairs<uint64_t>();
 }
 
+TEST(CoprimeTest, MemoryResource) {
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::vector<std::pair<int, int>> pairs = pmr::coprime_pairs(100, &arena);
+  EXPECT_EQ(pairs.get_allocator().resource(), &arena);
+  EXPECT_EQ(pairs.size(), coprime_pairs(100).size());
+  EXPECT_TRUE(std::equal(pairs.begin(), pairs.end(),
+                         coprime_pairs(100).begin()));
+  EXPECT_TRUE(pmr::coprime_pairs(0, &arena).empty());
+}
+
+TEST(PrimeTest, IsPrime) {
+  for (int i = -10; i < 1000; ++i) {
+    bool expected = i >= 2;
+    for (int d = 2; d * d <= i; ++d) {
+      if (i % d == 0)
+        expected = false;
+    }
+    EXPECT_EQ(is_prime(int16_t(i)), expected);
+    EXPECT_EQ(is_prime(int32_t(i)), expected);
+    EXPECT_EQ(is_prime(int64_t(i)), expected);
+    if (i >= 0) {
+      EXPECT_EQ(is_prime(uint32_t(i)), expected);
+      EXPECT_EQ(is_prime(uint64_t(i)), expected);
+    }
+  }
+
+  // Large primes and strong pseudoprimes to small bases.
+  EXPECT_TRUE(is_prime(uint32_t(4294967291)));
+  EXPECT_TRUE(is_prime(int64_t(999999999989)));
+  EXPECT_TRUE(is_prime(uint64_t(18446744073709551557u)));
+  EXPECT_FALSE(is_prime(uint32_t(3215031751)));
+  EXPECT_FALSE(is_prime(uint64_t(3825123056546413051)));
+  EXPECT_FALSE(is_prime(uint64_t(4294967291) * 4294967279));
+  EXPECT_FALSE(is_prime(std::numeric_limits<uint64_t>::max()));
+  static_assert(is_prime(uint64_t(1000000007)));
+}
+
+TEST(PrimeTest, IsPrime128) {
+  using u128 = unsigned __int128;
+  for (uint64_t i = 0; i < 1000; ++i)
+    EXPECT_EQ(is_prime(u128(i)), is_prime(i));
+  u128 mersenne127 = (u128(1) << 127) - 1;
+  EXPECT_TRUE(is_prime(mersenne127));
+  EXPECT_TRUE(is_prime(__int128(mersenne127)));
+  EXPECT_TRUE(is_prime((u128(1) << 89) - 1));
+  EXPECT_TRUE(is_prime((u128(1) << 64) + 13));
+  EXPECT_FALSE(is_prime((u128(1) << 67) - 1));
+  EXPECT_FALSE(is_prime(((u128(1) << 64) + 13) * ((u128(1) << 61) - 1)));
+  EXPECT_FALSE(is_prime(u128(18446744073709551557u) * 18446744073709551557u));
+  EXPECT_FALSE(is_prime(~u128(0)));
+  EXPECT_FALSE(is_prime(-__int128(7)));
+  // The smallest strong pseudoprime to the prime bases up to 37.
+  EXPECT_FALSE(is_prime(u128(3186658578340311511) * 100000 + 67461));
+  // The smallest strong pseudoprime to the prime bases up to 41, which the
+  // strong Lucas test rejects.
+  EXPECT_FALSE(is_prime(prime_internal::kMillerRabinBound));
+  static_assert(!prime_internal::is_prime_u128(
+      prime_internal::kMillerRabinBound));
+  static_assert(prime_internal::is_prime_u128((u128(1) << 107) - 1));
+}
+
+TEST(PrimeTest, StrongLucas) {
+  using u128 = unsigned __int128;
+  // The strong Lucas pseudoprimes below 20000 with Selfridge's parameters.
+  constexpr uint64_t kPseudoprimes[] = {5459, 5777, 10877, 16109, 18971};
+  for (uint64_t n = 43; n < 20000; n += 2) {
+    if (prime_internal::is_square_u128(n))
+      continue;
+    bool expected = is_prime(n) || std::find(std::begin(kPseudoprimes),
+                                             std::end(kPseudoprimes),
+                                             n) != std::end(kPseudoprimes);
+    EXPECT_EQ(prime_internal::strong_lucas_test(Montgomery<u128>(n)),
+              expected)
+        << n;
+  }
+  EXPECT_TRUE(prime_internal::is_square_u128(u128(1) << 126));
+  EXPECT_FALSE(prime_internal::is_square_u128((u128(1) << 126) + 1));
+  u128 root = 18446744073709551557u;
+  EXPECT_TRUE(prime_internal::is_square_u128(root * root));
+  EXPECT_FALSE(prime_internal::is_square_u128(root * root - 1));
+}
+
 }  // namespace tql::number_theory
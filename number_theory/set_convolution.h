@@ -0,0 +1,394 @@
+#ifndef NUMBER_THEORY_SET_CONVOLUTION_H_
+#define NUMBER_THEORY_SET_CONVOLUTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "number_theory/convolution.h"
+#include "number_theory/modular.h"
+#include "number_theory/thread_pool.h"
+
+// Transforms and convolutions of set functions, which are sequences of
+// Modular values indexed by the subsets of {0, ..., k - 1} as bit masks.
+
+namespace tql {
+namespace number_theory {
+
+namespace set_convolution_internal {
+
+using convolution_internal::KernelArithmetic;
+
+// The transforms, by their butterflies on the pair (x, y) of the values at
+// the sets without and with an element.
+enum class SetTransform {
+  kWalshHadamard,   // (x + y, x - y)
+  kSubsetZeta,      // (x, y + x)
+  kSubsetMobius,    // (x, y - x)
+  kSupersetZeta,    // (x + y, y)
+  kSupersetMobius,  // (x - y, y)
+};
+
+// Applies the butterflies of |kTransform| to |x|[i] and |y|[i] for i <
+// |size|. The loop has no branches, so that it is vectorized.
+template <typename A, SetTransform kTransform>
+void butterflies(typename A::Value *x, typename A::Value *y, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if constexpr (kTransform == SetTransform::kWalshHadamard) {
+      auto sum = A::add(x[i], y[i]);
+      y[i] = A::subtract(x[i], y[i]);
+      x[i] = sum;
+    } else if constexpr (kTransform == SetTransform::kSubsetZeta) {
+      y[i] = A::add(y[i], x[i]);
+    } else if constexpr (kTransform == SetTransform::kSubsetMobius) {
+      y[i] = A::subtract(y[i], x[i]);
+    } else if constexpr (kTransform == SetTransform::kSupersetZeta) {
+      x[i] = A::add(x[i], y[i]);
+    } else {
+      x[i] = A::subtract(x[i], y[i]);
+    }
+  }
+}
+
+// The values of a tile fit the L1 cache.
+inline constexpr size_t kTileBytes = 1 << 14;
+
+// The rows of the tiles across tiles span a few cache lines.
+inline constexpr size_t kMinColumnBytes = 256;
+
+// Throws invalid_argument exception unless |size| is a power of two.
+inline void check_size(size_t size) {
+  if (!std::has_single_bit(size))
+    throw std::invalid_argument("The size must be a power of two.");
+}
+
+// Calls |function|(begin, end) on chunks of [0, |size|) on |pool|, or on this
+// thread if |pool| is null.
+template <typename Function>
+void for_each_chunk(size_t size, ThreadPool *pool, Function function) {
+  if (pool == nullptr || pool->num_threads() == 1 || size == 1) {
+    function(0, size);
+    return;
+  }
+  size_t num_chunks = std::min(size, pool->num_threads() * 4);
+  pool->parallel_for(0, num_chunks, [&](size_t chunk) {
+    function(size * chunk / num_chunks, size * (chunk + 1) / num_chunks);
+  });
+}
+
+// Copies |size| values from |values| to |buffer| in the arithmetic A.
+template <typename A, ModularType M>
+void load(const M *values, size_t size, typename A::Value *buffer) {
+  for (size_t i = 0; i < size; ++i)
+    buffer[i] = static_cast<typename A::Value>(values[i].get());
+}
+
+// Copies |size| values from |buffer| back to |values|.
+template <typename A, ModularType M>
+void store(const typename A::Value *buffer, size_t size, M *values) {
+  for (size_t i = 0; i < size; ++i)
+    values[i] = static_cast<typename M::type>(buffer[i]);
+}
+
+// Applies |kTransform| to |values| in place on |pool|, or on this thread if
+// |pool| is null.
+//
+// The transform does a level of butterflies per bit of the index. The low
+// bits are done within contiguous tiles which fit the L1 cache. The high bits
+// are done in groups, each in tiles of rows at the stride of the lowest bit
+// of the group, so that a group takes one pass over the memory. The tiles of
+// a pass are independent, and split among the threads.
+template <ModularType M, SetTransform kTransform>
+void transform(std::span<M> values, ThreadPool *pool) {
+  using A = KernelArithmetic<M>;
+  using Value = typename A::Value;
+  // The values of the arithmetic on lanes are copied to a buffer, and the
+  // others are transformed in place.
+  constexpr bool kInPlace = std::is_same_v<Value, M>;
+  constexpr size_t kTileSize = std::bit_floor(kTileBytes / sizeof(Value));
+  constexpr size_t kMinColumns =
+      std::max<size_t>(kMinColumnBytes / sizeof(Value), 1);
+  check_size(values.size());
+  size_t size = values.size();
+  size_t tile = std::min(size, kTileSize);
+  for_each_chunk(size / tile, pool, [&](size_t begin, size_t end) {
+    std::vector<Value> buffer(kInPlace ? 0 : tile);
+    for (size_t t = begin; t < end; ++t) {
+      M *x = values.data() + t * tile;
+      Value *y;
+      if constexpr (kInPlace) {
+        y = x;
+      } else {
+        y = buffer.data();
+        load<A>(x, tile, y);
+      }
+      for (size_t half = 1; half < tile; half *= 2) {
+        for (size_t start = 0; start < tile; start += 2 * half)
+          butterflies<A, kTransform>(y + start, y + start + half, half);
+      }
+      if constexpr (!kInPlace)
+        store<A>(y, tile, x);
+    }
+  });
+  for (size_t stride = tile; stride < size;) {
+    size_t rows = std::min(size / stride, tile / kMinColumns);
+    size_t columns = tile / rows;
+    for_each_chunk(size / tile, pool, [&](size_t begin, size_t end) {
+      std::vector<Value> buffer(kInPlace ? 0 : tile);
+      for (size_t t = begin; t < end; ++t) {
+        // The tile of the rows at the stride |stride| from the |group|-th
+        // group of high bits, and the columns from |column| below them.
+        size_t group = t / (stride / columns);
+        size_t column = t % (stride / columns) * columns;
+        M *x = values.data() + group * rows * stride + column;
+        Value *y;
+        size_t y_stride;
+        if constexpr (kInPlace) {
+          y = x;
+          y_stride = stride;
+        } else {
+          y = buffer.data();
+          y_stride = columns;
+          for (size_t r = 0; r < rows; ++r)
+            load<A>(x + r * stride, columns, y + r * columns);
+        }
+        for (size_t step = 1; step < rows; step *= 2) {
+          for (size_t start = 0; start < rows; start += 2 * step) {
+            for (size_t r = start; r < start + step; ++r) {
+              butterflies<A, kTransform>(y + r * y_stride,
+                                         y + (r + step) * y_stride, columns);
+            }
+          }
+        }
+        if constexpr (!kInPlace) {
+          for (size_t r = 0; r < rows; ++r)
+            store<A>(y + r * columns, columns, x + r * stride);
+        }
+      }
+    });
+    stride *= rows;
+  }
+}
+
+// Multiplies |a| by |b| element-wise in place.
+template <ModularType M>
+void multiply(std::span<M> a, std::span<const M> b, ThreadPool *pool) {
+  for_each_chunk(a.size(), pool, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      a[i] *= b[i];
+  });
+}
+
+// Returns the convolution of |a| and |b| with the transform |kTransform| and
+// its inverse |kInverse|.
+template <ModularType M, SetTransform kTransform, SetTransform kInverse>
+std::vector<M> convolve(std::span<const M> a, std::span<const M> b,
+                        ThreadPool *pool) {
+  check_size(a.size());
+  if (a.size() != b.size())
+    throw std::invalid_argument("The sizes of the operands must be equal.");
+  std::vector<M> x(a.begin(), a.end()), y(b.begin(), b.end());
+  transform<M, kTransform>(std::span(x), pool);
+  transform<M, kTransform>(std::span(y), pool);
+  multiply<M>(x, y, pool);
+  transform<M, kInverse>(std::span(x), pool);
+  return x;
+}
+
+// Inverts the Walsh-Hadamard transform of |values| in place on |pool|, or on
+// this thread if |pool| is null.
+template <ModularType M>
+void inverse_walsh_hadamard(std::span<M> values, ThreadPool *pool) {
+  check_size(values.size());
+  if (values.size() > 1 && M::modulus % 2 == 0)
+    throw std::domain_error("The size must be invertible.");
+  transform<M, SetTransform::kWalshHadamard>(values, pool);
+  M scale = M(static_cast<typename M::type>(values.size() % M::modulus))
+                .inverse();
+  for_each_chunk(values.size(), pool, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      values[i] *= scale;
+  });
+}
+
+// Returns the convolution of |a| and |b| by the symmetric difference on
+// |pool|, or on this thread if |pool| is null.
+template <ModularType M>
+std::vector<M> xor_convolve(std::span<const M> a, std::span<const M> b,
+                            ThreadPool *pool) {
+  check_size(a.size());
+  if (a.size() != b.size())
+    throw std::invalid_argument("The sizes of the operands must be equal.");
+  std::vector<M> x(a.begin(), a.end()), y(b.begin(), b.end());
+  transform<M, SetTransform::kWalshHadamard>(std::span(x), pool);
+  transform<M, SetTransform::kWalshHadamard>(std::span(y), pool);
+  multiply<M>(x, y, pool);
+  inverse_walsh_hadamard<M>(x, pool);
+  return x;
+}
+
+}  // namespace set_convolution_internal
+
+// The transforms below apply to |values| in place, whose size must be a power
+// of two 2^k. Each has a parallel version, which runs on the threads of
+// |pool|.
+// Throws invalid_argument exception if the size is not a power of two.
+
+// Walsh-Hadamard transform: values[S] becomes the sum of (-1)^|S & T| values[T]
+// over all T.
+template <ModularType M>
+void walsh_hadamard_transform(std::span<M> values) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kWalshHadamard>(values, nullptr);
+}
+
+template <ModularType M>
+void walsh_hadamard_transform(std::span<M> values, ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kWalshHadamard>(values, &pool);
+}
+
+// Inverts walsh_hadamard_transform, which is the same transform divided by
+// the size.
+// Throws domain_error exception if the size is not invertible modulo
+// M::modulus.
+template <ModularType M>
+void inverse_walsh_hadamard_transform(std::span<M> values) {
+  set_convolution_internal::inverse_walsh_hadamard(values, nullptr);
+}
+
+template <ModularType M>
+void inverse_walsh_hadamard_transform(std::span<M> values, ThreadPool &pool) {
+  set_convolution_internal::inverse_walsh_hadamard(values, &pool);
+}
+
+// Subset zeta transform: values[S] becomes the sum of values[T] over the
+// subsets T of S.
+template <ModularType M>
+void subset_zeta_transform(std::span<M> values) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSubsetZeta>(values, nullptr);
+}
+
+template <ModularType M>
+void subset_zeta_transform(std::span<M> values, ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSubsetZeta>(values, &pool);
+}
+
+// Subset Mobius transform, which inverts subset_zeta_transform.
+template <ModularType M>
+void subset_mobius_transform(std::span<M> values) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSubsetMobius>(values, nullptr);
+}
+
+template <ModularType M>
+void subset_mobius_transform(std::span<M> values, ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSubsetMobius>(values, &pool);
+}
+
+// Superset zeta transform: values[S] becomes the sum of values[T] over the
+// supersets T of S.
+template <ModularType M>
+void superset_zeta_transform(std::span<M> values) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSupersetZeta>(values, nullptr);
+}
+
+template <ModularType M>
+void superset_zeta_transform(std::span<M> values, ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSupersetZeta>(values, &pool);
+}
+
+// Superset Mobius transform, which inverts superset_zeta_transform.
+template <ModularType M>
+void superset_mobius_transform(std::span<M> values) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSupersetMobius>(values, nullptr);
+}
+
+template <ModularType M>
+void superset_mobius_transform(std::span<M> values, ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  transform<M, SetTransform::kSupersetMobius>(values, &pool);
+}
+
+// The convolutions below return c with c[S] = sum of |a|[T] |b|[U] over the
+// pairs (T, U) with T op U = S, where |a| and |b| have the same size, a power
+// of two. Each has a parallel version, which runs on the threads of |pool|.
+// Throws invalid_argument exception if the sizes differ or are not powers of
+// two.
+
+// Returns the convolution of |a| and |b| by the symmetric difference T ^ U.
+// Throws domain_error exception if the size is not invertible modulo
+// M::modulus.
+template <ModularType M>
+std::vector<M> xor_convolution(std::span<const M> a, std::span<const M> b) {
+  return set_convolution_internal::xor_convolve(a, b, nullptr);
+}
+
+template <ModularType M>
+std::vector<M> xor_convolution(std::span<const M> a,
+                               std::span<const M> b,
+                               ThreadPool &pool) {
+  return set_convolution_internal::xor_convolve(a, b, &pool);
+}
+
+// Returns the convolution of |a| and |b| by the intersection T & U.
+template <ModularType M>
+std::vector<M> and_convolution(std::span<const M> a, std::span<const M> b) {
+  using namespace set_convolution_internal;
+  return convolve<M, SetTransform::kSupersetZeta,
+                  SetTransform::kSupersetMobius>(a, b, nullptr);
+}
+
+template <ModularType M>
+std::vector<M> and_convolution(std::span<const M> a,
+                               std::span<const M> b,
+                               ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  return convolve<M, SetTransform::kSupersetZeta,
+                  SetTransform::kSupersetMobius>(a, b, &pool);
+}
+
+// Returns the convolution of |a| and |b| by the union T | U.
+template <ModularType M>
+std::vector<M> or_convolution(std::span<const M> a, std::span<const M> b) {
+  using namespace set_convolution_internal;
+  return convolve<M, SetTransform::kSubsetZeta, SetTransform::kSubsetMobius>(
+      a, b, nullptr);
+}
+
+template <ModularType M>
+std::vector<M> or_convolution(std::span<const M> a,
+                              std::span<const M> b,
+                              ThreadPool &pool) {
+  using namespace set_convolution_internal;
+  return convolve<M, SetTransform::kSubsetZeta, SetTransform::kSubsetMobius>(
+      a, b, &pool);
+}
+
+}  // namespace number_theory
+
+using number_theory::and_convolution;
+using number_theory::inverse_walsh_hadamard_transform;
+using number_theory::or_convolution;
+using number_theory::subset_mobius_transform;
+using number_theory::subset_zeta_transform;
+using number_theory::superset_mobius_transform;
+using number_theory::superset_zeta_transform;
+using number_theory::walsh_hadamard_transform;
+using number_theory::xor_convolution;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_SET_CONVOLUTION_H_
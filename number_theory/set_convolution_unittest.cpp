@@ -0,0 +1,207 @@
+#include <stdint.h>
+
+#include <bit>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/modular.h"
+#include "number_theory/set_convolution.h"
+#include "number_theory/thread_pool.h"
+
+namespace tql::number_theory {
+
+// Returns |size| random values modulo |mod|.
+template <auto mod>
+std::vector<Modular<mod>> random_values(size_t size, uint64_t seed) {
+  using Mod = Modular<mod>;
+  std::mt19937_64 generator(seed);
+  std::vector<Mod> values(size);
+  for (Mod &value : values) {
+    value = Mod(static_cast<typename Mod::type>(generator() %
+                                                static_cast<uint64_t>(mod)));
+  }
+  return values;
+}
+
+// Returns the sums of |values|[T] (-1)^|S & T| over the pairs (S, T) with
+// |include|(S, T), by S.
+template <typename M, typename Include>
+std::vector<M> sum_naive(const std::vector<M> &values, Include include,
+                         bool signed_sum = false) {
+  std::vector<M> result(values.size());
+  for (size_t s = 0; s < values.size(); ++s) {
+    for (size_t t = 0; t < values.size(); ++t) {
+      if (!include(s, t))
+        continue;
+      if (signed_sum && std::popcount(s & t) % 2 == 1)
+        result[s] -= values[t];
+      else
+        result[s] += values[t];
+    }
+  }
+  return result;
+}
+
+// Returns the convolution of |a| and |b| by |op| by definition.
+template <typename M, typename Op>
+std::vector<M> convolve_naive(const std::vector<M> &a, const std::vector<M> &b,
+                              Op op) {
+  std::vector<M> result(a.size());
+  for (size_t t = 0; t < a.size(); ++t) {
+    for (size_t u = 0; u < b.size(); ++u)
+      result[op(t, u)] += a[t] * b[u];
+  }
+  return result;
+}
+
+// Checks the transforms and convolutions modulo |mod| against their
+// definitions for the sizes up to 2^|max_bits|.
+template <auto mod>
+void test_definitions(int max_bits) {
+  using Mod = Modular<mod>;
+  auto is_subset = [](size_t s, size_t t) { return (s & t) == t; };
+  auto is_superset = [](size_t s, size_t t) { return (s & t) == s; };
+  auto any = [](size_t, size_t) { return true; };
+  for (int bits = 0; bits <= max_bits; ++bits) {
+    size_t n = size_t(1) << bits;
+    std::vector<Mod> a = random_values<mod>(n, bits),
+                     b = random_values<mod>(n, bits + 100);
+    std::vector<Mod> x = a;
+    subset_zeta_transform<Mod>(x);
+    EXPECT_EQ(x, sum_naive(a, is_subset)) << bits;
+    subset_mobius_transform<Mod>(x);
+    EXPECT_EQ(x, a) << bits;
+    superset_zeta_transform<Mod>(x);
+    EXPECT_EQ(x, sum_naive(a, is_superset)) << bits;
+    superset_mobius_transform<Mod>(x);
+    EXPECT_EQ(x, a) << bits;
+    EXPECT_EQ(or_convolution<Mod>(a, b),
+              convolve_naive(a, b, [](size_t t, size_t u) { return t | u; }))
+        << bits;
+    EXPECT_EQ(and_convolution<Mod>(a, b),
+              convolve_naive(a, b, [](size_t t, size_t u) { return t & u; }))
+        << bits;
+    if constexpr (mod % 2 == 1) {
+      walsh_hadamard_transform<Mod>(x);
+      EXPECT_EQ(x, sum_naive(a, any, true)) << bits;
+      inverse_walsh_hadamard_transform<Mod>(x);
+      EXPECT_EQ(x, a) << bits;
+      EXPECT_EQ(xor_convolution<Mod>(a, b),
+                convolve_naive(a, b, [](size_t t, size_t u) { return t ^ u; }))
+          << bits;
+    }
+  }
+}
+
+TEST(SetConvolutionTest, Definitions) {
+  test_definitions<998244353>(8);
+  test_definitions<1000000007>(8);
+  test_definitions<uint64_t(0x1fffffffffffffff)>(7);
+  test_definitions<7>(6);
+  test_definitions<uint32_t(1) << 20>(6);
+  test_definitions<uint64_t(1) << 40>(6);
+}
+
+// Returns the subset zeta transform of |values| a level at a time.
+template <typename M>
+std::vector<M> subset_zeta_naive(std::vector<M> values) {
+  for (size_t bit = 1; bit < values.size(); bit *= 2) {
+    for (size_t s = 0; s < values.size(); ++s) {
+      if (s & bit)
+        values[s] += values[s ^ bit];
+    }
+  }
+  return values;
+}
+
+// Returns the Walsh-Hadamard transform of |values| a level at a time.
+template <typename M>
+std::vector<M> walsh_hadamard_naive(std::vector<M> values) {
+  for (size_t bit = 1; bit < values.size(); bit *= 2) {
+    for (size_t s = 0; s < values.size(); ++s) {
+      if (s & bit)
+        continue;
+      M x = values[s], y = values[s | bit];
+      values[s] = x + y;
+      values[s | bit] = x - y;
+    }
+  }
+  return values;
+}
+
+// Checks the transforms modulo |mod| of the sizes which span several tiles,
+// with and without |pool|.
+template <auto mod>
+void test_tiles(ThreadPool &pool) {
+  using Mod = Modular<mod>;
+  for (int bits : {11, 12, 13, 14, 15, 17}) {
+    size_t n = size_t(1) << bits;
+    std::vector<Mod> a = random_values<mod>(n, bits);
+    std::vector<Mod> zeta = subset_zeta_naive(a);
+    std::vector<Mod> hadamard = walsh_hadamard_naive(a);
+    std::vector<Mod> x = a;
+    subset_zeta_transform<Mod>(x);
+    EXPECT_EQ(x, zeta) << bits;
+    subset_mobius_transform<Mod>(x);
+    EXPECT_EQ(x, a) << bits;
+    superset_zeta_transform<Mod>(x);
+    superset_mobius_transform<Mod>(x);
+    EXPECT_EQ(x, a) << bits;
+    walsh_hadamard_transform<Mod>(x);
+    EXPECT_EQ(x, hadamard) << bits;
+    inverse_walsh_hadamard_transform<Mod>(x);
+    EXPECT_EQ(x, a) << bits;
+
+    subset_zeta_transform<Mod>(x, pool);
+    EXPECT_EQ(x, zeta) << bits;
+    subset_mobius_transform<Mod>(x, pool);
+    EXPECT_EQ(x, a) << bits;
+    superset_zeta_transform<Mod>(x, pool);
+    superset_mobius_transform<Mod>(x, pool);
+    EXPECT_EQ(x, a) << bits;
+    walsh_hadamard_transform<Mod>(x, pool);
+    EXPECT_EQ(x, hadamard) << bits;
+    inverse_walsh_hadamard_transform<Mod>(x, pool);
+    EXPECT_EQ(x, a) << bits;
+  }
+}
+
+TEST(SetConvolutionTest, Tiles) {
+  ThreadPool pool(3);
+  test_tiles<998244353>(pool);
+  test_tiles<1000000007>(pool);
+  test_tiles<uint64_t(0x1fffffffffffffff)>(pool);
+}
+
+TEST(SetConvolutionTest, ConvolutionsWithPool) {
+  using Mod = Modular<998244353>;
+  ThreadPool pool(3);
+  size_t n = size_t(1) << 16;
+  std::vector<Mod> a = random_values<998244353>(n, 1),
+                   b = random_values<998244353>(n, 2);
+  EXPECT_EQ(xor_convolution<Mod>(a, b, pool), xor_convolution<Mod>(a, b));
+  EXPECT_EQ(and_convolution<Mod>(a, b, pool), and_convolution<Mod>(a, b));
+  EXPECT_EQ(or_convolution<Mod>(a, b, pool), or_convolution<Mod>(a, b));
+}
+
+TEST(SetConvolutionTest, Errors) {
+  using Mod = Modular<998244353>;
+  std::vector<Mod> values(6), other(8);
+  EXPECT_THROW(walsh_hadamard_transform<Mod>(values), std::invalid_argument);
+  EXPECT_THROW(subset_zeta_transform<Mod>(values), std::invalid_argument);
+  EXPECT_THROW(superset_mobius_transform<Mod>(std::span<Mod>()),
+               std::invalid_argument);
+  EXPECT_THROW(xor_convolution<Mod>(values, values), std::invalid_argument);
+  EXPECT_THROW(or_convolution<Mod>(other, std::vector<Mod>(4)),
+               std::invalid_argument);
+  EXPECT_THROW(and_convolution<Mod>(values, other), std::invalid_argument);
+  using Even = Modular<1024>;
+  std::vector<Even> even(4);
+  EXPECT_THROW(inverse_walsh_hadamard_transform<Even>(even), std::domain_error);
+  EXPECT_THROW(xor_convolution<Even>(even, even), std::domain_error);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,301 @@
+#ifndef NUMBER_THEORY_SHARED_SIEVE_H_
+#define NUMBER_THEORY_SHARED_SIEVE_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+#include "number_theory/utility.h"
+
+// Sieve tables shared across processes with POSIX shared memory.
+
+namespace tql {
+namespace number_theory {
+
+namespace shared_sieve_internal {
+
+// Identifies a complete table. It is written after the table is built.
+inline constexpr uint64_t kMagic = 0x7471'6c65'756c'6572;  // "tqleuler"
+
+// Layout of the beginning of the shared memory object. The minimum prime
+// factor table follows the header, and the primes follow the table.
+struct alignas(64) Header {
+  uint64_t magic;
+  uint32_t type_digits;
+  uint32_t type_is_signed;
+  uint64_t num_limit;
+  uint64_t num_primes;
+};
+
+// Returns the size of the shared memory object.
+template <typename T>
+size_t object_size(uint64_t num_limit, uint64_t num_primes) {
+  return sizeof(Header) + (num_limit + 1 + num_primes) * sizeof(T);
+}
+
+// Throws system_error exception for the last failed system call.
+[[noreturn]] inline void throw_system_error(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Owns a file descriptor.
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+  ~FileDescriptor() { close(fd_); }
+
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// Maps |length| bytes of the shared memory object |fd|.
+inline void *map(int fd, size_t length, bool writable) {
+  void *address =
+      mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+           MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED)
+    throw_system_error("mmap");
+  return address;
+}
+
+}  // namespace shared_sieve_internal
+
+// The table of EulerSieve in a named POSIX shared memory object.
+//
+// One process builds the table with create(), and the other processes map it
+// read-only with attach(), so that a host keeps a single copy of the table.
+// The shared memory object stays alive until remove() is called, even if no
+// process has it mapped.
+//
+// The queries are the same as FactorTableView.
+template <typename T>
+class SharedEulerSieve {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "SharedEulerSieve must use integer types.");
+
+ public:
+  // The type of numbers used by the Sieve.
+  using type = T;
+
+  // Builds the table up to |num_limit| (inclusive) into a new shared memory
+  // object named |name| in |num_blocks| parallel blocks on the global
+  // ThreadPool. If |num_blocks| is zero, which is the default, one block per
+  // thread of the pool is used.
+  // Throws system_error exception if the object already exists.
+  static SharedEulerSieve create(const std::string &name,
+                                 const T &num_limit,
+                                 size_t num_blocks = 0) {
+    return create(name, num_limit, num_blocks, ThreadPool::global());
+  }
+
+  // Builds the table with the threads of |pool|.
+  static SharedEulerSieve create(const std::string &name,
+                                 const T &num_limit,
+                                 ThreadPool &pool) {
+    return create(name, num_limit, 0, pool);
+  }
+
+  // Maps the table in the shared memory object |name| read-only.
+  // Throws system_error exception if the object does not exist, and
+  // runtime_error exception if it is not a complete table of type T.
+  static SharedEulerSieve attach(const std::string &name) {
+    using shared_sieve_internal::Header;
+    using shared_sieve_internal::throw_system_error;
+
+    shared_sieve_internal::FileDescriptor fd(
+        shm_open(name.c_str(), O_RDONLY, 0));
+    if (fd.get() < 0)
+      throw_system_error("shm_open");
+    struct stat status;
+    if (fstat(fd.get(), &status) != 0)
+      throw_system_error("fstat");
+    size_t size = static_cast<size_t>(status.st_size);
+    if (size < sizeof(Header))
+      throw std::runtime_error("The shared memory object is not a table.");
+
+    SharedEulerSieve sieve(
+        shared_sieve_internal::map(fd.get(), size, /*writable=*/false), size);
+    const Header &header = *reinterpret_cast<const Header *>(sieve.address_);
+    uint64_t magic =
+        std::atomic_ref<uint64_t>(const_cast<uint64_t &>(header.magic))
+            .load(std::memory_order_acquire);
+    if (magic != shared_sieve_internal::kMagic)
+      throw std::runtime_error("The shared memory object is not a table.");
+    if (header.type_digits != std::numeric_limits<T>::digits ||
+        header.type_is_signed != std::numeric_limits<T>::is_signed)
+      throw std::runtime_error("The table has a different number type.");
+    if (size != shared_sieve_internal::object_size<T>(header.num_limit,
+                                                      header.num_primes))
+      throw std::runtime_error("The table is truncated.");
+    sieve.init_spans();
+    return sieve;
+  }
+
+  // Removes the name of the shared memory object. The processes which have
+  // mapped the table can still use it.
+  static void remove(const std::string &name) {
+    if (shm_unlink(name.c_str()) != 0)
+      shared_sieve_internal::throw_system_error("shm_unlink");
+  }
+
+  SharedEulerSieve(SharedEulerSieve &&other) noexcept
+      : address_(std::exchange(other.address_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        num_limit_(other.num_limit_),
+        min_prime_factor_(other.min_prime_factor_),
+        primes_(other.primes_) {}
+
+  SharedEulerSieve &operator=(SharedEulerSieve &&other) noexcept {
+    std::swap(address_, other.address_);
+    std::swap(size_, other.size_);
+    num_limit_ = other.num_limit_;
+    min_prime_factor_ = other.min_prime_factor_;
+    primes_ = other.primes_;
+    return *this;
+  }
+
+  ~SharedEulerSieve() {
+    if (address_ != nullptr)
+      munmap(address_, size_);
+  }
+
+  // Returns the maximum number (inclusive) we can hold.
+  const T &get_limit() const { return num_limit_; }
+
+  // Returns the list of primes.
+  std::span<const T> primes() const { return primes_; }
+
+  // Returns the minimum prime factor of the |number|.
+  // Throws domain_error exception if minimum prime factor does not exist.
+  T min_prime_factor(const T &number) const {
+    return view().min_prime_factor(number);
+  }
+
+  // Batched version of min_prime_factor.
+  // See FactorTableView::min_prime_factor_many.
+  void min_prime_factor_many(std::span<const T> numbers,
+                             std::span<T> results) const {
+    view().min_prime_factor_many(numbers, results);
+  }
+
+  // Returns the view of the tables.
+  FactorTableView<T> view() const {
+    return FactorTableView<T>(min_prime_factor_, primes_, num_limit_,
+                              typename FactorTableView<T>::Unchecked());
+  }
+
+ private:
+  // The mapped shared memory object.
+  char *address_;
+  size_t size_;
+  // The maximum number (inclusive) we can hold.
+  T num_limit_ = 0;
+  // Minimum prime factors.
+  std::span<const T> min_prime_factor_;
+  // Prime numbers.
+  std::span<const T> primes_;
+
+  SharedEulerSieve(void *address, size_t size)
+      : address_(static_cast<char *>(address)), size_(size) {}
+
+  // Builds the table in |num_blocks| parallel blocks on |pool|.
+  static SharedEulerSieve create(const std::string &name,
+                                 const T &num_limit,
+                                 size_t num_blocks,
+                                 ThreadPool &pool) {
+    using shared_sieve_internal::Header;
+    using shared_sieve_internal::throw_system_error;
+
+    sieve_internal::check_euler_sieve_overflow(num_limit);
+    uint64_t num_limit_u64 = numeric_cast<uint64_t>(num_limit);
+    shared_sieve_internal::FileDescriptor fd(
+        shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644));
+    if (fd.get() < 0)
+      throw_system_error("shm_open");
+
+    try {
+      // Sieve directly into the shared memory object. The number of primes is
+      // unknown until the table is built, so the object is extended and mapped
+      // again for the primes afterwards.
+      size_t table_size =
+          shared_sieve_internal::object_size<T>(num_limit_u64, 0);
+      if (ftruncate(fd.get(), static_cast<off_t>(table_size)) != 0)
+        throw_system_error("ftruncate");
+      std::vector<T> primes;
+      {
+        SharedEulerSieve table(shared_sieve_internal::map(fd.get(), table_size,
+                                                          /*writable=*/true),
+                               table_size);
+        std::span<T> min_prime_factor(
+            reinterpret_cast<T *>(table.address_ + sizeof(Header)),
+            num_limit_u64 + 1);
+        sieve_internal::parallel_euler_sieve(min_prime_factor, num_blocks,
+                                             pool, primes);
+      }
+
+      size_t size =
+          shared_sieve_internal::object_size<T>(num_limit_u64, primes.size());
+      if (ftruncate(fd.get(), static_cast<off_t>(size)) != 0)
+        throw_system_error("ftruncate");
+      SharedEulerSieve sieve(
+          shared_sieve_internal::map(fd.get(), size, /*writable=*/true), size);
+      std::copy(primes.begin(), primes.end(),
+                reinterpret_cast<T *>(sieve.address_ + table_size));
+      Header &header = *reinterpret_cast<Header *>(sieve.address_);
+      header.type_digits = std::numeric_limits<T>::digits;
+      header.type_is_signed = std::numeric_limits<T>::is_signed;
+      header.num_limit = num_limit_u64;
+      header.num_primes = primes.size();
+      // Publish the table to the processes attaching it.
+      std::atomic_ref<uint64_t>(header.magic)
+          .store(shared_sieve_internal::kMagic, std::memory_order_release);
+      if (mprotect(sieve.address_, size, PROT_READ) != 0)
+        throw_system_error("mprotect");
+      sieve.init_spans();
+      return sieve;
+    } catch (...) {
+      shm_unlink(name.c_str());
+      throw;
+    }
+  }
+
+  // Points the spans to the mapped table.
+  void init_spans() {
+    const auto &header =
+        *reinterpret_cast<const shared_sieve_internal::Header *>(address_);
+    num_limit_ = static_cast<T>(header.num_limit);
+    const T *table = reinterpret_cast<const T *>(
+        address_ + sizeof(shared_sieve_internal::Header));
+    min_prime_factor_ = std::span<const T>(table, header.num_limit + 1);
+    primes_ = std::span<const T>(table + header.num_limit + 1,
+                                 header.num_primes);
+  }
+};
+
+}  // namespace number_theory
+
+using number_theory::SharedEulerSieve;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_SHARED_SIEVE_H_
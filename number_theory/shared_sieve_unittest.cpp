@@ -0,0 +1,127 @@
+#include <signal.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/shared_sieve.h"
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+
+namespace tql::number_theory {
+
+// Returns a shared memory object name unique to this process.
+std::string shared_sieve_name(const std::string &suffix) {
+  return "/tql_shared_sieve_unittest_" + std::to_string(getpid()) + "_" +
+         suffix;
+}
+
+template <typename T>
+void test_shared_euler_sieve(const T &num_limit) {
+  std::string name = shared_sieve_name(std::to_string(sizeof(T)));
+  EulerSieve<T> expected(num_limit);
+  {
+    SharedEulerSieve<T> owner = SharedEulerSieve<T>::create(name, num_limit);
+    SharedEulerSieve<T> sieve = SharedEulerSieve<T>::attach(name);
+    for (const SharedEulerSieve<T> *table : {&owner, &sieve}) {
+      EXPECT_EQ(table->get_limit(), num_limit);
+      EXPECT_TRUE(std::equal(table->primes().begin(), table->primes().end(),
+                             expected.primes().begin(),
+                             expected.primes().end()));
+      for (T i = 2; i < num_limit; ++i)
+        ASSERT_EQ(table->min_prime_factor(i), expected.min_prime_factor(i));
+    }
+    FactorTableView<T> view = sieve;
+    EXPECT_EQ(view.get_limit(), num_limit);
+    EXPECT_EQ(view.primes().size(), expected.primes().size());
+    if (std::numeric_limits<T>::is_signed)
+      EXPECT_EQ(sieve.min_prime_factor(-15), 3);
+    std::vector<T> numbers{T(6), T(49), num_limit}, results(3);
+    sieve.min_prime_factor_many(numbers, results);
+    EXPECT_EQ(results[1], 7);
+    EXPECT_EQ(results[2], expected.min_prime_factor(num_limit));
+    EXPECT_THROW(sieve.min_prime_factor(1), std::domain_error);
+    EXPECT_THROW(sieve.min_prime_factor(num_limit + 1), std::out_of_range);
+  }
+  SharedEulerSieve<T>::remove(name);
+}
+
+TEST(SharedEulerSieveTest, CreateAndAttach) {
+  test_shared_euler_sieve<int8_t>(120);
+  test_shared_euler_sieve<int16_t>(10000);
+  test_shared_euler_sieve<int32_t>(100000);
+  test_shared_euler_sieve<uint64_t>(100000);
+}
+
+TEST(SharedEulerSieveTest, AttachFromAnotherProcess) {
+  std::string name = shared_sieve_name("process");
+  ThreadPool pool(2);
+  SharedEulerSieve<int> owner =
+      SharedEulerSieve<int>::create(name, 100000, pool);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    SharedEulerSieve<int> sieve = SharedEulerSieve<int>::attach(name);
+    bool ok = sieve.get_limit() == 100000 && sieve.primes().size() == 9592 &&
+              sieve.min_prime_factor(99999) == 3;
+    _exit(ok ? 0 : 1);
+  }
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  SharedEulerSieve<int>::remove(name);
+}
+
+TEST(SharedEulerSieveTest, Errors) {
+  std::string name = shared_sieve_name("errors");
+  EXPECT_THROW(SharedEulerSieve<int>::attach(name), std::system_error);
+  EXPECT_THROW(SharedEulerSieve<int>::remove(name), std::system_error);
+
+  SharedEulerSieve<int> owner = SharedEulerSieve<int>::create(name, 100);
+  EXPECT_THROW(SharedEulerSieve<int>::create(name, 100), std::system_error);
+  EXPECT_THROW(SharedEulerSieve<int64_t>::attach(name), std::runtime_error);
+  EXPECT_THROW(SharedEulerSieve<unsigned>::attach(name), std::runtime_error);
+  SharedEulerSieve<int>::remove(name);
+
+  // Invalid limits are rejected before the object is created.
+  EXPECT_THROW(SharedEulerSieve<int>::create(name, -1), std::range_error);
+  EXPECT_THROW(SharedEulerSieve<int>::attach(name), std::system_error);
+}
+
+TEST(SharedEulerSieveTest, RemovedOnFailure) {
+  // The name is removed if the creation fails after the object is created.
+  // A child process limits the file size, so that ftruncate fails.
+  std::string name = shared_sieve_name("failure");
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    signal(SIGXFSZ, SIG_IGN);
+    rlimit limit = {.rlim_cur = 4096, .rlim_max = RLIM_INFINITY};
+    if (setrlimit(RLIMIT_FSIZE, &limit) != 0)
+      _exit(2);
+    ThreadPool pool(1);
+    try {
+      SharedEulerSieve<int>::create(name, 100000, pool);
+      _exit(3);
+    } catch (const std::system_error &) {
+    }
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_THROW(SharedEulerSieve<int>::attach(name), std::system_error);
+  EXPECT_THROW(SharedEulerSieve<int>::remove(name), std::system_error);
+}
+
+}  // namespace tql::number_theory
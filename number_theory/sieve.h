@@ -4,12 +4,21 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <bit>
+#include <concepts>
 #include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "number_theory/numeric.h"
+#include "number_theory/thread_pool.h"
 #include "number_theory/utility.h"
 
 // This file contains functions and classes related to sieves.
@@ -17,10 +26,244 @@
 namespace tql {
 namespace number_theory {
 
+namespace sieve_internal {
+
+// Number of elements ahead to prefetch in the batched queries. It should cover
+// the latency of a DRAM access.
+inline constexpr size_t kPrefetchDistance = 16;
+
+// Hints the processor to load |address| into the cache.
+inline void prefetch([[maybe_unused]] const void *address) {
+#if defined(__GNUC__)
+  __builtin_prefetch(address);
+#endif
+}
+
+// Throws invalid_argument exception if the sizes of a batch mismatch.
+inline void check_batch_size(size_t num_numbers, size_t num_results) {
+  if (num_numbers != num_results)
+    throw std::invalid_argument(
+        "The numbers and the results must have the same size.");
+}
+
+}  // namespace sieve_internal
+
+// Non-owning view of the table of Sieve.
+// It can be created from a Sieve, or from a bit table in a raw buffer, for
+// example a memory-mapped file, where bit (i % 64) of word (i / 64) is set if
+// and only if i is prime. The viewed table must outlive the view.
+template <typename T>
+class SieveView {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "SieveView must use integer types.");
+
+ public:
+  // The type of numbers used by the Sieve.
+  using type = T;
+
+  // Views the bit table |bits| of the numbers up to |num_limit| (inclusive).
+  // Throws invalid_argument exception if |bits| is too short.
+  SieveView(const T &num_limit, std::span<const uint64_t> bits)
+      : num_limit_(num_limit), bits_(bits) {
+    if (num_limit < 0 || numeric_cast<uint64_t>(num_limit) / 64 >= bits.size())
+      throw std::invalid_argument("The table is shorter than the limit.");
+  }
+
+  // Views any table which provides a view, for example a Sieve.
+  template <typename Table>
+    requires requires(const Table &table) {
+      { table.view() } -> std::same_as<SieveView>;
+    }
+  SieveView(const Table &table)  // NOLINT(runtime/explicit)
+      : SieveView(table.view()) {}
+
+  // Returns the maximum number (inclusive) we can hold.
+  const T &get_limit() const { return num_limit_; }
+
+  // Returns the bit table.
+  std::span<const uint64_t> bits() const { return bits_; }
+
+  // Returns whether |number| is prime or not.
+  bool is_prime(const T &number) const {
+    if (number < 0)
+      return false;
+    if (number > num_limit_)
+      throw std::out_of_range("The number exceeds the limit of Sieve.");
+    return test_bit(static_cast<uint64_t>(number));
+  }
+
+  // Stores whether |numbers|[i] is prime or not to |results|[i].
+  // The whole batch is validated first, so nothing is written if it throws.
+  // The table is prefetched ahead, which hides the memory latency of random
+  // accesses to a large table.
+  void is_prime_many(std::span<const T> numbers,
+                     std::span<bool> results) const {
+    sieve_internal::check_batch_size(numbers.size(), results.size());
+    for (const T &number : numbers) {
+      if (number > num_limit_)
+        throw std::out_of_range("The number exceeds the limit of Sieve.");
+    }
+    for (size_t i = 0; i < numbers.size(); ++i) {
+      if (i + sieve_internal::kPrefetchDistance < numbers.size()) {
+        const T &next = numbers[i + sieve_internal::kPrefetchDistance];
+        if (next >= 0)
+          sieve_internal::prefetch(&bits_[static_cast<uint64_t>(next) / 64]);
+      }
+      const T &number = numbers[i];
+      results[i] = number >= 0 && test_bit(static_cast<uint64_t>(number));
+    }
+  }
+
+  // Returns the view of the numbers up to |num_limit| (inclusive), which
+  // should not exceed the current limit.
+  SieveView prefix(const T &num_limit) const {
+    if (num_limit > num_limit_)
+      throw std::out_of_range("The number exceeds the limit of Sieve.");
+    return SieveView(num_limit, bits_);
+  }
+
+ private:
+  template <typename U, typename Allocator>
+  friend class Sieve;
+
+  struct Unchecked {};
+
+  // Views a table which is valid by construction, without checking it, so
+  // that the queries of the owning classes stay cheap.
+  SieveView(const T &num_limit, std::span<const uint64_t> bits, Unchecked)
+      : num_limit_(num_limit), bits_(bits) {}
+
+  // The maximum number (inclusive) we can hold.
+  T num_limit_;
+  std::span<const uint64_t> bits_;
+
+  // Returns whether bit |index| is set.
+  bool test_bit(uint64_t index) const {
+    return (bits_[index / 64] >> (index % 64)) & 1;
+  }
+};
+
+// Non-owning view of the tables of EulerSieve.
+// It can be created from an EulerSieve or a SharedEulerSieve, or from tables
+// in raw buffers, for example memory-mapped files. The viewed tables must
+// outlive the view.
+template <typename T>
+class FactorTableView {
+  static_assert(std::numeric_limits<T>::is_integer,
+                "FactorTableView must use integer types.");
+
+ public:
+  // The type of numbers used by the Sieve.
+  using type = T;
+
+  // Views the table of the minimum prime factors |min_prime_factor|, whose
+  // last index is the limit, and the sorted list of the |primes| up to the
+  // limit. Throws invalid_argument exception if the table is empty.
+  FactorTableView(std::span<const T> min_prime_factor,
+                  std::span<const T> primes)
+      : min_prime_factor_(min_prime_factor), primes_(primes) {
+    if (min_prime_factor.empty())
+      throw std::invalid_argument("The table of FactorTableView is empty.");
+    num_limit_ = numeric_cast<T>(min_prime_factor.size() - 1);
+  }
+
+  // Views any table which provides a view, for example an EulerSieve.
+  template <typename Table>
+    requires requires(const Table &table) {
+      { table.view() } -> std::same_as<FactorTableView>;
+    }
+  FactorTableView(const Table &table)  // NOLINT(runtime/explicit)
+      : FactorTableView(table.view()) {}
+
+  // Returns the maximum number (inclusive) we can hold.
+  const T &get_limit() const { return num_limit_; }
+
+  // Returns the list of primes.
+  std::span<const T> primes() const { return primes_; }
+
+  // Returns the table of the minimum prime factors.
+  std::span<const T> min_prime_factors() const { return min_prime_factor_; }
+
+  // Returns the minimum prime factor of the |number|.
+  // Throws domain_error exception if minimum prime factor does not exist.
+  T min_prime_factor(const T &number) const {
+    auto abs_num = unsigned_abs(number);
+    if (abs_num <= 1)
+      throw std::domain_error("Minimum prime factor does not exist.");
+    if (abs_num > static_cast<std::make_unsigned_t<T>>(num_limit_))
+      throw std::out_of_range("The number exceeds the limit of Sieve.");
+    return min_prime_factor_[abs_num];
+  }
+
+  // Stores the minimum prime factor of |numbers|[i] to |results|[i].
+  // The whole batch is validated first, so nothing is written if it throws.
+  // The table is prefetched ahead, which hides the memory latency of random
+  // accesses to a large table.
+  void min_prime_factor_many(std::span<const T> numbers,
+                             std::span<T> results) const {
+    sieve_internal::check_batch_size(numbers.size(), results.size());
+    for (const T &number : numbers) {
+      auto abs_num = unsigned_abs(number);
+      if (abs_num <= 1)
+        throw std::domain_error("Minimum prime factor does not exist.");
+      if (abs_num > static_cast<std::make_unsigned_t<T>>(num_limit_))
+        throw std::out_of_range("The number exceeds the limit of Sieve.");
+    }
+    for (size_t i = 0; i < numbers.size(); ++i) {
+      if (i + sieve_internal::kPrefetchDistance < numbers.size()) {
+        sieve_internal::prefetch(&min_prime_factor_[unsigned_abs(
+            numbers[i + sieve_internal::kPrefetchDistance])]);
+      }
+      results[i] = min_prime_factor_[unsigned_abs(numbers[i])];
+    }
+  }
+
+  // Returns the view of the numbers up to |num_limit| (inclusive), which
+  // should not exceed the current limit.
+  FactorTableView prefix(const T &num_limit) const {
+    if (num_limit < 0)
+      throw std::invalid_argument("The limit must not be negative.");
+    if (num_limit > num_limit_)
+      throw std::out_of_range("The number exceeds the limit of Sieve.");
+    size_t num_primes =
+        std::upper_bound(primes_.begin(), primes_.end(), num_limit) -
+        primes_.begin();
+    return FactorTableView(
+        min_prime_factor_.first(static_cast<size_t>(num_limit) + 1),
+        primes_.first(num_primes));
+  }
+
+ private:
+  template <typename U, typename Allocator>
+  friend class EulerSieve;
+  template <typename U>
+  friend class SharedEulerSieve;
+
+  struct Unchecked {};
+
+  // Views tables which are valid by construction, without checking them, so
+  // that the queries of the owning classes stay cheap.
+  FactorTableView(std::span<const T> min_prime_factor,
+                  std::span<const T> primes,
+                  const T &num_limit,
+                  Unchecked)
+      : num_limit_(num_limit),
+        min_prime_factor_(min_prime_factor),
+        primes_(primes) {}
+
+  // The maximum number (inclusive) we can hold.
+  T num_limit_;
+  // Minimum prime factors.
+  std::span<const T> min_prime_factor_;
+  // Prime numbers.
+  std::span<const T> primes_;
+};
+
 // Sieve of Eratosthenes.
 // It decides whether a number is prime or not for the numbers up to a given
-// (inclusive) limit.
-template <typename T>
+// (inclusive) limit. The table is allocated with |Allocator|, which is rebound
+// to the element type of the table.
+template <typename T, typename Allocator = std::allocator<T>>
 class Sieve {
   static_assert(std::numeric_limits<T>::is_integer,
                 "Sieve must use integer types.");
@@ -28,20 +271,24 @@ class Sieve {
  public:
   // The type of numbers used by the Sieve.
   using type = T;
+  // The allocator type.
+  using allocator_type = Allocator;
 
-  explicit Sieve(const T &num_limit)
+  explicit Sieve(const T &num_limit, const Allocator &allocator = Allocator())
       : num_limit_(num_limit),
-        is_prime_(numeric_cast<size_t>(num_limit) + 1, true) {
-    is_prime_[0] = false;
-    is_prime_[1] = false;
+        bits_(numeric_cast<size_t>(num_limit) / 64 + 1,
+              ~uint64_t(0),
+              allocator) {
+    // 0 and 1 are not prime.
+    bits_[0] &= ~uint64_t(3);
     // Use uint64_t to avoid multiplication overflow. Due to the time and space
     // complexity of the algorithm, uint64_t is large enough.
     uint64_t num_limit_u64 = numeric_cast<uint64_t>(num_limit_);
     for (uint64_t i = 2; i * i <= num_limit_u64; ++i) {
-      if (!is_prime_[i])
+      if (((bits_[i / 64] >> (i % 64)) & 1) == 0)
         continue;
       for (uint64_t j = i * i; j <= num_limit_u64; j += i) {
-        is_prime_[j] = false;
+        bits_[j / 64] &= ~(uint64_t(1) << (j % 64));
       }
     }
   }
@@ -55,24 +302,205 @@ class Sieve {
   const T &get_limit() const { return num_limit_; }
 
   // Returns whether |number| is prime or not.
-  bool is_prime(const T &number) const {
-    if (number < 0)
-      return false;
-    if (number > num_limit_)
-      throw std::out_of_range("The number exceeds the limit of Sieve.");
-    return is_prime_[number];
+  bool is_prime(const T &number) const { return view().is_prime(number); }
+
+  // Batched version of is_prime. See SieveView::is_prime_many.
+  void is_prime_many(std::span<const T> numbers,
+                     std::span<bool> results) const {
+    view().is_prime_many(numbers, results);
+  }
+
+  // Returns the view of the table.
+  SieveView<T> view() const {
+    return SieveView<T>(num_limit_, bits_, typename SieveView<T>::Unchecked());
   }
 
  private:
   // The maximum number (inclusive) we can hold.
   T num_limit_;
-  std::vector<bool> is_prime_;
+  // Bit (i % 64) of bits_[i / 64] is set if and only if i is prime.
+  std::vector<uint64_t,
+              typename std::allocator_traits<Allocator>::template rebind_alloc<
+                  uint64_t>>
+      bits_;
 };
 
+namespace sieve_internal {
+
+// Numbers are converted to MultType during multiplication to avoid overflow.
+// uint64_t is large enough due to the time and space complexity of the sieve
+// algorithm.
+using MultType = uint64_t;
+
+// Number of elements processed at a time by the segmented sieve.
+// The segment of the table should fit in the L2 cache.
+inline constexpr uint64_t kSegmentSize = uint64_t(1) << 15;
+
+// Throws overflow_error exception if multiplication will overflow when sieving
+// up to |num_limit|.
+template <typename T>
+void check_euler_sieve_overflow(const T &num_limit) {
+  size_t num_limit_width =
+      std::bit_width(static_cast<std::make_unsigned_t<T>>(num_limit));
+  if (num_limit_width * 2 > std::numeric_limits<MultType>::digits)
+    throw std::overflow_error(
+        "Multiplication will overflow when sieving. "
+        "Please use larger integer types.");
+}
+
+// Euler's Sieve algorithm.
+// Fills the zero-initialized |min_prime_factor| table, whose last index is the
+// limit, and appends the primes to |primes|.
+template <typename T, typename PrimeVector>
+void euler_sieve(std::span<T> min_prime_factor, PrimeVector &primes) {
+  MultType num_limit = min_prime_factor.size() - 1;
+  for (MultType num = 2; num <= num_limit; ++num) {
+    if (min_prime_factor[num] == 0) {
+      primes.push_back(static_cast<T>(num));
+      min_prime_factor[num] = static_cast<T>(num);
+    }
+    for (const T &prime : primes) {
+      if (prime > min_prime_factor[num])
+        break;
+      MultType x = static_cast<MultType>(prime) * num;
+      if (x > num_limit)
+        break;
+      min_prime_factor[x] = prime;
+    }
+  }
+}
+
+// Marks the minimum prime factors of the numbers in [low, high) with the
+// |base_primes|, which must contain all primes up to sqrt(high - 1). The
+// primes are visited in increasing order, so the first prime that marks a
+// number is its minimum prime factor. Appends the primes found in the
+// segment to |primes|.
+template <typename T>
+void sieve_segment(std::span<T> min_prime_factor,
+                   const std::vector<T> &base_primes,
+                   uint64_t low,
+                   uint64_t high,
+                   std::vector<T> &primes) {
+  std::fill(min_prime_factor.begin() + low, min_prime_factor.begin() + high,
+            T(0));
+  for (const T &prime : base_primes) {
+    MultType p = static_cast<MultType>(prime);
+    if (p * p >= high)
+      break;
+    MultType start = std::max(p * p, (low + p - 1) / p * p);
+    for (MultType x = start; x < high; x += p) {
+      if (min_prime_factor[x] == 0)
+        min_prime_factor[x] = prime;
+    }
+  }
+  for (uint64_t num = std::max<uint64_t>(low, 2); num < high; ++num) {
+    if (min_prime_factor[num] == 0) {
+      min_prime_factor[num] = static_cast<T>(num);
+      primes.push_back(static_cast<T>(num));
+    }
+  }
+}
+
+// Multi-threaded version of euler_sieve, which sieves |num_blocks| blocks on
+// |pool|. If |num_blocks| is zero, one block per thread of |pool| is used. The
+// result is identical to euler_sieve.
+//
+// The primes up to sqrt(limit) are found first, then the table is split into
+// contiguous blocks. Each task marks the minimum prime factors in its own
+// block, one cache-sized segment at a time, so the tasks never write to the
+// same element. Each task also clears its own block before sieving, so if
+// |min_prime_factor| is memory which has not been touched yet, such as a fresh
+// mapping, its pages are first touched, and therefore placed, by the thread
+// that sieves them.
+//
+// |primes| is only modified on the calling thread.
+template <typename T, typename PrimeVector>
+void parallel_euler_sieve(std::span<T> min_prime_factor,
+                          size_t num_blocks,
+                          ThreadPool &pool,
+                          PrimeVector &primes) {
+  if (num_blocks == 0)
+    num_blocks = pool.num_threads();
+
+  uint64_t num_limit = min_prime_factor.size() - 1;
+  std::vector<T> base_primes;
+  std::vector<T> base_table(iroot(num_limit, 2) + 1);
+  euler_sieve(std::span<T>(base_table), base_primes);
+
+  // Split [0, num_limit] into blocks, which are multiples of the segment
+  // size except for the last one.
+  uint64_t num_segments = num_limit / kSegmentSize + 1;
+  num_blocks = std::min<uint64_t>(num_blocks, num_segments);
+  uint64_t segments_per_block = num_segments / num_blocks;
+  uint64_t remainder = num_segments % num_blocks;
+  std::vector<uint64_t> block_begin(num_blocks + 1);
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint64_t length = segments_per_block + (i < remainder ? 1 : 0);
+    block_begin[i + 1] =
+        std::min(block_begin[i] + length * kSegmentSize, num_limit + 1);
+  }
+
+  std::vector<std::vector<T>> block_primes(num_blocks);
+  pool.parallel_for(0, num_blocks, [&](size_t i) {
+    uint64_t end = block_begin[i + 1];
+    for (uint64_t low = block_begin[i]; low < end; low += kSegmentSize) {
+      sieve_segment(min_prime_factor, base_primes, low,
+                    std::min(low + kSegmentSize, end), block_primes[i]);
+    }
+  });
+
+  size_t num_primes = primes.size();
+  for (const std::vector<T> &block : block_primes)
+    num_primes += block.size();
+  primes.reserve(num_primes);
+  for (const std::vector<T> &block : block_primes)
+    primes.insert(primes.end(), block.begin(), block.end());
+}
+
+// Wraps |Allocator| so that the elements constructed without arguments are
+// default-initialized instead of value-initialized. A table of integers is
+// then left untouched until it is first written, which lets
+// parallel_euler_sieve place each block with the thread that sieves it.
+// Elements constructed with arguments are constructed by |Allocator|.
+template <typename Allocator>
+class DefaultInitAllocator : public Allocator {
+  using Traits = std::allocator_traits<Allocator>;
+
+ public:
+  template <typename U>
+  struct rebind {
+    using other =
+        DefaultInitAllocator<typename Traits::template rebind_alloc<U>>;
+  };
+
+  DefaultInitAllocator() = default;
+  DefaultInitAllocator(const Allocator &allocator)  // NOLINT(runtime/explicit)
+      : Allocator(allocator) {}
+
+  template <typename Other>
+  DefaultInitAllocator(  // NOLINT(runtime/explicit)
+      const DefaultInitAllocator<Other> &other)
+      : Allocator(static_cast<const Other &>(other)) {}
+
+  template <typename U>
+  void construct(U *pointer) {
+    ::new (static_cast<void *>(pointer)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *pointer, Args &&...args) {
+    Traits::construct(static_cast<Allocator &>(*this), pointer,
+                      std::forward<Args>(args)...);
+  }
+};
+
+}  // namespace sieve_internal
+
 // Sieve of Euler.
 // It finds all prime numbers under a certain limit.
 // It also provides the factorizations of all numbers under the limit.
-template <typename T>
+// The tables are allocated with |Allocator|.
+template <typename T, typename Allocator = std::allocator<T>>
 class EulerSieve {
   static_assert(std::numeric_limits<T>::is_integer,
                 "EulerSieve must use integer types.");
@@ -80,29 +508,43 @@ class EulerSieve {
  public:
   // The type of numbers used by the Sieve.
   using type = T;
+  // The allocator type.
+  using allocator_type = Allocator;
 
   // Constructs the sieve in linear time.
-  explicit EulerSieve(const T &num_limit)
+  explicit EulerSieve(const T &num_limit,
+                      const Allocator &allocator = Allocator())
       : num_limit_(num_limit),
-        min_prime_factor_(numeric_cast<size_t>(num_limit) + 1) {
-    check_overflow();
-    // Euler's Sieve algorithm
-    for (T num = 2; num <= num_limit_; ++num) {
-      if (min_prime_factor_[num] == 0) {
-        primes_.push_back(num);
-        min_prime_factor_[num] = num;
-      }
-      for (const T &prime : primes_) {
-        if (prime > min_prime_factor_[num])
-          break;
-        MultType x = static_cast<MultType>(prime) * static_cast<MultType>(num);
-        if (x > static_cast<MultType>(num_limit_))
-          break;
-        min_prime_factor_[x] = prime;
-      }
-    }
+        min_prime_factor_(numeric_cast<size_t>(num_limit) + 1, T(0), allocator),
+        primes_(allocator) {
+    sieve_internal::check_euler_sieve_overflow(num_limit_);
+    sieve_internal::euler_sieve(std::span<T>(min_prime_factor_), primes_);
   }
 
+  // Constructs the sieve with the threads of |pool|.
+  //
+  // The result is identical to the single-threaded constructor. The table is
+  // left uninitialized by the calling thread and cleared block by block by
+  // the sieving threads, so with a fresh mapping, such as a large
+  // PageAllocator allocation with NumaPolicy::kDefault, each block is placed
+  // on the NUMA node of the thread that sieves it.
+  //
+  // |allocator| is only used on the calling thread, so it does not need to be
+  // thread-safe. The primes of each block are collected in temporary vectors
+  // with the default allocator.
+  EulerSieve(const T &num_limit,
+             ThreadPool &pool,
+             const Allocator &allocator = Allocator())
+      : EulerSieve(num_limit, 0, pool, allocator) {}
+
+  // Constructs the sieve in |num_blocks| parallel blocks on the global
+  // ThreadPool, which runs them on all of its threads. If |num_blocks| is zero,
+  // one block per thread of the pool is used.
+  EulerSieve(const T &num_limit,
+             size_t num_blocks,
+             const Allocator &allocator = Allocator())
+      : EulerSieve(num_limit, num_blocks, ThreadPool::global(), allocator) {}
+
   EulerSieve(const EulerSieve &other) = default;
   EulerSieve(EulerSieve &&other) = default;
   EulerSieve &operator=(const EulerSieve &other) = default;
@@ -112,47 +554,69 @@ class EulerSieve {
   const T &get_limit() const { return num_limit_; }
 
   // Returns the list of primes.
-  const std::vector<T> &primes() const { return primes_; }
+  const std::vector<T, Allocator> &primes() const { return primes_; }
 
   // Returns the minimum prime factor of the |number|.
   // Throws domain_error exception if minimum prime factor does not exist.
   T min_prime_factor(const T &number) const {
-    auto abs_num = unsigned_abs(number);
-    if (abs_num <= 1)
-      throw std::domain_error("Minimum prime factor does not exist.");
-    if (abs_num > static_cast<std::make_unsigned_t<T>>(num_limit_))
-      throw std::out_of_range("The number exceeds the limit of Sieve.");
-    return min_prime_factor_[abs_num];
+    return view().min_prime_factor(number);
+  }
+
+  // Batched version of min_prime_factor.
+  // See FactorTableView::min_prime_factor_many.
+  void min_prime_factor_many(std::span<const T> numbers,
+                             std::span<T> results) const {
+    view().min_prime_factor_many(numbers, results);
+  }
+
+  // Returns the view of the tables.
+  FactorTableView<T> view() const {
+    return FactorTableView<T>(min_prime_factor_, primes_, num_limit_,
+                              typename FactorTableView<T>::Unchecked());
   }
 
  private:
   // The maximum number (inclusive) we can hold.
   T num_limit_;
   // Minimum prime factors.
-  std::vector<T> min_prime_factor_;
+  std::vector<T, sieve_internal::DefaultInitAllocator<Allocator>>
+      min_prime_factor_;
   // Prime numbers.
-  std::vector<T> primes_;
-
-  // Numbers are converted to MultType during multiplication to avoid overflow.
-  // uint64_t is large enough due to the time and space complexity of the sieve
-  // algorithm.
-  using MultType = uint64_t;
-
-  // Throws overflow_error exception if multiplication will overflow.
-  void check_overflow() {
-    size_t num_limit_width =
-        std::bit_width(static_cast<std::make_unsigned_t<T>>(num_limit_));
-    if (num_limit_width * 2 > std::numeric_limits<MultType>::digits)
-      throw std::overflow_error(
-          "Multiplication will overflow when sieving. "
-          "Please use larger integer types.");
+  std::vector<T, Allocator> primes_;
+
+  EulerSieve(const T &num_limit,
+             size_t num_blocks,
+             ThreadPool &pool,
+             const Allocator &allocator)
+      : num_limit_(num_limit),
+        min_prime_factor_(numeric_cast<size_t>(num_limit) + 1, allocator),
+        primes_(allocator) {
+    sieve_internal::check_euler_sieve_overflow(num_limit_);
+    sieve_internal::parallel_euler_sieve(std::span<T>(min_prime_factor_),
+                                         num_blocks, pool, primes_);
   }
 };
 
+namespace pmr {
+
+// Sieves with polymorphic allocators, which allocate the tables in a
+// std::pmr::memory_resource, for example a request-scoped arena.
+template <typename T>
+using Sieve = number_theory::Sieve<T, std::pmr::polymorphic_allocator<T>>;
+template <typename T>
+using EulerSieve =
+    number_theory::EulerSieve<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
+
 }  // namespace number_theory
 
+namespace pmr = number_theory::pmr;
+
 using number_theory::EulerSieve;
+using number_theory::FactorTableView;
 using number_theory::Sieve;
+using number_theory::SieveView;
 
 }  // namespace tql
 
@@ -1,13 +1,19 @@
 #include <stdint.h>
 
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <unordered_set>
 #include <vector>
 
 #include <gtest/gtest.h>
 
+#include "number_theory/memory.h"
 #include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
 
 namespace tql::number_theory {
 
@@ -83,4 +89,231 @@ TEST(EulerSieveTest, MinPrimeFactor) {
   test_min_prime_factor<uint64_t>();
 }
 
+template <typename T>
+void test_parallel_euler_sieve(const T &num_limit) {
+  EulerSieve<T> expected(num_limit);
+  for (size_t num_blocks : {1, 2, 3, 8}) {
+    EulerSieve<T> sieve(num_limit, num_blocks);
+    EXPECT_EQ(sieve.get_limit(), num_limit);
+    EXPECT_EQ(sieve.primes(), expected.primes());
+    for (T i = 2; i < num_limit; ++i)
+      ASSERT_EQ(sieve.min_prime_factor(i), expected.min_prime_factor(i));
+    ASSERT_EQ(sieve.min_prime_factor(num_limit),
+              expected.min_prime_factor(num_limit));
+  }
+}
+
+TEST(EulerSieveTest, MultiThreaded) {
+  test_parallel_euler_sieve<int8_t>(120);
+  test_parallel_euler_sieve<int16_t>(30000);
+  test_parallel_euler_sieve<int32_t>(300000);
+  test_parallel_euler_sieve<int64_t>(300007);
+  test_parallel_euler_sieve<uint8_t>(250);
+  test_parallel_euler_sieve<uint16_t>(65000);
+  test_parallel_euler_sieve<uint32_t>(65536);
+  test_parallel_euler_sieve<uint64_t>(2);
+  EXPECT_TRUE(EulerSieve<uint64_t>(1, 4).primes().empty());
+
+  // One block per thread of the global pool is used by default.
+  EXPECT_EQ(EulerSieve<int>(1000, 0).primes(), EulerSieve<int>(1000).primes());
+
+  ThreadPool pool(3);
+  EulerSieve<int> sieve(300000, pool);
+  EXPECT_EQ(sieve.primes(), EulerSieve<int>(300000).primes());
+}
+
+TEST(SieveTest, Allocator) {
+  PageAllocator<int> allocator({.huge_pages = HugePages::kTransparent});
+  Sieve sieve(1 << 23, allocator);
+  Sieve expected(1 << 23);
+  for (int i = 0; i <= (1 << 23); i += 101)
+    ASSERT_EQ(sieve.is_prime(i), expected.is_prime(i));
+}
+
+TEST(EulerSieveTest, Allocator) {
+  PageAllocator<int> allocator(
+      {.huge_pages = HugePages::k2MB, .numa = NumaPolicy::kInterleave});
+  EulerSieve<int> expected(1 << 20);
+  for (size_t num_blocks : {1, 4}) {
+    EulerSieve sieve(1 << 20, num_blocks, allocator);
+    EXPECT_TRUE(std::equal(sieve.primes().begin(), sieve.primes().end(),
+                           expected.primes().begin(), expected.primes().end()));
+    for (int i = 2; i <= (1 << 20); i += 7)
+      ASSERT_EQ(sieve.min_prime_factor(i), expected.min_prime_factor(i));
+  }
+  EulerSieve sieve(1 << 20, allocator);
+  EXPECT_TRUE(std::equal(sieve.primes().begin(), sieve.primes().end(),
+                         expected.primes().begin(), expected.primes().end()));
+}
+
+TEST(SieveTest, MemoryResource) {
+  std::pmr::monotonic_buffer_resource arena;
+  pmr::Sieve<int> sieve(1000, &arena);
+  Sieve<int> expected(1000);
+  for (int i = 0; i <= 1000; ++i)
+    EXPECT_EQ(sieve.is_prime(i), expected.is_prime(i));
+}
+
+TEST(EulerSieveTest, MemoryResource) {
+  std::pmr::monotonic_buffer_resource arena;
+  EulerSieve<int> expected(1000);
+  for (pmr::EulerSieve<int> sieve :
+       {pmr::EulerSieve<int>(1000, &arena),
+        pmr::EulerSieve<int>(1000, 2, &arena)}) {
+    EXPECT_TRUE(std::equal(sieve.primes().begin(), sieve.primes().end(),
+                           expected.primes().begin(), expected.primes().end()));
+    for (int i = 2; i <= 1000; ++i)
+      EXPECT_EQ(sieve.min_prime_factor(i), expected.min_prime_factor(i));
+  }
+
+  // The multi-threaded constructor leaves the table uninitialized, so the
+  // sieve must clear memory which has been used before.
+  std::vector<char> buffer(1 << 16, '\xff');
+  std::pmr::monotonic_buffer_resource dirty(buffer.data(), buffer.size());
+  pmr::EulerSieve<int> sieve(1000, 2, &dirty);
+  for (int i = 2; i <= 1000; ++i)
+    EXPECT_EQ(sieve.min_prime_factor(i), expected.min_prime_factor(i));
+}
+
+TEST(SieveViewTest, FromSieve) {
+  Sieve<int> sieve(1000);
+  SieveView<int> view = sieve;
+  EXPECT_EQ(view.get_limit(), 1000);
+  for (int i = -5; i <= 1000; ++i)
+    EXPECT_EQ(view.is_prime(i), sieve.is_prime(i));
+  EXPECT_THROW(view.is_prime(1001), std::out_of_range);
+
+  SieveView<int> prefix = view.prefix(100);
+  EXPECT_EQ(prefix.get_limit(), 100);
+  EXPECT_TRUE(prefix.is_prime(97));
+  EXPECT_THROW(prefix.is_prime(101), std::out_of_range);
+  EXPECT_THROW(view.prefix(1001), std::out_of_range);
+}
+
+TEST(SieveViewTest, FromBuffer) {
+  // Primes under 64.
+  const uint64_t bits[] = {0x28208a20a08a28ac};
+  SieveView<uint32_t> view(63, bits);
+  Sieve<uint32_t> sieve(63);
+  for (uint32_t i = 0; i <= 63; ++i)
+    EXPECT_EQ(view.is_prime(i), sieve.is_prime(i));
+  EXPECT_THROW(SieveView<uint32_t>(64, bits), std::invalid_argument);
+}
+
+template <typename T>
+void test_factor_table_view() {
+  EulerSieve<T> sieve(100);
+  FactorTableView<T> view = sieve;
+  EXPECT_EQ(view.get_limit(), 100);
+  EXPECT_TRUE(std::equal(view.primes().begin(), view.primes().end(),
+                         sieve.primes().begin(), sieve.primes().end()));
+  for (T i = 2; i <= 100; ++i)
+    EXPECT_EQ(view.min_prime_factor(i), sieve.min_prime_factor(i));
+  EXPECT_THROW(view.min_prime_factor(1), std::domain_error);
+  EXPECT_THROW(view.min_prime_factor(101), std::out_of_range);
+
+  FactorTableView<T> prefix = view.prefix(50);
+  EXPECT_EQ(prefix.get_limit(), 50);
+  EXPECT_EQ(prefix.primes().size(), 15u);
+  EXPECT_EQ(prefix.primes().back(), 47);
+  EXPECT_EQ(prefix.min_prime_factor(49), 7);
+  EXPECT_THROW(prefix.min_prime_factor(51), std::out_of_range);
+  EXPECT_THROW(view.prefix(101), std::out_of_range);
+}
+
+TEST(FactorTableViewTest, FromEulerSieve) {
+  test_factor_table_view<int8_t>();
+  test_factor_table_view<int16_t>();
+  test_factor_table_view<int32_t>();
+  test_factor_table_view<int64_t>();
+  test_factor_table_view<uint8_t>();
+  test_factor_table_view<uint16_t>();
+  test_factor_table_view<uint32_t>();
+  test_factor_table_view<uint64_t>();
+}
+
+TEST(FactorTableViewTest, FromBuffer) {
+  const int min_prime_factor[] = {0, 0, 2, 3, 2, 5, 2, 7, 2, 3, 2};
+  const int primes[] = {2, 3, 5, 7};
+  FactorTableView<int> view(min_prime_factor, primes);
+  EXPECT_EQ(view.get_limit(), 10);
+  EXPECT_EQ(view.min_prime_factor(-9), 3);
+  EXPECT_EQ(view.primes().size(), 4u);
+  EXPECT_THROW(FactorTableView<int>({}, {}), std::invalid_argument);
+}
+
+template <typename T>
+void test_is_prime_many() {
+  Sieve<T> sieve(100);
+  std::vector<T> numbers;
+  for (T i = 0; i <= 100; ++i)
+    numbers.push_back(static_cast<T>((i * 37) % 101));
+  if (std::numeric_limits<T>::is_signed)
+    numbers.push_back(-7);
+  std::unique_ptr<bool[]> results(new bool[numbers.size()]);
+  sieve.is_prime_many(numbers, {results.get(), numbers.size()});
+  for (size_t i = 0; i < numbers.size(); ++i)
+    EXPECT_EQ(results[i], sieve.is_prime(numbers[i]));
+
+  // Nothing is written if the batch is invalid.
+  std::fill_n(results.get(), numbers.size(), true);
+  numbers.back() = 101;
+  EXPECT_THROW(sieve.is_prime_many(numbers, {results.get(), numbers.size()}),
+               std::out_of_range);
+  EXPECT_TRUE(std::all_of(results.get(), results.get() + numbers.size(),
+                          [](bool result) { return result; }));
+  EXPECT_THROW(sieve.is_prime_many(numbers, {results.get(), 1}),
+               std::invalid_argument);
+}
+
+TEST(SieveTest, IsPrimeMany) {
+  test_is_prime_many<int8_t>();
+  test_is_prime_many<int16_t>();
+  test_is_prime_many<int32_t>();
+  test_is_prime_many<int64_t>();
+  test_is_prime_many<uint8_t>();
+  test_is_prime_many<uint16_t>();
+  test_is_prime_many<uint32_t>();
+  test_is_prime_many<uint64_t>();
+}
+
+template <typename T>
+void test_min_prime_factor_many() {
+  EulerSieve<T> sieve(100);
+  std::vector<T> numbers;
+  for (T i = 2; i <= 100; ++i)
+    numbers.push_back(static_cast<T>((i * 37) % 99 + 2));
+  if (std::numeric_limits<T>::is_signed)
+    numbers.push_back(-15);
+  std::vector<T> results(numbers.size());
+  sieve.min_prime_factor_many(numbers, results);
+  for (size_t i = 0; i < numbers.size(); ++i)
+    EXPECT_EQ(results[i], sieve.min_prime_factor(numbers[i]));
+
+  // Nothing is written if the batch is invalid.
+  std::vector<T> zeros(numbers.size());
+  results = zeros;
+  numbers.back() = 1;
+  EXPECT_THROW(sieve.min_prime_factor_many(numbers, results),
+               std::domain_error);
+  numbers.back() = 101;
+  EXPECT_THROW(sieve.min_prime_factor_many(numbers, results),
+               std::out_of_range);
+  EXPECT_EQ(results, zeros);
+  EXPECT_THROW(
+      sieve.min_prime_factor_many(numbers, std::span<T>(results).first(1)),
+      std::invalid_argument);
+}
+
+TEST(EulerSieveTest, MinPrimeFactorMany) {
+  test_min_prime_factor_many<int8_t>();
+  test_min_prime_factor_many<int16_t>();
+  test_min_prime_factor_many<int32_t>();
+  test_min_prime_factor_many<int64_t>();
+  test_min_prime_factor_many<uint8_t>();
+  test_min_prime_factor_many<uint16_t>();
+  test_min_prime_factor_many<uint32_t>();
+  test_min_prime_factor_many<uint64_t>();
+}
+
 }  // namespace tql::number_theory
@@ -0,0 +1,676 @@
+#ifndef NUMBER_THEORY_SIQS_H_
+#define NUMBER_THEORY_SIQS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "number_theory/modular.h"
+#include "number_theory/sieve.h"
+#include "number_theory/thread_pool.h"
+#include "number_theory/wide_integer.h"
+
+// The self-initializing quadratic sieve (SIQS) for integers of up to 240 bits.
+
+namespace tql {
+namespace number_theory {
+
+namespace siqs_internal {
+
+using Integer = UInt256;
+
+// The sieve interval is processed in blocks of this many bytes, which fit in
+// the L1 data cache.
+inline constexpr uint32_t kBlockSize = 32768;
+// Primes below this are not sieved, because they hit most bytes of a block
+// but add little. The threshold is lowered to make up for them.
+inline constexpr uint32_t kMinSievePrime = 30;
+// The number of relations collected beyond the size of the factor base. Each
+// extra relation gives about one more dependency.
+inline constexpr size_t kExtraRelations = 64;
+// The number of times more relations are collected if all dependencies fail.
+inline constexpr int kMaxAttempts = 4;
+// The largest input, in bits.
+inline constexpr size_t kMaxBits = 240;
+
+// The size of the factor base, the half width M of the sieve interval
+// [-M, M), and the bound of the large prime as a multiple of the largest
+// prime of the factor base, by the size of k n in bits. They follow the
+// tables of msieve.
+struct Parameters {
+  size_t bits;
+  size_t num_primes;
+  uint32_t radius;
+  uint32_t large_prime_multiplier;
+};
+inline constexpr Parameters kParameters[] = {
+    {64, 100, kBlockSize, 40},       {128, 450, kBlockSize, 40},
+    {160, 1200, 2 * kBlockSize, 40}, {183, 2000, 2 * kBlockSize, 40},
+    {200, 3000, 3 * kBlockSize, 50}, {212, 5400, 4 * kBlockSize, 50},
+    {233, 10000, 6 * kBlockSize, 100}, {250, 20000, 6 * kBlockSize, 100},
+};
+
+// Returns the parameters for |bits|, interpolating the size of the factor
+// base between the rows of kParameters.
+inline Parameters parameters(size_t bits) {
+  const Parameters *high = std::find_if(
+      std::begin(kParameters), std::end(kParameters),
+      [bits](const Parameters &row) { return row.bits >= bits; });
+  if (high == std::begin(kParameters))
+    return *high;
+  const Parameters *low = high - 1;
+  Parameters result = *high;
+  result.num_primes = low->num_primes + (high->num_primes - low->num_primes) *
+                                            (bits - low->bits) /
+                                            (high->bits - low->bits);
+  return result;
+}
+
+// Returns log2(|x|) for a number of up to 256 bits.
+inline double log2(const Integer &x) {
+  size_t width = x.bit_width();
+  size_t shift = width > 64 ? width - 64 : 0;
+  return std::log2(static_cast<double>(static_cast<uint64_t>(x >> shift))) +
+         static_cast<double>(shift);
+}
+
+// Returns the square-free multiplier k <= 43 which makes k |n| richest in
+// small quadratic residues, with the Knuth-Schroeppel function.
+inline uint32_t choose_multiplier(const Integer &n) {
+  constexpr uint32_t kMultipliers[] = {1,  3,  5,  7,  11, 13, 15, 17, 19, 21,
+                                       23, 29, 31, 33, 35, 37, 39, 41, 43};
+  constexpr uint32_t kPrimes[] = {3,  5,  7,  11, 13, 17, 19, 23, 29, 31,
+                                  37, 41, 43, 47, 53, 59, 61, 67, 71, 73};
+  uint32_t best = 1;
+  double best_score = -std::numeric_limits<double>::infinity();
+  for (uint32_t k : kMultipliers) {
+    uint64_t kn8 = n.mod_small(8) * k % 8;
+    double score = -0.5 * std::log(k);
+    if (kn8 == 1)
+      score += 2 * std::log(2.0);
+    else if (kn8 == 5)
+      score += std::log(2.0);
+    else
+      score += 0.5 * std::log(2.0);
+    for (uint32_t p : kPrimes) {
+      uint64_t kn = n.mod_small(p) * k % p;
+      if (kn == 0)
+        score += std::log(p) / p;
+      else if (modular_internal::pow_u64(kn, (p - 1) / 2, p) == 1)
+        score += 2 * std::log(p) / (p - 1);
+    }
+    if (score > best_score) {
+      best_score = score;
+      best = k;
+    }
+  }
+  return best;
+}
+
+// The primes p modulo which k n is a square, with the roots t of t^2 = k n
+// (mod p). The primes 2 and the divisors of k are included with root 0, and
+// found by trial division instead of sieving. Column 0 of the relations is
+// the sign, and column 1 + i is primes[i].
+struct FactorBase {
+  std::vector<uint32_t> primes;
+  std::vector<uint32_t> roots;
+  std::vector<uint8_t> logs;
+};
+
+inline FactorBase make_factor_base(const Integer &kn, size_t size) {
+  FactorBase base;
+  for (uint64_t limit = 4096; base.primes.size() < size; limit *= 2) {
+    base = FactorBase();
+    Sieve<uint32_t> sieve(static_cast<uint32_t>(limit));
+    for (uint32_t p = 2; p <= limit && base.primes.size() < size; ++p) {
+      if (!sieve.is_prime(p))
+        continue;
+      uint64_t residue = kn.mod_small(p);
+      uint32_t root = 0;
+      if (p != 2 && residue != 0) {
+        if (modular_internal::pow_u64(residue, (p - 1) / 2, p) != 1)
+          continue;
+        root = static_cast<uint32_t>(sqrt_mod(residue, uint64_t(p)));
+      }
+      base.primes.push_back(p);
+      base.roots.push_back(root);
+      base.logs.push_back(static_cast<uint8_t>(std::lround(std::log2(p))));
+    }
+  }
+  return base;
+}
+
+// A relation y^2 = (-1)^e0 p_1^e1 ... p_k^ek (large_prime)^2 (mod n), where
+// |factors| lists the columns of the primes with multiplicity. The large
+// prime is 1 for a full relation, and the shared large prime of two partial
+// relations combined into one.
+struct Relation {
+  Integer y;
+  std::vector<uint32_t> factors;
+  uint64_t large_prime = 1;
+};
+
+// The state shared by the threads collecting relations.
+struct Context {
+  Integer n;
+  Integer kn;
+  Parameters parameters;
+  FactorBase base;
+  // The sieve values start at 128 minus this, so that a byte of a candidate
+  // has its top bit set.
+  uint8_t threshold;
+  uint64_t large_prime_bound;
+  // Factors of A are drawn around this size.
+  uint32_t a_prime_size;
+
+  std::mutex mutex;
+  std::vector<Relation> relations;
+  // The first partial relation of each large prime.
+  std::unordered_map<uint64_t, Relation> partials;
+  std::atomic<size_t> num_relations{0};
+  std::atomic<size_t> num_needed{0};
+
+  size_t num_columns() const { return base.primes.size() + 1; }
+
+  // Adds a relation with the large prime |large_prime|, which is 1 for a
+  // full relation.
+  void add(Relation relation, uint64_t large_prime) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (large_prime != 1) {
+      auto [it, inserted] = partials.try_emplace(large_prime, relation);
+      if (inserted)
+        return;
+      // Two partial relations with the same large prime multiply into a full
+      // one with the large prime squared.
+      relation.y = multiply_mod(relation.y, it->second.y, n);
+      relation.factors.insert(relation.factors.end(),
+                              it->second.factors.begin(),
+                              it->second.factors.end());
+      relation.large_prime = large_prime;
+    }
+    relations.push_back(std::move(relation));
+    num_relations.store(relations.size(), std::memory_order_relaxed);
+  }
+
+  bool done() const {
+    return num_relations.load(std::memory_order_relaxed) >=
+           num_needed.load(std::memory_order_relaxed);
+  }
+};
+
+// Returns whether the two's complement Integer |x| is negative.
+inline bool is_negative(const Integer &x) { return x.bit(Integer::kBits - 1); }
+
+// Collects relations from the polynomials (A x + B)^2 - k n = A g(x) of one
+// A = q_1 ... q_s, which is chosen at random from |seed|. The 2^(s - 1)
+// choices of B = +-B_1 +- ... +- B_s with B^2 = k n (mod A) are visited in
+// Gray code order, so the roots of each prime move by one precomputed
+// addition per polynomial. Stops early once enough relations are collected.
+inline void sieve_family(Context &context, uint64_t seed) {
+  const FactorBase &base = context.base;
+  const size_t num_primes = base.primes.size();
+  const uint32_t radius = context.parameters.radius;
+  std::mt19937_64 engine(seed);
+
+  // Choose A close to sqrt(2 k n) / M, so that |g(x)| is about
+  // M sqrt(k n / 2) over the interval.
+  double log_target = (log2(context.kn) + 1) / 2 - std::log2(radius);
+  std::vector<size_t> pool;
+  for (size_t i = 0; i < num_primes; ++i) {
+    uint32_t p = base.primes[i];
+    if (base.roots[i] != 0 && p >= context.a_prime_size / 2 &&
+        p <= context.a_prime_size * 2) {
+      pool.push_back(i);
+    }
+  }
+  if (pool.size() < 4)
+    return;
+  size_t num_a_primes = std::clamp<size_t>(
+      std::lround(log_target / std::log2(context.a_prime_size)), 1,
+      std::min<size_t>(pool.size() / 2, 16));
+  std::vector<size_t> a_indices;
+  double log_a = 0;
+  while (a_indices.size() + 1 < num_a_primes) {
+    size_t i = pool[engine() % pool.size()];
+    if (std::find(a_indices.begin(), a_indices.end(), i) != a_indices.end())
+      continue;
+    a_indices.push_back(i);
+    log_a += std::log2(base.primes[i]);
+  }
+  // The last prime brings A closest to the target.
+  size_t last = num_primes;
+  double best_error = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < num_primes; ++i) {
+    if (base.roots[i] == 0 || base.primes[i] < kMinSievePrime ||
+        std::find(a_indices.begin(), a_indices.end(), i) != a_indices.end()) {
+      continue;
+    }
+    double error = std::abs(log_a + std::log2(base.primes[i]) - log_target);
+    if (error < best_error) {
+      best_error = error;
+      last = i;
+    }
+  }
+  if (last == num_primes)
+    return;
+  a_indices.push_back(last);
+  const size_t s = a_indices.size();
+
+  Integer a = 1;
+  for (size_t i : a_indices)
+    a *= base.primes[i];
+  // B_l = (A / q_l) gamma_l, with gamma_l = t_l (A / q_l)^-1 (mod q_l).
+  std::vector<Integer> b_terms(s);
+  Integer b = 0;
+  for (size_t l = 0; l < s; ++l) {
+    uint64_t q = base.primes[a_indices[l]];
+    Integer cofactor = a / q;
+    uint64_t inverse =
+        modular_internal::pow_u64(cofactor.mod_small(q), q - 2, q);
+    uint64_t gamma = modular_internal::multiply_u64(base.roots[a_indices[l]],
+                                                    inverse, q);
+    gamma = std::min(gamma, q - gamma);
+    b_terms[l] = cofactor * gamma;
+    b += b_terms[l];
+  }
+
+  // For each prime p not dividing A: the roots of g(x) = 0 (mod p) as
+  // offsets into the interval [-M, M), and 2 B_l A^-1 (mod p).
+  std::vector<uint8_t> in_a(num_primes);
+  for (size_t i : a_indices)
+    in_a[i] = true;
+  std::vector<uint32_t> root1(num_primes), root2(num_primes);
+  std::vector<uint32_t> deltas(s * num_primes);
+  std::vector<size_t> sieve_primes, trial_primes;
+  for (size_t i = 0; i < num_primes; ++i) {
+    uint64_t p = base.primes[i];
+    if (base.roots[i] == 0 || in_a[i]) {
+      trial_primes.push_back(i);
+      continue;
+    }
+    uint64_t a_inverse = modular_internal::pow_u64(a.mod_small(p), p - 2, p);
+    for (size_t l = 0; l < s; ++l) {
+      deltas[l * num_primes + i] = static_cast<uint32_t>(
+          modular_internal::multiply_u64(2 * b_terms[l].mod_small(p),
+                                         a_inverse, p));
+    }
+    uint64_t b_mod = b.mod_small(p);
+    uint64_t shift = radius % p;
+    uint64_t t = base.roots[i];
+    root1[i] = static_cast<uint32_t>(
+        (modular_internal::multiply_u64(a_inverse, t + p - b_mod, p) + shift) %
+        p);
+    root2[i] = static_cast<uint32_t>(
+        (modular_internal::multiply_u64(a_inverse, 2 * p - t - b_mod, p) +
+         shift) %
+        p);
+    if (p >= kMinSievePrime)
+      sieve_primes.push_back(i);
+  }
+  std::vector<int> signs(s, 1);
+
+  std::vector<uint8_t> sieve(kBlockSize);
+  const uint8_t initial = static_cast<uint8_t>(128 - context.threshold);
+  for (uint64_t poly = 0; poly < (uint64_t(1) << (s - 1)); ++poly) {
+    if (context.done())
+      return;
+    if (poly != 0) {
+      // Flip the sign of B_v, the term of the Gray code bit which changes.
+      size_t v = std::countr_zero(poly) + 1;
+      Integer twice_b_v = b_terms[v] << 1;
+      if (signs[v] > 0)
+        b -= twice_b_v;
+      else
+        b += twice_b_v;
+      const uint32_t *delta = &deltas[v * num_primes];
+      for (size_t i = 0; i < num_primes; ++i) {
+        if (base.roots[i] == 0 || in_a[i])
+          continue;
+        uint32_t p = base.primes[i];
+        uint32_t d = signs[v] > 0 ? delta[i] : p - delta[i];
+        root1[i] = root1[i] + d >= p ? root1[i] + d - p : root1[i] + d;
+        root2[i] = root2[i] + d >= p ? root2[i] + d - p : root2[i] + d;
+      }
+      signs[v] = -signs[v];
+    }
+    // g(x) = A x^2 + 2 B x + C with C = (B^2 - k n) / A < 0.
+    Integer negative_c = (context.kn - b * b) / a;
+
+    for (uint32_t block = 0; block < 2 * radius; block += kBlockSize) {
+      std::fill(sieve.begin(), sieve.end(), initial);
+      for (size_t i : sieve_primes) {
+        uint32_t p = base.primes[i];
+        uint32_t offset = block % p;
+        uint8_t log = base.logs[i];
+        for (uint32_t root : {root1[i], root2[i]}) {
+          uint32_t j = root >= offset ? root - offset : root + p - offset;
+          for (; j < kBlockSize; j += p)
+            sieve[j] += log;
+        }
+      }
+
+      for (uint32_t j = 0; j < kBlockSize; j += 8) {
+        uint64_t word;
+        std::copy_n(&sieve[j], 8, reinterpret_cast<uint8_t *>(&word));
+        if ((word & 0x8080808080808080) == 0)
+          continue;
+        for (uint32_t k = j; k < j + 8; ++k) {
+          if ((sieve[k] & 0x80) == 0)
+            continue;
+          uint32_t index = block + k;
+          Integer x = static_cast<int64_t>(index) - radius;
+          Integer g = a * x * x + (b << 1) * x - negative_c;
+          Relation relation;
+          if (is_negative(g)) {
+            relation.factors.push_back(0);
+            g = Integer() - g;
+          }
+          for (size_t i : a_indices)
+            relation.factors.push_back(static_cast<uint32_t>(i + 1));
+          for (size_t i : trial_primes) {
+            uint32_t p = base.primes[i];
+            while (g.mod_small(p) == 0) {
+              g.divide_small(p);
+              relation.factors.push_back(static_cast<uint32_t>(i + 1));
+            }
+          }
+          for (size_t i = 0; i < num_primes; ++i) {
+            if (base.roots[i] == 0 || in_a[i])
+              continue;
+            uint32_t p = base.primes[i];
+            uint32_t r = index % p;
+            if (r != root1[i] && r != root2[i])
+              continue;
+            while (g.mod_small(p) == 0) {
+              g.divide_small(p);
+              relation.factors.push_back(static_cast<uint32_t>(i + 1));
+            }
+          }
+          if (g.bit_width() > 64 ||
+              static_cast<uint64_t>(g) >= context.large_prime_bound) {
+            continue;
+          }
+          Integer y = a * x + b;
+          if (is_negative(y))
+            y = Integer() - y;
+          relation.y = y % context.n;
+          context.add(std::move(relation), static_cast<uint64_t>(g));
+        }
+      }
+    }
+  }
+}
+
+// Returns up to 64 subsets of |relations| whose products are squares, with
+// Gaussian elimination over GF(2).
+//
+// The relations are sparse, so the relations containing a prime which no
+// other relation contains are removed first, repeatedly. The remaining matrix
+// is eliminated densely, 64 columns per word.
+inline std::vector<std::vector<size_t>> find_dependencies(
+    const std::vector<Relation> &relations,
+    size_t num_columns) {
+  // The columns with an odd exponent in each relation.
+  std::vector<std::vector<uint32_t>> odd(relations.size());
+  for (size_t r = 0; r < relations.size(); ++r) {
+    std::vector<uint32_t> factors = relations[r].factors;
+    std::sort(factors.begin(), factors.end());
+    for (size_t i = 0; i < factors.size();) {
+      size_t j = i;
+      while (j < factors.size() && factors[j] == factors[i])
+        ++j;
+      if ((j - i) % 2 != 0)
+        odd[r].push_back(factors[i]);
+      i = j;
+    }
+  }
+
+  std::vector<uint8_t> active(relations.size(), true);
+  std::vector<size_t> counts(num_columns);
+  while (true) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (size_t r = 0; r < relations.size(); ++r) {
+      if (active[r]) {
+        for (uint32_t c : odd[r])
+          ++counts[c];
+      }
+    }
+    bool removed = false;
+    auto singleton = [&counts](uint32_t c) { return counts[c] == 1; };
+    for (size_t r = 0; r < relations.size(); ++r) {
+      if (active[r] && std::any_of(odd[r].begin(), odd[r].end(), singleton)) {
+        active[r] = false;
+        removed = true;
+      }
+    }
+    if (!removed)
+      break;
+  }
+
+  std::vector<uint32_t> column_index(num_columns);
+  size_t num_used_columns = 0;
+  for (size_t c = 0; c < num_columns; ++c) {
+    if (counts[c] != 0)
+      column_index[c] = static_cast<uint32_t>(num_used_columns++);
+  }
+  std::vector<size_t> rows;
+  for (size_t r = 0; r < relations.size(); ++r) {
+    if (active[r])
+      rows.push_back(r);
+  }
+  // Each row holds the matrix bits, followed by the bits of the relations it
+  // is the sum of.
+  const size_t matrix_words = (num_used_columns + 63) / 64;
+  const size_t words = matrix_words + (rows.size() + 63) / 64;
+  std::vector<uint64_t> bits(rows.size() * words);
+  auto row = [&bits, words](size_t r) { return &bits[r * words]; };
+  for (size_t r = 0; r < rows.size(); ++r) {
+    for (uint32_t c : odd[rows[r]]) {
+      uint32_t i = column_index[c];
+      row(r)[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    row(r)[matrix_words + r / 64] |= uint64_t(1) << (r % 64);
+  }
+
+  size_t num_pivots = 0;
+  for (size_t c = 0; c < num_used_columns; ++c) {
+    size_t word = c / 64;
+    uint64_t mask = uint64_t(1) << (c % 64);
+    size_t pivot = num_pivots;
+    while (pivot < rows.size() && (row(pivot)[word] & mask) == 0)
+      ++pivot;
+    if (pivot == rows.size())
+      continue;
+    std::swap_ranges(row(pivot), row(pivot) + words, row(num_pivots));
+    for (size_t r = num_pivots + 1; r < rows.size(); ++r) {
+      if ((row(r)[word] & mask) != 0) {
+        for (size_t w = word; w < words; ++w)
+          row(r)[w] ^= row(num_pivots)[w];
+      }
+    }
+    ++num_pivots;
+  }
+
+  std::vector<std::vector<size_t>> dependencies;
+  for (size_t r = num_pivots; r < rows.size() && dependencies.size() < 64;
+       ++r) {
+    std::vector<size_t> dependency;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if ((row(r)[matrix_words + i / 64] >> (i % 64)) & 1)
+        dependency.push_back(rows[i]);
+    }
+    dependencies.push_back(std::move(dependency));
+  }
+  return dependencies;
+}
+
+// Returns gcd(X - Y, n) for the congruence X^2 = Y^2 (mod n) of the
+// relations |dependency|.
+inline Integer combine(const Context &context,
+                       const std::vector<Relation> &relations,
+                       const std::vector<size_t> &dependency) {
+  const Integer &n = context.n;
+  std::vector<uint32_t> exponents(context.num_columns());
+  Integer x = 1, y = 1;
+  for (size_t r : dependency) {
+    x = multiply_mod(x, relations[r].y, n);
+    y = multiply_mod(y, Integer(relations[r].large_prime) % n, n);
+    for (uint32_t c : relations[r].factors)
+      ++exponents[c];
+  }
+  for (size_t c = 1; c < exponents.size(); ++c) {
+    Integer p = context.base.primes[c - 1];
+    for (uint32_t e = exponents[c] / 2; e != 0; e /= 2) {
+      if (e % 2 != 0)
+        y = multiply_mod(y, p, n);
+      p = multiply_mod(p, p, n);
+    }
+  }
+  return gcd(x >= y ? x - y : y - x, n);
+}
+
+// Returns the |k|-th root of |x| rounded down.
+inline Integer root(const Integer &x, size_t k) {
+  Integer low = 0, high = Integer(1) << (x.bit_width() + k - 1) / k;
+  // The invariant is low^k <= x < high^k.
+  while (high - low > 1) {
+    Integer middle = low + ((high - low) >> 1);
+    WideUnsigned<8> power = 1;
+    for (size_t i = 0; i < k && power <= WideUnsigned<8>(x); ++i)
+      power *= WideUnsigned<8>(middle);
+    if (power > WideUnsigned<8>(x))
+      high = middle;
+    else
+      low = middle;
+  }
+  return low;
+}
+
+// Collects relations with |pool|, or on this thread if |pool| is null, and
+// returns a factor of |n| > 2^40 which has no factor in its factor base.
+inline Integer find_factor(Context &context, ThreadPool *pool) {
+  uint64_t seed = 0;
+  context.num_needed = context.num_columns() + kExtraRelations;
+  for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+    while (!context.done()) {
+      if (pool == nullptr) {
+        sieve_family(context, seed++);
+        continue;
+      }
+      TaskGroup group(*pool);
+      for (size_t i = 0; i < pool->num_threads(); ++i) {
+        group.run([&context, family = seed++]() {
+          sieve_family(context, family);
+        });
+      }
+      group.wait();
+    }
+    for (const std::vector<size_t> &dependency :
+         find_dependencies(context.relations, context.num_columns())) {
+      Integer divisor = combine(context, context.relations, dependency);
+      if (divisor != 1 && divisor != context.n)
+        return divisor;
+    }
+    context.num_needed += kExtraRelations;
+  }
+  return context.n;
+}
+
+// Returns a non-trivial factor of |n|, or |n| itself if none is found.
+inline Integer find_factor(const Integer &n, ThreadPool *pool) {
+  if (n.bit_width() > kMaxBits)
+    throw std::out_of_range("SIQS only factorizes numbers below 2^240.");
+  if (n < 4)
+    throw std::domain_error("SIQS requires a number above 3.");
+  if (!n.bit(0))
+    return 2;
+  // Small numbers are split by trial division.
+  if (n.bit_width() <= 40) {
+    for (uint64_t d = 3; d * d <= static_cast<uint64_t>(n); d += 2) {
+      if (n.mod_small(d) == 0)
+        return d;
+    }
+    return n;
+  }
+
+  auto context = std::make_unique<Context>();
+  context->n = n;
+  uint32_t k = choose_multiplier(n);
+  context->kn = n * k;
+  context->parameters = parameters(context->kn.bit_width());
+  context->base =
+      make_factor_base(context->kn, context->parameters.num_primes);
+  const FactorBase &base = context->base;
+  for (uint32_t p : base.primes) {
+    if (n.mod_small(p) == 0 && n != p)
+      return p;
+  }
+  // A perfect power has only trivial congruences of squares. Its prime
+  // factors exceed the factor base, so its exponent is small.
+  uint32_t largest = base.primes.back();
+  for (size_t e = 2; e * std::bit_width(largest) <= n.bit_width() + e; ++e) {
+    Integer r = root(n, e);
+    Integer power = 1;
+    for (size_t i = 0; i < e; ++i)
+      power *= r;
+    if (power == n)
+      return r;
+  }
+
+  context->large_prime_bound =
+      uint64_t(largest) * context->parameters.large_prime_multiplier;
+  double log_max = std::log2(context->parameters.radius) +
+                   (log2(context->kn) - 1) / 2;
+  // The unsieved small primes contribute a few bits on average.
+  double threshold = log_max - std::log2(context->large_prime_bound) - 4;
+  context->threshold =
+      static_cast<uint8_t>(std::clamp<double>(std::lround(threshold), 1, 127));
+  context->a_prime_size =
+      std::min<uint32_t>(2000, base.primes[base.primes.size() * 3 / 4]);
+  return find_factor(*context, pool);
+}
+
+}  // namespace siqs_internal
+
+// Returns a non-trivial factor of the odd composite |n| below 2^240 with the
+// self-initializing quadratic sieve, or |n| itself if it fails, which
+// happens when |n| is prime. The expected time complexity is
+// exp((1 + o(1)) sqrt(log n log log n)), independent of the size of the
+// factors, so it beats ECM when the smallest factor is close to sqrt(|n|).
+//
+// The sieve interval is split into L1-sized blocks, which accumulate the
+// logarithms of the factor base primes. Each polynomial family
+// A = q_1 ... q_s gives 2^(s - 1) polynomials, which switch with one
+// addition per prime. Relations with one large prime are combined in pairs,
+// and the congruences of squares come from Gaussian elimination over GF(2).
+// Throws out_of_range exception if |n| has more than 240 bits, and
+// domain_error exception if |n| is below 4.
+inline UInt256 siqs_find_factor(const UInt256 &n) {
+  return siqs_internal::find_factor(n, nullptr);
+}
+
+// Parallel version of siqs_find_factor, which sieves one polynomial family
+// per thread of |pool|.
+inline UInt256 siqs_find_factor(const UInt256 &n, ThreadPool &pool) {
+  return siqs_internal::find_factor(n, &pool);
+}
+
+}  // namespace number_theory
+
+using number_theory::siqs_find_factor;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_SIQS_H_
@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/siqs.h"
+
+namespace tql::number_theory {
+
+TEST(SiqsTest, FactorBase) {
+  UInt256 n = UInt256::from_string("25641580987701818706287342813");
+  siqs_internal::FactorBase base = siqs_internal::make_factor_base(n, 100);
+  ASSERT_EQ(base.primes.size(), 100u);
+  EXPECT_EQ(base.primes[0], 2u);
+  for (size_t i = 1; i < base.primes.size(); ++i) {
+    uint64_t p = base.primes[i], t = base.roots[i];
+    EXPECT_EQ(t * t % p, n.mod_small(p));
+  }
+}
+
+TEST(SiqsTest, FindFactor) {
+  for (const char *p_digits : {"859933207772791", "1006624138111981302281"}) {
+    UInt256 p = UInt256::from_string(p_digits);
+    UInt256 q = UInt256::from_string("678171941591752719929");
+    UInt256 factor = siqs_find_factor(p * q);
+    EXPECT_TRUE(factor == p || factor == q);
+  }
+  // Perfect powers and factors in the factor base.
+  UInt256 p = UInt256::from_string("1036690365234311601074831239301");
+  EXPECT_EQ(siqs_find_factor(p * p), p);
+  EXPECT_EQ(siqs_find_factor(UInt256(1000003) * 1000003 * 1000003), 1000003);
+  EXPECT_EQ(siqs_find_factor(p * 3), 3);
+  EXPECT_EQ(siqs_find_factor(UInt256(1000003) * 999983), 999983);
+
+  EXPECT_THROW(siqs_find_factor(UInt256(1) << 241), std::out_of_range);
+  EXPECT_THROW(siqs_find_factor(UInt256(3)), std::domain_error);
+}
+
+TEST(SiqsTest, FindFactorParallel) {
+  ThreadPool pool(3);
+  UInt256 p = UInt256::from_string("1024487325579739033612879");
+  UInt256 q = UInt256::from_string("680754285707041792147019");
+  UInt256 factor = siqs_find_factor(p * q, pool);
+  EXPECT_TRUE(factor == p || factor == q);
+}
+
+}  // namespace tql::number_theory
@@ -0,0 +1,282 @@
+#ifndef NUMBER_THEORY_THREAD_POOL_H_
+#define NUMBER_THEORY_THREAD_POOL_H_
+
+#include <stddef.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A work-stealing thread pool for the parallel algorithms.
+
+namespace tql {
+namespace number_theory {
+
+class ThreadPool;
+
+namespace thread_pool_internal {
+
+// The pool and the index of the worker running on this thread, if any.
+inline thread_local const ThreadPool *current_pool = nullptr;
+inline thread_local size_t current_worker = 0;
+
+// A task queue. The owner pushes and pops at the back, and the other threads
+// steal from the front, so the owner works on the most recent (and smallest)
+// tasks while thieves take the oldest (and largest) ones.
+struct alignas(64) TaskQueue {
+  std::mutex mutex;
+  std::deque<std::function<void()>> tasks;
+};
+
+// Pins the calling thread to |cpu|. This is best effort: the thread keeps its
+// affinity if the CPU is not available.
+inline void set_affinity([[maybe_unused]] int cpu) {
+#if defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+}  // namespace thread_pool_internal
+
+// A pool of worker threads with one task queue per worker. Idle workers steal
+// tasks from the queues of the others.
+//
+// Tasks are submitted through a TaskGroup. A thread waiting for a TaskGroup
+// runs the tasks of the pool before it sleeps, so tasks can submit and wait
+// for nested tasks without starving the pool or creating more threads.
+//
+// The parallel algorithms of the library accept a ThreadPool and use the
+// global pool by default.
+class ThreadPool {
+ public:
+  // Constructs a pool of |num_threads| threads, counting the thread which
+  // waits for the tasks, so |num_threads| - 1 workers are started. If
+  // |num_threads| is zero, the number of hardware threads is used.
+  // If |cpus| is not empty, worker i is pinned to the CPU |cpus|[i % size].
+  explicit ThreadPool(size_t num_threads = 0, std::vector<int> cpus = {})
+      : num_threads_(num_threads != 0
+                         ? num_threads
+                         : std::max(1u, std::thread::hardware_concurrency())),
+        queues_(num_threads_) {
+    workers_.reserve(num_threads_ - 1);
+    for (size_t i = 0; i + 1 < num_threads_; ++i) {
+      std::optional<int> cpu;
+      if (!cpus.empty())
+        cpu = cpus[i % cpus.size()];
+      workers_.emplace_back([this, i, cpu]() { work(i, cpu); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Runs the remaining tasks and stops the workers.
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stopping_ = true;
+    }
+    sleep_condition_.notify_all();
+    for (std::thread &worker : workers_)
+      worker.join();
+  }
+
+  // Returns the global pool, which has one thread per hardware thread.
+  static ThreadPool &global() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  // Returns the number of threads, including the waiting thread.
+  size_t num_threads() const { return num_threads_; }
+
+  // Calls |function|(i) for each i in [|begin|, |end|) as separate tasks, and
+  // waits for them. Each call should be large enough to amortize a task.
+  // Rethrows the first exception thrown by |function|.
+  template <typename Function>
+  void parallel_for(size_t begin, size_t end, Function function);
+
+ private:
+  friend class TaskGroup;
+
+  size_t num_threads_;
+  // queues_[i] belongs to worker i, and the last queue receives the tasks
+  // submitted by the other threads.
+  std::vector<thread_pool_internal::TaskQueue> queues_;
+  std::vector<std::thread> workers_;
+  // The number of tasks in the queues.
+  std::atomic<size_t> num_queued_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_condition_;
+  bool stopping_ = false;
+
+  // Returns the index of the worker of this pool running on this thread, or
+  // the index of the shared queue.
+  size_t own_queue() const {
+    if (thread_pool_internal::current_pool == this)
+      return thread_pool_internal::current_worker;
+    return queues_.size() - 1;
+  }
+
+  void submit(std::function<void()> task) {
+    thread_pool_internal::TaskQueue &queue = queues_[own_queue()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    num_queued_.fetch_add(1, std::memory_order_release);
+    // Locking the mutex orders the notification after a thread checks the
+    // queues and before it sleeps, so the wakeup is not lost.
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_condition_.notify_one();
+  }
+
+  // Wakes the sleeping workers and waiters. Locking the mutex orders the
+  // notification after a thread checks its condition and before it sleeps.
+  void notify_all() {
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    sleep_condition_.notify_all();
+  }
+
+  // Runs one task from the own queue, or stolen from another queue.
+  // Returns false if all queues are empty.
+  bool run_one() {
+    if (num_queued_.load(std::memory_order_acquire) == 0)
+      return false;
+    size_t own = own_queue();
+    std::function<void()> task;
+    for (size_t k = 0; k < queues_.size() && !task; ++k) {
+      size_t i = (own + k) % queues_.size();
+      thread_pool_internal::TaskQueue &queue = queues_[i];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty())
+        continue;
+      if (i == own) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+    if (!task)
+      return false;
+    num_queued_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+  }
+
+  void work(size_t index, std::optional<int> cpu) {
+    if (cpu)
+      thread_pool_internal::set_affinity(*cpu);
+    thread_pool_internal::current_pool = this;
+    thread_pool_internal::current_worker = index;
+    while (true) {
+      if (run_one())
+        continue;
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      sleep_condition_.wait(lock, [this]() {
+        return stopping_ || num_queued_.load(std::memory_order_acquire) != 0;
+      });
+      if (stopping_ && num_queued_.load(std::memory_order_acquire) == 0)
+        return;
+    }
+  }
+};
+
+// A set of tasks submitted to a ThreadPool, which can be waited for together.
+// The tasks must not outlive the objects they refer to, so the destructor
+// waits for them.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool &pool = ThreadPool::global()) : pool_(pool) {}
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  ~TaskGroup() {
+    try {
+      wait();
+    } catch (...) {
+    }
+  }
+
+  // Submits |function|() as a task.
+  template <typename Function>
+  void run(Function function) {
+    num_pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit([this, &pool = pool_,
+                  function = std::move(function)]() mutable {
+      try {
+        function();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!error_)
+          error_ = std::current_exception();
+      }
+      // The group may be destroyed as soon as the count reaches zero, so only
+      // the pool is used after it.
+      if (num_pending_.fetch_sub(1, std::memory_order_release) == 1)
+        pool.notify_all();
+    });
+  }
+
+  // Waits for the submitted tasks, running tasks of the pool meanwhile. When
+  // there is nothing to run, this sleeps until a task is submitted or the
+  // last task of the group finishes.
+  // Rethrows the first exception thrown by a task.
+  void wait() {
+    while (num_pending_.load(std::memory_order_acquire) != 0) {
+      if (pool_.run_one())
+        continue;
+      std::unique_lock<std::mutex> lock(pool_.sleep_mutex_);
+      pool_.sleep_condition_.wait(lock, [this]() {
+        return num_pending_.load(std::memory_order_acquire) == 0 ||
+               pool_.num_queued_.load(std::memory_order_acquire) != 0;
+      });
+    }
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (error_)
+      std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+
+ private:
+  ThreadPool &pool_;
+  std::atomic<size_t> num_pending_{0};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+template <typename Function>
+void ThreadPool::parallel_for(size_t begin, size_t end, Function function) {
+  TaskGroup group(*this);
+  for (size_t i = begin; i < end; ++i)
+    group.run([&function, i]() { function(i); });
+  group.wait();
+}
+
+}  // namespace number_theory
+
+using number_theory::TaskGroup;
+using number_theory::ThreadPool;
+
+}  // namespace tql
+
+#endif  // NUMBER_THEORY_THREAD_POOL_H_
@@ -0,0 +1,136 @@
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/thread_pool.h"
+
+namespace tql::number_theory {
+
+TEST(ThreadPoolTest, ParallelFor) {
+  for (size_t num_threads : {1, 2, 4}) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(pool.num_threads(), num_threads);
+    std::vector<int> values(1000);
+    pool.parallel_for(0, values.size(), [&values](size_t i) {
+      values[i] = static_cast<int>(i);
+    });
+    for (size_t i = 0; i < values.size(); ++i)
+      ASSERT_EQ(values[i], static_cast<int>(i));
+    pool.parallel_for(5, 5, [](size_t) { FAIL(); });
+  }
+  EXPECT_GE(ThreadPool().num_threads(), 1u);
+}
+
+TEST(ThreadPoolTest, TaskGroup) {
+  ThreadPool pool(3);
+  std::atomic<int> count = 0;
+  {
+    TaskGroup group(pool);
+    for (int i = 0; i < 100; ++i)
+      group.run([&count]() { ++count; });
+    group.wait();
+    EXPECT_EQ(count, 100);
+    // A group can be reused after waiting.
+    group.run([&count]() { ++count; });
+  }
+  EXPECT_EQ(count, 101);
+}
+
+TEST(ThreadPoolTest, Nested) {
+  // Waiting tasks run other tasks, so nesting deeper than the number of
+  // threads does not deadlock.
+  ThreadPool pool(2);
+  std::atomic<int64_t> sum = 0;
+  pool.parallel_for(0, 8, [&pool, &sum](size_t i) {
+    pool.parallel_for(0, 8, [&pool, &sum, i](size_t j) {
+      pool.parallel_for(0, 8, [&sum, i, j](size_t k) {
+        sum += static_cast<int64_t>(i * 64 + j * 8 + k);
+      });
+    });
+  });
+  EXPECT_EQ(sum, 511 * 512 / 2);
+}
+
+TEST(ThreadPoolTest, WaitSleeps) {
+  // The waiting thread sleeps instead of spinning while the only task runs
+  // on a worker, so the process uses little CPU time.
+  ThreadPool pool(2);
+  TaskGroup group(pool);
+  std::atomic<bool> started = false;
+  group.run([&started]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  });
+  while (!started)
+    std::this_thread::yield();
+  std::clock_t begin = std::clock();
+  group.wait();
+  EXPECT_LT(std::clock() - begin, CLOCKS_PER_SEC / 10);
+}
+
+TEST(ThreadPoolTest, Exception) {
+  ThreadPool pool(2);
+  std::atomic<int> count = 0;
+  EXPECT_THROW(pool.parallel_for(0, 10,
+                                 [&count](size_t i) {
+                                   ++count;
+                                   if (i == 3)
+                                     throw std::runtime_error("task");
+                                 }),
+               std::runtime_error);
+  // The other tasks still run.
+  EXPECT_EQ(count, 10);
+  pool.parallel_for(0, 10, [&count](size_t) { ++count; });
+  EXPECT_EQ(count, 20);
+}
+
+#if defined(__linux__)
+TEST(ThreadPoolTest, Affinity) {
+  // Pin the workers to the first CPU this process may run on.
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed))
+    ++cpu;
+  ThreadPool pool(3, {cpu});
+  std::thread::id caller = std::this_thread::get_id();
+  std::atomic<int> num_worker_tasks = 0;
+  pool.parallel_for(0, 16, [&](size_t) {
+    // The tasks take a while, so that the workers steal some of them.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    if (std::this_thread::get_id() == caller)
+      return;
+    ++num_worker_tasks;
+    cpu_set_t cpus;
+    ASSERT_EQ(pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus), 0);
+    EXPECT_EQ(CPU_COUNT(&cpus), 1);
+    EXPECT_TRUE(CPU_ISSET(cpu, &cpus));
+    EXPECT_EQ(sched_getcpu(), cpu);
+  });
+  EXPECT_GT(num_worker_tasks, 0);
+}
+#endif
+
+TEST(ThreadPoolTest, Global) {
+  EXPECT_EQ(&ThreadPool::global(), &ThreadPool::global());
+  std::atomic<int> count = 0;
+  TaskGroup group;
+  group.run([&count]() { ++count; });
+  group.wait();
+  EXPECT_EQ(count, 1);
+}
+
+}  // namespace tql::number_theory
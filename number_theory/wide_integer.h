@@ -0,0 +1,443 @@
+#ifndef NUMBER_THEORY_WIDE_INTEGER_H_
+#define NUMBER_THEORY_WIDE_INTEGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <compare>
+#include <limits>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Fixed-width multiprecision unsigned integers.
+
+namespace tql {
+namespace number_theory {
+
+// An unsigned integer of |kWords| 64-bit words, which wraps around modulo
+// 2^(64 |kWords|) like the built-in unsigned types. The words are stored
+// inline in little-endian order, so it never allocates memory.
+//
+// The multiplication is schoolbook and the division is Knuth's long division,
+// which are fast enough for the few hundred bits of the factorization
+// algorithms.
+template <size_t kWords>
+class WideUnsigned {
+  static_assert(kWords >= 2, "WideUnsigned needs at least two words.");
+
+ public:
+  static constexpr size_t kBits = 64 * kWords;
+
+  constexpr WideUnsigned() = default;
+
+  // This is an implicit constructor, so that the built-in integers convert
+  // like they do to wider built-in types. Negative numbers are sign-extended.
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
+  constexpr WideUnsigned(T value) {  // NOLINT(runtime/explicit)
+    auto wide = static_cast<unsigned __int128>(value);
+    words_[0] = static_cast<uint64_t>(wide);
+    words_[1] = static_cast<uint64_t>(wide >> 64);
+    if constexpr (std::is_signed_v<T>) {
+      if (value < 0)
+        std::fill(words_.begin() + 2, words_.end(), ~uint64_t(0));
+    }
+  }
+
+  // Converts from another width, dropping the high words which do not fit.
+  template <size_t kOtherWords>
+  constexpr explicit WideUnsigned(const WideUnsigned<kOtherWords> &other) {
+    for (size_t i = 0; i < std::min(kWords, kOtherWords); ++i)
+      words_[i] = other.word(i);
+  }
+
+  // Parses the decimal |digits|.
+  // Throws invalid_argument exception if |digits| is not a decimal number,
+  // and overflow_error exception if it does not fit.
+  static WideUnsigned from_string(std::string_view digits) {
+    if (digits.empty())
+      throw std::invalid_argument("WideUnsigned needs at least one digit.");
+    WideUnsigned result;
+    for (char c : digits) {
+      if (c < '0' || c > '9')
+        throw std::invalid_argument("WideUnsigned only parses decimal digits.");
+      uint64_t carry = static_cast<uint64_t>(c - '0');
+      for (uint64_t &word : result.words_) {
+        unsigned __int128 product =
+            static_cast<unsigned __int128>(word) * 10 + carry;
+        word = static_cast<uint64_t>(product);
+        carry = static_cast<uint64_t>(product >> 64);
+      }
+      if (carry != 0)
+        throw std::overflow_error("The number does not fit in WideUnsigned.");
+    }
+    return result;
+  }
+
+  // Returns the decimal representation.
+  std::string to_string() const {
+    std::string digits;
+    WideUnsigned x = *this;
+    do {
+      digits.push_back(static_cast<char>('0' + x.divide_small(10)));
+    } while (x != 0);
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+  }
+
+  // Returns the low bits converted to the built-in integer type T.
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
+  constexpr explicit operator T() const {
+    return static_cast<T>(static_cast<unsigned __int128>(words_[1]) << 64 |
+                          words_[0]);
+  }
+
+  constexpr explicit operator bool() const { return *this != 0; }
+
+  // Returns the word |index|, where word 0 is the least significant.
+  constexpr uint64_t word(size_t index) const { return words_[index]; }
+  std::span<const uint64_t, kWords> words() const { return words_; }
+
+  // Returns the number of bits needed to represent the number.
+  constexpr size_t bit_width() const {
+    for (size_t i = kWords; i-- > 0;) {
+      if (words_[i] != 0)
+        return 64 * i + std::bit_width(words_[i]);
+    }
+    return 0;
+  }
+
+  // Returns the bit |index|.
+  constexpr bool bit(size_t index) const {
+    return (words_[index / 64] >> (index % 64)) & 1;
+  }
+
+  // Divides the number by |divisor| > 0 in place, and returns the remainder.
+  constexpr uint64_t divide_small(uint64_t divisor) {
+    unsigned __int128 remainder = 0;
+    for (size_t i = kWords; i-- > 0;) {
+      unsigned __int128 dividend = remainder << 64 | words_[i];
+      words_[i] = static_cast<uint64_t>(dividend / divisor);
+      remainder = dividend % divisor;
+    }
+    return static_cast<uint64_t>(remainder);
+  }
+
+  // Returns the number modulo |divisor| > 0.
+  constexpr uint64_t mod_small(uint64_t divisor) const {
+    unsigned __int128 remainder = 0;
+    for (size_t i = kWords; i-- > 0;)
+      remainder = (remainder << 64 | words_[i]) % divisor;
+    return static_cast<uint64_t>(remainder);
+  }
+
+  constexpr WideUnsigned &operator+=(const WideUnsigned &rhs) {
+    bool carry = false;
+    for (size_t i = 0; i < kWords; ++i) {
+      carry = __builtin_add_overflow(words_[i], carry, &words_[i]) |
+              __builtin_add_overflow(words_[i], rhs.words_[i], &words_[i]);
+    }
+    return *this;
+  }
+
+  constexpr WideUnsigned &operator-=(const WideUnsigned &rhs) {
+    bool borrow = false;
+    for (size_t i = 0; i < kWords; ++i) {
+      borrow = __builtin_sub_overflow(words_[i], borrow, &words_[i]) |
+               __builtin_sub_overflow(words_[i], rhs.words_[i], &words_[i]);
+    }
+    return *this;
+  }
+
+  constexpr WideUnsigned &operator*=(const WideUnsigned &rhs) {
+    *this = multiply<kWords>(*this, rhs);
+    return *this;
+  }
+
+  // Throws domain_error exception if |rhs| is zero.
+  constexpr WideUnsigned &operator/=(const WideUnsigned &rhs) {
+    *this = divide(*this, rhs).first;
+    return *this;
+  }
+
+  // Throws domain_error exception if |rhs| is zero.
+  constexpr WideUnsigned &operator%=(const WideUnsigned &rhs) {
+    *this = divide(*this, rhs).second;
+    return *this;
+  }
+
+  constexpr WideUnsigned &operator<<=(size_t shift) {
+    if (shift >= kBits)
+      return *this = WideUnsigned();
+    size_t words = shift / 64, bits = shift % 64;
+    for (size_t i = kWords; i-- > 0;) {
+      uint64_t word = i >= words ? words_[i - words] << bits : 0;
+      if (bits != 0 && i > words)
+        word |= words_[i - words - 1] >> (64 - bits);
+      words_[i] = word;
+    }
+    return *this;
+  }
+
+  constexpr WideUnsigned &operator>>=(size_t shift) {
+    if (shift >= kBits)
+      return *this = WideUnsigned();
+    size_t words = shift / 64, bits = shift % 64;
+    for (size_t i = 0; i < kWords; ++i) {
+      uint64_t word = i + words < kWords ? words_[i + words] >> bits : 0;
+      if (bits != 0 && i + words + 1 < kWords)
+        word |= words_[i + words + 1] << (64 - bits);
+      words_[i] = word;
+    }
+    return *this;
+  }
+
+  constexpr WideUnsigned &operator++() { return *this += 1; }
+  constexpr WideUnsigned &operator--() { return *this -= 1; }
+
+  friend constexpr WideUnsigned operator+(WideUnsigned lhs,
+                                          const WideUnsigned &rhs) {
+    return lhs += rhs;
+  }
+  friend constexpr WideUnsigned operator-(WideUnsigned lhs,
+                                          const WideUnsigned &rhs) {
+    return lhs -= rhs;
+  }
+  friend constexpr WideUnsigned operator*(WideUnsigned lhs,
+                                          const WideUnsigned &rhs) {
+    return lhs *= rhs;
+  }
+  friend constexpr WideUnsigned operator/(WideUnsigned lhs,
+                                          const WideUnsigned &rhs) {
+    return lhs /= rhs;
+  }
+  friend constexpr WideUnsigned operator%(WideUnsigned lhs,
+                                          const WideUnsigned &rhs) {
+    return lhs %= rhs;
+  }
+  friend constexpr WideUnsigned operator<<(WideUnsigned lhs, size_t shift) {
+    return lhs <<= shift;
+  }
+  friend constexpr WideUnsigned operator>>(WideUnsigned lhs, size_t shift) {
+    return lhs >>= shift;
+  }
+
+  friend constexpr bool operator==(const WideUnsigned &,
+                                   const WideUnsigned &) = default;
+  friend constexpr std::strong_ordering operator<=>(const WideUnsigned &lhs,
+                                                    const WideUnsigned &rhs) {
+    for (size_t i = kWords; i-- > 0;) {
+      if (lhs.words_[i] != rhs.words_[i])
+        return lhs.words_[i] <=> rhs.words_[i];
+    }
+    return std::strong_ordering::equal;
+  }
+
+  // Returns the low |kResultWords| words of |lhs| * |rhs|, which is the full
+  // product if |kResultWords| is 2 |kWords|.
+  template <size_t kResultWords>
+  static constexpr WideUnsigned<kResultWords> multiply(
+      const WideUnsigned &lhs,
+      const WideUnsigned &rhs) {
+    std::array<uint64_t, kResultWords> words{};
+    for (size_t i = 0; i < kWords && i < kResultWords; ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < kWords && i + j < kResultWords; ++j) {
+        unsigned __int128 product =
+            static_cast<unsigned __int128>(lhs.words_[i]) * rhs.words_[j] +
+            words[i + j] + carry;
+        words[i + j] = static_cast<uint64_t>(product);
+        carry = static_cast<uint64_t>(product >> 64);
+      }
+      if (i + kWords < kResultWords)
+        words[i + kWords] = carry;
+    }
+    return WideUnsigned<kResultWords>::from_words(words);
+  }
+
+  // Returns the quotient and the remainder of |lhs| / |rhs| with Knuth's
+  // algorithm D, which finds a quotient word per step.
+  // Throws domain_error exception if |rhs| is zero.
+  static constexpr std::pair<WideUnsigned, WideUnsigned> divide(
+      const WideUnsigned &lhs,
+      const WideUnsigned &rhs) {
+    using u128 = unsigned __int128;
+    if (rhs == 0)
+      throw std::domain_error("Division by zero.");
+    if (rhs.bit_width() <= 64) {
+      WideUnsigned quotient = lhs;
+      uint64_t remainder = quotient.divide_small(rhs.words_[0]);
+      return {quotient, remainder};
+    }
+    if (lhs < rhs)
+      return {WideUnsigned(), lhs};
+    size_t n = (rhs.bit_width() + 63) / 64;
+    size_t m = (lhs.bit_width() + 63) / 64;
+    // Normalize so that the top word of the divisor has its top bit set,
+    // which makes each estimated quotient word off by at most two.
+    int shift = std::countl_zero(rhs.words_[n - 1]);
+    WideUnsigned v = rhs << shift;
+    std::array<uint64_t, kWords + 1> u{};
+    for (size_t i = 0; i < m; ++i)
+      u[i] = lhs.words_[i];
+    if (shift != 0) {
+      for (size_t i = m + 1; i-- > 0;) {
+        u[i] <<= shift;
+        if (i > 0)
+          u[i] |= u[i - 1] >> (64 - shift);
+      }
+    }
+
+    WideUnsigned quotient;
+    for (size_t j = m - n + 1; j-- > 0;) {
+      u128 numerator = static_cast<u128>(u[j + n]) << 64 | u[j + n - 1];
+      u128 estimate = numerator / v.words_[n - 1];
+      u128 rest = numerator % v.words_[n - 1];
+      while (estimate >> 64 != 0 ||
+             estimate * v.words_[n - 2] > (rest << 64 | u[j + n - 2])) {
+        --estimate;
+        rest += v.words_[n - 1];
+        if (rest >> 64 != 0)
+          break;
+      }
+      // u[j..j + n] -= estimate * v
+      uint64_t q = static_cast<uint64_t>(estimate);
+      uint64_t carry = 0;
+      for (size_t i = 0; i < n; ++i) {
+        u128 product = static_cast<u128>(q) * v.words_[i] + carry;
+        uint64_t low = static_cast<uint64_t>(product);
+        carry = static_cast<uint64_t>(product >> 64) + (u[i + j] < low);
+        u[i + j] -= low;
+      }
+      bool negative = u[j + n] < carry;
+      u[j + n] -= carry;
+      if (negative) {
+        // The estimate was one too large. Add the divisor back.
+        --q;
+        uint64_t add_carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+          u128 sum = static_cast<u128>(u[i + j]) + v.words_[i] + add_carry;
+          u[i + j] = static_cast<uint64_t>(sum);
+          add_carry = static_cast<uint64_t>(sum >> 64);
+        }
+        u[j + n] += add_carry;
+      }
+      quotient.words_[j] = q;
+    }
+
+    WideUnsigned remainder;
+    for (size_t i = 0; i < n; ++i) {
+      remainder.words_[i] = u[i] >> shift;
+      if (shift != 0)
+        remainder.words_[i] |= u[i + 1] << (64 - shift);
+    }
+    return {quotient, remainder};
+  }
+
+  static constexpr WideUnsigned from_words(
+      const std::array<uint64_t, kWords> &words) {
+    WideUnsigned result;
+    result.words_ = words;
+    return result;
+  }
+
+  friend std::ostream &operator<<(std::ostream &stream,
+                                  const WideUnsigned &x) {
+    return stream << x.to_string();
+  }
+
+ private:
+  std::array<uint64_t, kWords> words_{};
+};
+
+// Returns |a| * |b| modulo |modulus| > 0.
+template <size_t kWords>
+constexpr WideUnsigned<kWords> multiply_mod(
+    const WideUnsigned<kWords> &a,
+    const WideUnsigned<kWords> &b,
+    const WideUnsigned<kWords> &modulus) {
+  using Wide = WideUnsigned<2 * kWords>;
+  Wide product = WideUnsigned<kWords>::template multiply<2 * kWords>(a, b);
+  return WideUnsigned<kWords>(product % Wide(modulus));
+}
+
+// Returns the greatest common divisor of |a| and |b| with the binary gcd.
+template <size_t kWords>
+constexpr WideUnsigned<kWords> gcd(WideUnsigned<kWords> a,
+                                   WideUnsigned<kWords> b) {
+  if (a == 0)
+    return b;
+  if (b == 0)
+    return a;
+  auto trailing_zeros = [](const WideUnsigned<kWords> &x) {
+    size_t i = 0;
+    while (x.word(i) == 0)
+      ++i;
+    return 64 * i + std::countr_zero(x.word(i));
+  };
+  size_t shift = std::min(trailing_zeros(a), trailing_zeros(b));
+  a >>= trailing_zeros(a);
+  while (b != 0) {
+    b >>= trailing_zeros(b);
+    if (a > b)
+      std::swap(a, b);
+    b -= a;
+  }
+  return a << shift;
+}
+
+// Returns the square root of |x| rounded down, with Newton's method.
+template <size_t kWords>
+constexpr WideUnsigned<kWords> isqrt(const WideUnsigned<kWords> &x) {
+  if (x == 0)
+    return x;
+  // The initial guess is above the root, and the iterates decrease to it.
+  WideUnsigned<kWords> y = WideUnsigned<kWords>(1) << (x.bit_width() + 1) / 2;
+  while (true) {
+    WideUnsigned<kWords> next = (y + x / y) >> 1;
+    if (next >= y)
+      return y;
+    y = next;
+  }
+}
+
+using UInt256 = WideUnsigned<4>;
+
+}  // namespace number_theory
+
+using number_theory::isqrt;
+using number_theory::multiply_mod;
+using number_theory::UInt256;
+using number_theory::WideUnsigned;
+
+}  // namespace tql
+
+namespace std {
+
+template <size_t kWords>
+class numeric_limits<tql::number_theory::WideUnsigned<kWords>> {
+  using type = tql::number_theory::WideUnsigned<kWords>;
+
+ public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed = false;
+  static constexpr bool is_integer = true;
+  static constexpr bool is_exact = true;
+  static constexpr bool is_modulo = true;
+  static constexpr int digits = static_cast<int>(type::kBits);
+  static constexpr int radix = 2;
+  static constexpr type min() { return type(); }
+  static constexpr type lowest() { return type(); }
+  static constexpr type max() { return type() - 1; }
+};
+
+}  // namespace std
+
+#endif  // NUMBER_THEORY_WIDE_INTEGER_H_
@@ -0,0 +1,99 @@
+#include <stdint.h>
+
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "number_theory/wide_integer.h"
+
+namespace tql::number_theory {
+
+TEST(WideIntegerTest, Conversions) {
+  using u128 = unsigned __int128;
+  EXPECT_EQ(UInt256().to_string(), "0");
+  EXPECT_EQ(UInt256(12345).to_string(), "12345");
+  EXPECT_EQ(static_cast<u128>(UInt256(~u128(0))), ~u128(0));
+  EXPECT_EQ(UInt256(-1), std::numeric_limits<UInt256>::max());
+  EXPECT_EQ(UInt256(-1).to_string(),
+            "115792089237316195423570985008687907853269984665640564039457584"
+            "007913129639935");
+  std::string digits = "123456789012345678901234567890123456789012345678901234";
+  UInt256 x = UInt256::from_string(digits);
+  EXPECT_EQ(x.to_string(), digits);
+  EXPECT_EQ(x.bit_width(), 177u);
+  EXPECT_EQ(WideUnsigned<2>(x), WideUnsigned<2>(static_cast<u128>(x)));
+  EXPECT_EQ(UInt256(WideUnsigned<8>(x)), x);
+  std::ostringstream stream;
+  stream << x;
+  EXPECT_EQ(stream.str(), digits);
+
+  EXPECT_THROW(UInt256::from_string(""), std::invalid_argument);
+  EXPECT_THROW(UInt256::from_string("12a"), std::invalid_argument);
+  EXPECT_THROW(UInt256::from_string(std::string(78, '9')),
+               std::overflow_error);
+  static_assert(std::numeric_limits<UInt256>::digits == 256);
+}
+
+TEST(WideIntegerTest, Arithmetic) {
+  using u128 = unsigned __int128;
+  using W = WideUnsigned<2>;
+  std::mt19937_64 engine(1);
+  // Compare with the built-in 128-bit arithmetic.
+  for (int i = 0; i < 10000; ++i) {
+    u128 a = u128(engine()) << 64 | engine();
+    u128 b = (u128(engine()) << 64 | engine()) >> (engine() % 128);
+    size_t shift = engine() % 128;
+    ASSERT_EQ(static_cast<u128>(W(a) + W(b)), a + b);
+    ASSERT_EQ(static_cast<u128>(W(a) - W(b)), a - b);
+    ASSERT_EQ(static_cast<u128>(W(a) * W(b)), a * b);
+    ASSERT_EQ(static_cast<u128>(W(a) << shift), a << shift);
+    ASSERT_EQ(static_cast<u128>(W(a) >> shift), a >> shift);
+    ASSERT_EQ(W(a) < W(b), a < b);
+    if (b != 0) {
+      ASSERT_EQ(static_cast<u128>(W(a) / W(b)), a / b);
+      ASSERT_EQ(static_cast<u128>(W(a) % W(b)), a % b);
+    }
+  }
+  EXPECT_THROW(UInt256(1) / UInt256(0), std::domain_error);
+}
+
+TEST(WideIntegerTest, Division) {
+  std::mt19937_64 engine(2);
+  for (int i = 0; i < 10000; ++i) {
+    std::array<uint64_t, 4> words;
+    for (uint64_t &word : words)
+      word = engine() % 4 == 0 ? ~uint64_t(0) : engine();
+    UInt256 a = UInt256::from_words(words);
+    UInt256 b = UInt256::from_words(words) >> (engine() % 256);
+    b += engine();
+    if (b == 0)
+      continue;
+    auto [quotient, remainder] = UInt256::divide(a, b);
+    ASSERT_LT(remainder, b);
+    ASSERT_EQ(
+        WideUnsigned<8>(quotient) * WideUnsigned<8>(b) +
+            WideUnsigned<8>(remainder),
+        WideUnsigned<8>(a));
+  }
+}
+
+TEST(WideIntegerTest, NumberTheory) {
+  UInt256 a = UInt256::from_string(
+      "123456789012345678901234567890123456789012345678901234567890");
+  UInt256 b = UInt256::from_string("98765432109876543210987654321");
+  EXPECT_EQ(gcd(a, b), UInt256::from_string("900000000090000000009"));
+  EXPECT_EQ(gcd(a, UInt256(0)), a);
+  EXPECT_EQ(isqrt(a),
+            UInt256::from_string("351364182882014425311122238169"));
+  EXPECT_EQ(isqrt(UInt256(99)), 9);
+  EXPECT_EQ(isqrt(UInt256(100)), 10);
+  EXPECT_EQ(multiply_mod(a, a, b),
+            UInt256::from_string("68847178506884717850688471785"));
+  EXPECT_EQ(UInt256(1000).mod_small(7), 6u);
+}
+
+}  // namespace tql::number_theory